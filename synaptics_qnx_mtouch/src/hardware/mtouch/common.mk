@@ -10,6 +10,11 @@ endef
 CCFLAGS	+=-D_FILE_OFFSET_BITS=32 -D_IOFUNC_OFFSET_BITS=32 -D_LARGEFILE64_SOURCE=0
 LDFLAGS += -M
 
+# the armle-v7 variant builds the NEON kernels of the filter chain and the BIST
+ifneq ($(filter v7, $(VARIANT_LIST)),)
+CCFLAGS += -mfpu=neon
+endif
+
 NAME=$(PROJECT)
 USEFILE=
 
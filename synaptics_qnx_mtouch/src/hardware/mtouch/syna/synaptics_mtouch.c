@@ -49,12 +49,23 @@
  */
 
 #include "synaptics_mtouch.h"
+#include "synaptics_mtouch_test.h"
 #include "synaptics_rmi4_fw_update.h"
+#include "synaptics_mtouch_control.h"
 
 extern int synaptics_rmi4_init(syna_dev_t *p_dev);
 extern int synaptics_rmi4_deinit(syna_dev_t *p_dev);
 extern int synaptics_rmi4_sersor_report(struct synaptics_rmi4_data *rmi4_data);
 extern int synaptics_rmi4_fwu_updater(const char *path_fw_image, const unsigned int image_fw_id);
+extern int synaptics_rmi4_fwu_check_update(const char *path_fw_image, const unsigned int image_fw_id);
+extern int synaptics_rmi4_fwu_attn_enable(bool enable);
+extern void synaptics_rmi4_fwu_set_journal(const char *path);
+extern void synaptics_rmi4_fwu_set_handoff(void (*handoff)(void *arg), void *arg);
+extern unsigned int synaptics_rmi4_fwu_get_progress(void);
+extern int synaptics_rmi4_fwu_attn(struct synaptics_rmi4_data *rmi4_data);
+
+static int mtouch_power_on();
+static int mtouch_power_off();
 
 
 /*
@@ -136,9 +147,10 @@ int mtouch_i2c_write(syna_dev_t *dev, uint8_t addr, uint16_t len, uint8_t *data)
 
 	_CHECK_POINTER(dev);
 
-	if ((len > I2C_XFER_LIMIT) || (len < 0)) {
+	// the register address shares the buffer with the payload
+	if ((len > I2C_XFER_LIMIT - 1) || (len < 0)) {
 		mtouch_error(MTOUCH_DEV, "%s: invalid input length (input %d; limit %d)",
-					__FUNCTION__, len, I2C_XFER_LIMIT);
+					__FUNCTION__, len, I2C_XFER_LIMIT - 1);
 		return -EINVAL;
 	}
 	if (dev->pvt_data->i2c_fd == -1) {
@@ -169,6 +181,215 @@ int mtouch_i2c_write(syna_dev_t *dev, uint8_t addr, uint16_t len, uint8_t *data)
 }
 
 
+/*
+ * start/stop the timer of the display-synchronous resampling
+ * the timer runs only while there are frames to deliver
+ *
+ * the first expiry is placed on the refresh grid given by resample_phase,
+ * the timer has no vsync input, so it free-runs from there and drifts
+ * against the display by the error of the period until it is stopped
+ */
+static void mtouch_resample_arm(syna_dev_t *dev, bool arm)
+{
+	struct itimerspec its;
+	uint64_t period = dev->resample->period;
+	uint64_t phase;
+	uint64_t now;
+	uint64_t next;
+
+	if (arm == dev->pvt_data->resample_armed)
+		return;
+
+	memset(&its, 0x00, sizeof(its));
+	if (arm) {
+		// the next refresh after now
+		phase = ((uint64_t)dev->pvt_data->resample_phase * 1000) % period;
+		ClockTime(CLOCK_MONOTONIC, NULL, &now);
+		next = now - ((now + period - phase) % period) + period;
+
+		its.it_value.tv_sec = next / 1000000000ULL;
+		its.it_value.tv_nsec = next % 1000000000ULL;
+		its.it_interval.tv_sec = period / 1000000000ULL;
+		its.it_interval.tv_nsec = period % 1000000000ULL;
+	}
+
+	if (timer_settime(dev->pvt_data->resample_timer, TIMER_ABSTIME, &its, NULL) == -1) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to %s the resampling timer (error: %s)",
+					__FUNCTION__, (arm) ? "start" : "stop", strerror (errno));
+		return;
+	}
+
+	dev->pvt_data->resample_armed = arm;
+}
+
+
+/*
+ * compare the frame with the last delivered one
+ * the contacts down in both frames are regarded as unchanged when their
+ * position and size move within the deadbands
+ *
+ * syna_dev_t *dev   : mtouch device instance data
+ * struct touch_report_t *touch_report: the frame to deliver
+ * unsigned int count: number of contacts in the frame
+ *
+ * return true if the frame is unchanged
+ */
+static bool mtouch_is_frame_unchanged(syna_dev_t *dev, struct touch_report_t *touch_report,
+			unsigned int count)
+{
+	unsigned int i;
+	int position = dev->pvt_data->dedup_position;
+	int size = dev->pvt_data->dedup_size;
+	struct touch_report_t *last = dev->last_report;
+
+	if ((!last) || (count != dev->last_count))
+		return false;
+
+	if (dev->button_state != dev->last_button_state)
+		return false;
+
+	for (i = 0; i < count; i++) {
+		if (touch_report[i].is_touched != last[i].is_touched)
+			return false;
+
+		if (FINGER_LANDING != touch_report[i].is_touched)
+			continue;
+
+		if ((abs(touch_report[i].touch_points.x - last[i].touch_points.x) > position) ||
+			(abs(touch_report[i].touch_points.y - last[i].touch_points.y) > position) ||
+			(abs(touch_report[i].touch_points.wx - last[i].touch_points.wx) > size) ||
+			(abs(touch_report[i].touch_points.wy - last[i].touch_points.wy) > size))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * deliver a frame to the Input Events library
+ *
+ * when the frame_dedup is enabled, a frame unchanged from the last delivered one
+ * is skipped, unless it carries the parser flags or the dedup_keepalive is expired
+ *
+ * syna_dev_t *dev   : mtouch device instance data
+ * struct touch_report_t *touch_report: the frame to deliver
+ * unsigned int flags: the parser flags
+ * uint64_t timestamp: the time of the frame, in nanoseconds
+ */
+static void mtouch_deliver_packet(syna_dev_t *dev, struct touch_report_t *touch_report,
+			unsigned int flags, uint64_t timestamp)
+{
+	unsigned int count = dev->rmi4_data->num_of_fingers;
+
+	if (dev->pvt_data->frame_dedup) {
+		if ((MTOUCH_PARSER_FLAG_NONE == flags) &&
+			(timestamp - dev->last_delivery < (uint64_t)dev->pvt_data->dedup_keepalive * 1000000) &&
+			(mtouch_is_frame_unchanged(dev, touch_report, count))) {
+			return;
+		}
+
+		// keep a copy of the delivered frame
+		if (count != dev->last_count) {
+			if (dev->last_report)
+				free(dev->last_report);
+
+			dev->last_report = calloc(count, sizeof(struct touch_report_t));
+			dev->last_count = (dev->last_report) ? count : 0;
+		}
+		if (dev->last_report)
+			memcpy(dev->last_report, touch_report, count * sizeof(struct touch_report_t));
+
+		dev->last_button_state = dev->button_state;
+		dev->last_delivery = timestamp;
+	}
+
+	// process the data packet from the specified driver
+	// the relevant information from the driver's data packet will be used to create an mtouch_event_t
+	// so that the Input Events framework can continue to process it and pass it to Screen.
+	mtouch_driver_process_packet(dev->inputevents_hdl,
+								touch_report,
+								dev,
+								flags);
+}
+
+/*
+ * handle a touch frame collected in the interrupt
+ * the frame is delivered directly, or kept for the resampling
+ *
+ * syna_dev_t *dev   : mtouch device instance data
+ */
+static void mtouch_report_touch(syna_dev_t *dev)
+{
+	// a large object is covering the sensor
+	// the cancellation is delivered once, then the report is suppressed until it lifts
+	if ((dev->large_object) && (MTOUCH_PARSER_FLAG_NONE == dev->parser_flags))
+		return;
+
+	// keep the frame for the resampling, it is delivered on the display cadence
+	if (dev->resample) {
+		if (MTOUCH_PARSER_FLAG_NONE == dev->parser_flags) {
+			synaptics_mtouch_resample_push(dev->resample,
+								dev->touch_report,
+								dev->rmi4_data->num_of_fingers,
+								dev->timestamp);
+			mtouch_resample_arm(dev, true);
+			return;
+		}
+
+		synaptics_mtouch_resample_reset(dev->resample);
+	}
+
+	mtouch_deliver_packet(dev, dev->touch_report, dev->parser_flags, dev->timestamp);
+
+	dev->parser_flags = MTOUCH_PARSER_FLAG_NONE;
+}
+
+/*
+ * handle a change of the 0D buttons collected in the interrupt, without a touch frame
+ * the button state is carried by the packet of the touch report, see mtouch_get_select(),
+ * so the last touch frame is delivered again, bypassing the resampling and the palm policy
+ *
+ * syna_dev_t *dev   : mtouch device instance data
+ */
+static void mtouch_report_button(syna_dev_t *dev)
+{
+	// the next resampled frame carries the new state
+	if ((dev->resample) && (dev->pvt_data->resample_armed))
+		return;
+
+	mtouch_deliver_packet(dev, dev->touch_report, MTOUCH_PARSER_FLAG_NONE, dev->timestamp);
+}
+
+/*
+ * report the sources serviced by synaptics_rmi4_sersor_report()
+ * shared by the interrupt handling and the health monitor, the caller must hold the thread_mutex
+ *
+ * syna_dev_t *dev   : mtouch device instance data
+ * int sources       : bitmask of the sources serviced, INTERRUPT_STATUS_*
+ */
+static void mtouch_report_sources(syna_dev_t *dev, int sources)
+{
+	// the controller was reset and recovered, the contacts are released
+	if (sources & INTERRUPT_STATUS_RESET) {
+		mtouch_info(MTOUCH_DEV, "%s: INTERRUPT_STATUS_RESET", __FUNCTION__);
+
+		dev->large_object = false;
+		sources |= INTERRUPT_STATUS_TOUCH;
+	}
+
+	// the buttons share the packet of the touch report, see mtouch_get_select()
+	if (sources & INTERRUPT_STATUS_TOUCH) {
+		mtouch_info(MTOUCH_DEV, "%s: INTERRUPT_STATUS_TOUCH", __FUNCTION__);
+
+		mtouch_report_touch(dev);
+	}
+	else if (sources & INTERRUPT_STATUS_BUTTON) {
+		mtouch_info(MTOUCH_DEV, "%s: INTERRUPT_STATUS_BUTTON", __FUNCTION__);
+
+		mtouch_report_button(dev);
+	}
+}
+
 /*
  * implement the interrupt handling routine
  * the routine is created by the pthtead_create() in mtouch_driver_init()
@@ -196,6 +417,8 @@ static void* mtouch_interrupt_handling_thread(void* args)
 	struct sigevent ev;
 
 	int retval;
+	uint64_t now;
+	struct touch_report_t *touch_report;
 
 	// prepare for the simple messages passing
 	// fill in the fields of an iov_t structure
@@ -225,6 +448,20 @@ static void* mtouch_interrupt_handling_thread(void* args)
 		if (PULSE_CODE == pulse.code) {
 			pthread_mutex_lock (&pvt_data->thread_mutex);
 
+			// the device is owned by the fw update, which services the attention
+			// the interrupt stays masked if the update is not able to service it
+			if (dev->fwu_flashing) {
+				pthread_mutex_unlock (&pvt_data->thread_mutex);
+
+				if (synaptics_rmi4_fwu_attn(dev->rmi4_data) > 0)
+					InterruptUnmask (pvt_data->irq, pvt_data->irq_iid);
+
+				continue;
+			}
+
+			// record the time of interrupt
+			ClockTime(CLOCK_MONOTONIC, NULL, &dev->timestamp);
+
 			// invoke the specified function to handle it
 			// and the return value stands for the type of interrupt
 			retval = synaptics_rmi4_sersor_report(dev->rmi4_data);
@@ -241,21 +478,8 @@ static void* mtouch_interrupt_handling_thread(void* args)
 			SIGEV_MAKE_OVERDRIVE(&ev);
 			MsgDeliverEvent(0, &ev);
 
-			switch(retval) {
-			case INTERRUPT_STATUS_TOUCH:
-				mtouch_info(MTOUCH_DEV, "%s: INTERRUPT_STATUS_TOUCH", __FUNCTION__);
-
-				// process the data packet from the specified driver
-				// the relevant information from the driver's data packet will be used to create an mtouch_event_t
-				// so that the Input Events framework can continue to process it and pass it to Screen.
-				mtouch_driver_process_packet(dev->inputevents_hdl,
-											dev->touch_report,
-											dev,
-											MTOUCH_PARSER_FLAG_NONE);
-				break;
-			default:
-				break;
-			}
+			// the return value is a bitmask of all sources serviced in this interrupt
+			mtouch_report_sources(dev, retval);
 
 			pthread_mutex_unlock (&pvt_data->thread_mutex);
 
@@ -263,6 +487,22 @@ static void* mtouch_interrupt_handling_thread(void* args)
 			// this must be called InterruptUnmask to re-enable the interrupt.
 			InterruptUnmask (pvt_data->irq, pvt_data->irq_iid);
 		}
+		else if (RESAMPLE_PULSE_CODE == pulse.code) {
+			pthread_mutex_lock (&pvt_data->thread_mutex);
+
+			// produce the frame of this display refresh
+			// stop the timer once there is nothing to deliver
+			ClockTime(CLOCK_MONOTONIC, NULL, &now);
+			touch_report = synaptics_mtouch_resample_sample(dev->resample, now);
+			if (touch_report) {
+				mtouch_deliver_packet(dev, touch_report, MTOUCH_PARSER_FLAG_NONE, now);
+			}
+			else {
+				mtouch_resample_arm(dev, false);
+			}
+
+			pthread_mutex_unlock (&pvt_data->thread_mutex);
+		}
 		else {
 			mtouch_error(MTOUCH_DEV, "%s: unknown pulse code %x", __FUNCTION__, pulse.code);
 			if (rcvid) {
@@ -293,19 +533,27 @@ static void mtouch_irq_enable(syna_dev_t *dev, bool enable)
 /*
  * control the gpio to power-on the device
  * issue a hardware reset
+ *
+ * return EOK: the device is powered on
+ * return -ENOTSUP: no power control on the board
  */
-static void mtouch_power_on()
+static int mtouch_power_on()
 {
-	// do nothing
+	// no power control on this board, implement with the gpio of the target platform
+	return -ENOTSUP;
 }
 
 /*
  * control the gpio to power-off the device
  * reset pin should stay in low
+ *
+ * return EOK: the device is powered off
+ * return -ENOTSUP: no power control on the board
  */
-static void mtouch_power_off()
+static int mtouch_power_off()
 {
-	// do nothing
+	// no power control on this board, implement with the gpio of the target platform
+	return -ENOTSUP;
 }
 
 /*
@@ -374,6 +622,24 @@ static int mtouch_get_coords(void *packet, uint8_t digit_idx, int32_t *x, int32_
 	return EOK;
 }
 
+/*
+ * retrieves the state of the 0D capacitive buttons
+ * the buttons are not bound to a digit, so the same state is returned for each digit_idx
+ *
+ * void *packet      : data packet that contains information on the touch-related event
+ * uint8_t digit_idx : digit (finger) index that the Input Events library is requesting
+ * uint32_t *select  : bitmask of the buttons pressed, bit n stands for the button n
+ * void* arg         : user information
+ */
+static int mtouch_get_select(void *packet, uint8_t digit_idx, uint32_t *select, void *arg)
+{
+	syna_dev_t *dev = (syna_dev_t *)arg;
+
+	*select = dev->button_state;
+
+	return EOK;
+}
+
 /*
  * attach the driver to the Input Event framework, libinputevents
  *
@@ -413,6 +679,15 @@ static int mtouch_attach_dev(syna_dev_t *p_dev)
 		.height = p_dev->rmi4_data->sensor_max_y
 	};
 
+	// report the 0D buttons through the select capability
+	if ((p_dev->rmi4_data->f1a) && (p_dev->rmi4_data->valid_button_count > 0)) {
+		funcs.get_select = mtouch_get_select;
+		params.capabilities |= MTOUCH_CAPABILITIES_SELECT;
+
+		mtouch_info(MTOUCH_DEV, "%s: number of buttons = %-2d",
+					__FUNCTION__, p_dev->rmi4_data->valid_button_count);
+	}
+
 	mtouch_info(MTOUCH_DEV, "%s: maximum touch points = %-2d",
 				__FUNCTION__, params.max_touchpoints);
 	mtouch_info(MTOUCH_DEV, "%s: sensor maximum X = %-4d, maximum Y = %-4d",
@@ -463,26 +738,94 @@ static int mtouch_options(const char *option, const char *value, void *arg)
 	else if (0 == strcmp("fw_img_id", option)) {
 		return input_parse_unsigned(option, value, &dev->pvt_data->fw_image_id);
 	}
+	else if (0 == strcmp("fw_journal", option)) {
+		return input_parse_string(option, value, &dev->pvt_data->fw_journal);
+	}
+	else if (0 == strcmp("fw_ctrl", option)) {
+		return input_parse_string(option, value, &dev->pvt_data->fw_ctrl);
+	}
+	else if (0 == strcmp("palm_suppression", option)) {
+		return input_parse_unsigned(option, value, &dev->pvt_data->palm_suppression);
+	}
+	else if (0 == strcmp("filter_iir", option)) {
+		return input_parse_unsigned(option, value, &dev->pvt_data->filter_iir);
+	}
+	else if (0 == strcmp("filter_one_euro", option)) {
+		return input_parse_unsigned(option, value, &dev->pvt_data->filter_one_euro);
+	}
+	else if (0 == strcmp("filter_hysteresis", option)) {
+		return input_parse_unsigned(option, value, &dev->pvt_data->filter_hysteresis);
+	}
+	else if (0 == strcmp("predict_horizon", option)) {
+		return input_parse_unsigned(option, value, &dev->pvt_data->predict_horizon);
+	}
+	else if (0 == strcmp("resample_rate", option)) {
+		return input_parse_unsigned(option, value, &dev->pvt_data->resample_rate);
+	}
+	else if (0 == strcmp("resample_delay", option)) {
+		return input_parse_unsigned(option, value, &dev->pvt_data->resample_delay);
+	}
+	else if (0 == strcmp("resample_phase", option)) {
+		return input_parse_unsigned(option, value, &dev->pvt_data->resample_phase);
+	}
+	else if (0 == strcmp("frame_dedup", option)) {
+		return input_parse_unsigned(option, value, &dev->pvt_data->frame_dedup);
+	}
+	else if (0 == strcmp("dedup_position", option)) {
+		return input_parse_unsigned(option, value, &dev->pvt_data->dedup_position);
+	}
+	else if (0 == strcmp("dedup_size", option)) {
+		return input_parse_unsigned(option, value, &dev->pvt_data->dedup_size);
+	}
+	else if (0 == strcmp("dedup_keepalive", option)) {
+		return input_parse_unsigned(option, value, &dev->pvt_data->dedup_keepalive);
+	}
+	else if (0 == strcmp("f54_capture", option)) {
+		return input_parse_unsigned(option, value, &dev->pvt_data->f54_capture);
+	}
+	else if (0 == strcmp("f54_interval", option)) {
+		return input_parse_unsigned(option, value, &dev->pvt_data->f54_interval);
+	}
+	else if (0 == strcmp("f54_depth", option)) {
+		return input_parse_unsigned(option, value, &dev->pvt_data->f54_depth);
+	}
+	else if (0 == strcmp("bist_min", option)) {
+		return input_parse_unsigned(option, value, &dev->pvt_data->bist_min);
+	}
+	else if (0 == strcmp("bist_max", option)) {
+		return input_parse_unsigned(option, value, &dev->pvt_data->bist_max);
+	}
+	else if (0 == strcmp("bist_limits", option)) {
+		return input_parse_string(option, value, &dev->pvt_data->bist_limits);
+	}
+	else if (0 == strcmp("pdt_cache", option)) {
+		return input_parse_string(option, value, &dev->pvt_data->pdt_cache);
+	}
+	else if (0 == strcmp("health_interval", option)) {
+		return input_parse_unsigned(option, value, &dev->pvt_data->health_interval);
+	}
+	else if (0 == strcmp("health_idle", option)) {
+		return input_parse_unsigned(option, value, &dev->pvt_data->health_idle);
+	}
 
 	return EOK;
 }
 
 /*
- * initialization callback function
- *
- * screen calls dlopen() on this specified driver.
- * upon a successful dlopen(), Screen will use dlsym() to look for mtouch_driver_init()
- * for driver initialization.
+ * create the mtouch device instance and bring up the touch controller
  * performs the followings:
  *    - set the default values of the driver
- *    - parse any options specified in graphics.conf
+ *    - parse the options, the format is: option=value1,option2=value2
  *    - hardware initialization
- *    - connect to input events library
- *    - create a separate thread to communicate directly with the hardware
- *      and trigger the input events library API function mtouch_driver_process_packet()
- *      to start processing the touch-related event data.
+ *
+ * it is shared by the mtouch_driver_init() and the mtouch_test_init()
+ *
+ * const char *options: the options, NULL to use the defaults
+ *
+ * return the mtouch device instance data
+ * NULL, fail
  */
-void *mtouch_driver_init(const char *options)
+syna_dev_t *mtouch_open_dev(const char *options)
 {
 	int retval;
 	syna_dev_t *p_dev;
@@ -502,6 +845,26 @@ void *mtouch_driver_init(const char *options)
 	p_dev->pvt_data = NULL;
 	p_dev->rmi4_data = NULL;
 	p_dev->isr_thread = NULL;
+	p_dev->large_object = false;
+	p_dev->parser_flags = MTOUCH_PARSER_FLAG_NONE;
+	p_dev->timestamp = 0;
+	p_dev->filter = NULL;
+	p_dev->resample = NULL;
+	p_dev->last_report = NULL;
+	p_dev->last_count = 0;
+	p_dev->last_delivery = 0;
+	p_dev->button_state = 0;
+	p_dev->last_button_state = 0;
+	p_dev->fwu_active = false;
+	p_dev->fwu_flashing = false;
+	p_dev->fwu_running = false;
+	p_dev->health_recovering = false;
+	p_dev->fwu_state = FWU_STATE_IDLE;
+	p_dev->fwu_result = EOK;
+	p_dev->control = NULL;
+	p_dev->health_active = false;
+	p_dev->health_stop = false;
+	memset(&p_dev->health_stats, 0x00, sizeof(p_dev->health_stats));
 
 	// create private_data_t
 	p_dev->pvt_data = calloc(1, sizeof(private_data_t));
@@ -511,6 +874,7 @@ void *mtouch_driver_init(const char *options)
 		goto exit;
 	}
 	pvt_data = p_dev->pvt_data;
+	pvt_data->i2c_fd = -1;
 
 	// enable IO capability
 	// lock the process's memory and request I/O privileges
@@ -534,6 +898,30 @@ void *mtouch_driver_init(const char *options)
 					__FUNCTION__);
 		goto exit;
 	}
+	pvt_data->fw_journal = calloc(256, sizeof(char));
+	if (!pvt_data->fw_journal) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to create the fw_journal string buffer",
+					__FUNCTION__);
+		goto exit;
+	}
+	pvt_data->fw_ctrl = calloc(256, sizeof(char));
+	if (!pvt_data->fw_ctrl) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to create the fw_ctrl string buffer",
+					__FUNCTION__);
+		goto exit;
+	}
+	pvt_data->bist_limits = calloc(256, sizeof(char));
+	if (!pvt_data->bist_limits) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to create the bist_limits string buffer",
+					__FUNCTION__);
+		goto exit;
+	}
+	pvt_data->pdt_cache = calloc(256, sizeof(char));
+	if (!pvt_data->pdt_cache) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to create the pdt_cache string buffer",
+					__FUNCTION__);
+		goto exit;
+	}
 
 	// initialize defaults at private_data_t
 	pvt_data->irq = TOUCH_INT;
@@ -542,6 +930,8 @@ void *mtouch_driver_init(const char *options)
 
 	pvt_data->thread_chid = -1;
 	pvt_data->thread_coid = -1;
+	pvt_data->resample_timer = (timer_t)-1;
+	pvt_data->resample_armed = false;
 	pvt_data->thread_param.sched_priority = THREAD_PRIORITY;
 	pvt_data->thread_event.sigev_priority = THREAD_PRIORITY;
 
@@ -550,6 +940,20 @@ void *mtouch_driver_init(const char *options)
 	pvt_data->i2c_slave.addr = 0x20;  // default slave address
 	pvt_data->i2c_slave.fmt = I2C_ADDRFMT_7BIT;
 
+	pvt_data->palm_suppression = 1;  // cancel the contacts when a palm is detected
+
+	pvt_data->dedup_keepalive = 100;  // deliver at least every 100 ms while contacts are down
+
+	pvt_data->f54_capture = F54_CAPTURE_OFF;  // analog capture is for diagnostics only
+	pvt_data->f54_interval = F54_CAPTURE_INTERVAL_MS;
+	pvt_data->f54_depth = F54_RING_DEPTH;
+
+	pvt_data->bist_min = MTOUCH_TEST_BIST_MIN;
+	pvt_data->bist_max = MTOUCH_TEST_BIST_MAX;
+
+	pvt_data->health_interval = HEALTH_INTERVAL;
+	pvt_data->health_idle = HEALTH_IDLE;
+
 	// parses settings specified in graphics.conf
 	input_parseopts(options, mtouch_options, p_dev);
 
@@ -584,6 +988,613 @@ void *mtouch_driver_init(const char *options)
 
 	p_dev->flag = FLAG_INIT;  // initialize the driver status
 
+	return p_dev;
+
+exit:
+	mtouch_close_dev(p_dev);
+
+	return NULL;
+}
+
+/*
+ * release the RMI4 device, the i2c interface and the mtouch device instance
+ * the counterpart of mtouch_open_dev()
+ *
+ * syna_dev_t *p_dev  : mtouch device instance data
+ */
+void mtouch_close_dev(syna_dev_t *p_dev)
+{
+	if (!p_dev)
+		return;
+
+	if (p_dev->pvt_data) {
+		// release the RMI4 device
+		if (p_dev->flag != FLAG_UNKNOWN) {
+			synaptics_rmi4_deinit(p_dev);
+			p_dev->rmi4_data = NULL;
+
+			p_dev->flag = FLAG_UNKNOWN;
+		}
+		// close i2c interface
+		if (p_dev->pvt_data->i2c_fd != -1) {
+			close(p_dev->pvt_data->i2c_fd);
+			p_dev->pvt_data->i2c_fd = -1;
+		}
+		if (p_dev->pvt_data->i2c) {
+			free(p_dev->pvt_data->i2c);
+			p_dev->pvt_data->i2c = NULL;
+		}
+		// release path of image
+		if (p_dev->pvt_data->fw_image_path) {
+			free(p_dev->pvt_data->fw_image_path);
+			p_dev->pvt_data->fw_image_path = NULL;
+		}
+		// release path of journal
+		if (p_dev->pvt_data->fw_journal) {
+			free(p_dev->pvt_data->fw_journal);
+			p_dev->pvt_data->fw_journal = NULL;
+		}
+		// release path of control interface
+		if (p_dev->pvt_data->fw_ctrl) {
+			free(p_dev->pvt_data->fw_ctrl);
+			p_dev->pvt_data->fw_ctrl = NULL;
+		}
+		// release path of limits
+		if (p_dev->pvt_data->bist_limits) {
+			free(p_dev->pvt_data->bist_limits);
+			p_dev->pvt_data->bist_limits = NULL;
+		}
+		// release path of PDT cache
+		if (p_dev->pvt_data->pdt_cache) {
+			free(p_dev->pvt_data->pdt_cache);
+			p_dev->pvt_data->pdt_cache = NULL;
+		}
+		// release private data
+		free(p_dev->pvt_data);
+		p_dev->pvt_data = NULL;
+	}
+
+	// release mtouch device
+	free(p_dev);
+}
+
+/*
+ * release all contacts and deliver the lifting frame
+ * the caller must hold the thread_mutex
+ *
+ * syna_dev_t *dev   : mtouch device instance data
+ */
+static void mtouch_release_contacts(syna_dev_t *dev)
+{
+	unsigned int i;
+	uint64_t now;
+
+	if (!dev->touch_report)
+		return;
+
+	for (i = 0; i < dev->rmi4_data->num_of_fingers; i++)
+		dev->touch_report[i].is_touched = FINGER_LIFTING;
+	dev->touch_count = 0;
+	dev->button_state = 0;
+	dev->large_object = false;
+
+	if (dev->resample) {
+		synaptics_mtouch_resample_reset(dev->resample);
+		mtouch_resample_arm(dev, false);
+	}
+
+	ClockTime(CLOCK_MONOTONIC, NULL, &now);
+	mtouch_deliver_packet(dev, dev->touch_report, MTOUCH_PARSER_FLAG_NONE, now);
+}
+
+/*
+ * update the state of the firmware update reported by the control interface
+ *
+ * syna_dev_t *dev   : mtouch device instance data
+ * enum mtouch_fwu_state state: the new state
+ * int result        : EOK, or the negative errno of the failed update
+ */
+static void mtouch_fwu_set_state(syna_dev_t *dev, enum mtouch_fwu_state state, int result)
+{
+	pthread_mutex_lock(&dev->fwu_mutex);
+
+	dev->fwu_state = state;
+	dev->fwu_result = result;
+
+	// the final states are set once by the worker, a new request is accepted from then on
+	if (state > FWU_STATE_PROGRAMMING)
+		dev->fwu_running = false;
+
+	pthread_mutex_unlock(&dev->fwu_mutex);
+}
+
+/*
+ * hand the device over to the firmware update
+ * called by the reflash right before the device enters the bootloader mode,
+ * the touch is reported with the current firmware until here
+ *
+ * void* arg         : the mtouch device instance data, syna_dev_t
+ */
+static void mtouch_fwu_handoff(void* arg)
+{
+	syna_dev_t *dev = (syna_dev_t *)arg;
+	private_data_t *pvt_data = dev->pvt_data;
+	int retval;
+
+	// hand over from the interrupt handling thread
+	// the interrupt keeps running, the flash completion is signalled by the attention
+	pthread_mutex_lock (&pvt_data->thread_mutex);
+
+	mtouch_release_contacts(dev);
+
+	retval = synaptics_rmi4_fwu_attn_enable(true);
+	if (retval < 0) {
+		// poll the flash status instead
+		mtouch_irq_enable(dev, false);
+	}
+	dev->fwu_flashing = true;
+
+	pthread_mutex_unlock (&pvt_data->thread_mutex);
+
+	mtouch_fwu_set_state(dev, FWU_STATE_PROGRAMMING, EOK);
+}
+
+/*
+ * implement the background firmware update
+ * the routine is created by the pthtead_create() in mtouch_request_fwu(),
+ * at the startup or on the request of the control interface
+ *
+ * the image is loaded and compared with the device while the touch keeps working
+ * on the current firmware. the interrupt handling is suspended by the
+ * mtouch_fwu_handoff() right before the device enters the bootloader mode, and
+ * the driver is reattached to the Input Events library with the parameters of
+ * the new firmware.
+ *
+ * void* args        : the mtouch device instance data, syna_dev_t
+ */
+static void* mtouch_fwu_thread(void* args)
+{
+	syna_dev_t *dev = (syna_dev_t *)args;
+	private_data_t *pvt_data = dev->pvt_data;
+	int retval;
+
+	synaptics_rmi4_fwu_set_journal(pvt_data->fw_journal);
+	synaptics_rmi4_fwu_set_handoff(mtouch_fwu_handoff, dev);
+
+	retval = synaptics_rmi4_fwu_check_update(pvt_data->fw_image_path,
+											pvt_data->fw_image_id);
+	if (retval < 0) {
+		mtouch_error(MTOUCH_DEV, "%s: fail to check the fw update", __FUNCTION__);
+		mtouch_fwu_set_state(dev, FWU_STATE_FAILED, retval);
+		return ( 0 );
+	}
+	if (0 == retval) {
+		mtouch_info(MTOUCH_DEV, "%s: firmware is up to date", __FUNCTION__);
+		mtouch_fwu_set_state(dev, FWU_STATE_UP_TO_DATE, EOK);
+		return ( 0 );
+	}
+
+	retval = synaptics_rmi4_fwu_updater(pvt_data->fw_image_path,
+										pvt_data->fw_image_id);
+	if (retval < 0) {
+		mtouch_error(MTOUCH_DEV, "%s: fail to do fw update", __FUNCTION__);
+	}
+
+	pthread_mutex_lock (&pvt_data->thread_mutex);
+
+	// nothing to restore, if the update failed before the hand-over
+	if (dev->fwu_flashing) {
+		dev->fwu_flashing = false;
+		synaptics_rmi4_fwu_attn_enable(false);
+
+		// the stages sized by the device are re-created for the new firmware
+		if (dev->filter) {
+			synaptics_mtouch_filter_destroy(dev->filter);
+			dev->filter = synaptics_mtouch_filter_create(pvt_data->filter_iir,
+													pvt_data->filter_one_euro,
+													pvt_data->filter_hysteresis,
+													pvt_data->predict_horizon,
+													dev->rmi4_data->sensor_max_x,
+													dev->rmi4_data->sensor_max_y);
+		}
+		if (dev->resample) {
+			synaptics_mtouch_resample_destroy(dev->resample);
+			dev->resample = synaptics_mtouch_resample_create(pvt_data->resample_rate,
+														pvt_data->resample_delay,
+														dev->rmi4_data->num_of_fingers);
+		}
+
+		// re-connect to the input event framework
+		// to update the maximum finger supported
+		mtouch_driver_detach(dev->inputevents_hdl);
+		dev->inputevents_hdl = NULL;
+		if (mtouch_attach_dev(dev) < 0) {
+			mtouch_error(MTOUCH_DEV, "%s: fail to re-connect to the input event framework", __FUNCTION__);
+			if (EOK == retval)
+				retval = -EIO;
+		}
+
+		// enable the hardware interrupt, which may be held masked since the reinit
+		mtouch_irq_enable(dev, true);
+	}
+
+	pthread_mutex_unlock (&pvt_data->thread_mutex);
+
+	mtouch_fwu_set_state(dev, (retval < 0) ? FWU_STATE_FAILED : FWU_STATE_DONE, retval);
+
+	mtouch_info(MTOUCH_DEV, "%s: finished", __FUNCTION__);
+
+	return ( 0 );
+}
+
+/*
+ * run one stage of the recovery
+ * the caller must hold the thread_mutex
+ *
+ * syna_dev_t *dev   : mtouch device instance data
+ * enum mtouch_recovery_stage stage: the stage to run
+ *
+ * return EOK: success
+ * otherwise, fail
+ */
+static int mtouch_health_recover(syna_dev_t *dev, enum mtouch_recovery_stage stage)
+{
+	int retval;
+
+	switch (stage) {
+	case RECOVERY_REINIT:
+		retval = synaptics_rmi4_restore_settings(dev->rmi4_data);
+		break;
+
+	case RECOVERY_SOFT_RESET:
+		// disable the hardware to skip the interrupt of the reset
+		mtouch_irq_enable(dev, false);
+		retval = synaptics_rmi4_reinit();
+		mtouch_irq_enable(dev, true);
+		break;
+
+	case RECOVERY_POWER_CYCLE:
+		// without the power control, the stage would be another soft reset
+		retval = mtouch_power_off();
+		if (-ENOTSUP == retval)
+			return retval;
+
+		mtouch_irq_enable(dev, false);
+		if (EOK == retval) {
+			usleep(POWER_OFF_DELAY * 1000);
+			retval = mtouch_power_on();
+		}
+		if (EOK == retval) {
+			usleep(POWER_ON_DELAY * 1000);
+			retval = synaptics_rmi4_reinit();
+		}
+		mtouch_irq_enable(dev, true);
+		break;
+
+	default:
+		retval = -EINVAL;
+		break;
+	}
+
+	if (EOK != retval)
+		return retval;
+
+	// the recovery must leave the controller healthy
+	retval = synaptics_rmi4_check_health(dev->rmi4_data);
+	if (HEALTH_OK != retval)
+		return -EIO;
+
+	return EOK;
+}
+
+/*
+ * implement the health monitor
+ * the routine is created by the pthtead_create() in mtouch_driver_init()
+ *
+ * a low-priority watchdog, the controller is checked at every health_interval,
+ * only if no interrupt has arrived for health_idle. the pending interrupt status
+ * is serviced as in the interrupt handling, and regarded as the lost ATTN only
+ * if it is found at two checks in a row. a fault is recovered in stages,
+ * escalating to the next stage when the previous one fails:
+ *    - reinit, re-apply the interrupt enables and the configured bit
+ *    - soft reset, and rebuild the RMI4 device instance
+ *    - power-cycle through mtouch_power_off/on, and rebuild the RMI4 device instance,
+ *      skipped if the board has no power control
+ *
+ * void* args        : the mtouch device instance data, syna_dev_t
+ */
+static void* mtouch_health_thread(void* args)
+{
+	syna_dev_t *dev = (syna_dev_t *)args;
+	private_data_t *pvt_data = dev->pvt_data;
+	struct timespec ts;
+	uint64_t now;
+	uint64_t idle_since;
+	bool attn_pending = false;
+	int health;
+	int stage;
+	int retval;
+
+	pthread_mutex_lock(&dev->health_mutex);
+
+	while (!dev->health_stop) {
+
+		// wait for the interval, or the request to exit
+		ClockTime(CLOCK_MONOTONIC, NULL, &now);
+		nsec2timespec(&ts, now + (uint64_t)pvt_data->health_interval * 1000000);
+		pthread_cond_timedwait(&dev->health_cond, &dev->health_mutex, &ts);
+		if (dev->health_stop)
+			break;
+
+		// the interrupt handling or the fw update is in progress
+		// an update is refused while the controller is checked and recovered,
+		// the reinit re-creates the fwu handle. the fwu_mutex is held only to test
+		// and set the flags, the status of the update stays readable meanwhile
+		if (EOK != pthread_mutex_trylock(&pvt_data->thread_mutex))
+			continue;
+
+		// the frames are arriving, the timestamp is written by the interrupt handling
+		ClockTime(CLOCK_MONOTONIC, NULL, &now);
+		if (now - dev->timestamp < (uint64_t)pvt_data->health_idle * 1000000) {
+			pthread_mutex_unlock(&pvt_data->thread_mutex);
+			continue;
+		}
+
+		pthread_mutex_lock(&dev->fwu_mutex);
+		if (dev->fwu_running) {
+			pthread_mutex_unlock(&dev->fwu_mutex);
+			pthread_mutex_unlock(&pvt_data->thread_mutex);
+			continue;
+		}
+		dev->health_recovering = true;
+		pthread_mutex_unlock(&dev->fwu_mutex);
+
+		dev->health_stats.checks++;
+
+		health = synaptics_rmi4_check_health(dev->rmi4_data);
+
+		// the interrupt status is cleared by the read, the sources are serviced and
+		// reported so that a frame is not lost if the ATTN is asserted during the check
+		if (HEALTH_OK == health) {
+			idle_since = dev->timestamp;
+			dev->timestamp = now;
+
+			retval = synaptics_rmi4_sersor_report(dev->rmi4_data);
+			if (retval < 0) {
+				health = HEALTH_NO_RESPONSE;
+			}
+			else if (retval > 0) {
+				mtouch_report_sources(dev, retval);
+
+				if (attn_pending)
+					health = HEALTH_ATTN_LOST;
+				attn_pending = true;
+			}
+			else {
+				dev->timestamp = idle_since;
+				attn_pending = false;
+			}
+		}
+
+		if ((health > HEALTH_OK) && (health < HEALTH_MAX)) {
+			attn_pending = false;
+
+			dev->health_stats.faults[health]++;
+
+			mtouch_warn(MTOUCH_DEV, "%s: fault %d detected, start the recovery",
+						__FUNCTION__, health);
+
+			for (stage = RECOVERY_REINIT; stage < RECOVERY_STAGES; stage++) {
+				retval = mtouch_health_recover(dev, stage);
+				if (EOK == retval)
+					break;
+
+				if (-ENOTSUP == retval)
+					mtouch_info(MTOUCH_DEV, "%s: recovery stage %d is not available, skipped",
+								__FUNCTION__, stage);
+				else
+					mtouch_warn(MTOUCH_DEV, "%s: recovery stage %d failed", __FUNCTION__, stage);
+			}
+
+			if (stage < RECOVERY_STAGES) {
+				dev->health_stats.recoveries[stage]++;
+
+				mtouch_info(MTOUCH_DEV, "%s: recovered at stage %d", __FUNCTION__, stage);
+
+				mtouch_release_contacts(dev);
+			}
+			else {
+				dev->health_stats.failures++;
+
+				mtouch_error(MTOUCH_DEV, "%s: failed to recover the controller", __FUNCTION__);
+			}
+
+			// the next check starts over the idle period
+			ClockTime(CLOCK_MONOTONIC, NULL, &dev->timestamp);
+		}
+
+		pthread_mutex_lock(&dev->fwu_mutex);
+		dev->health_recovering = false;
+		pthread_mutex_unlock(&dev->fwu_mutex);
+
+		pthread_mutex_unlock(&pvt_data->thread_mutex);
+	}
+
+	pthread_mutex_unlock(&dev->health_mutex);
+
+	return ( 0 );
+}
+
+/*
+ * get the counters of the health monitor
+ *
+ * syna_dev_t *p_dev : mtouch device instance data
+ * struct mtouch_health_stats *stats: buffer to store the counters
+ *
+ * return EOK: success
+ * otherwise, fail
+ */
+int mtouch_get_health_stats(syna_dev_t *p_dev, struct mtouch_health_stats *stats)
+{
+	_CHECK_POINTER(p_dev);
+	_CHECK_POINTER(stats);
+
+	pthread_mutex_lock(&p_dev->pvt_data->thread_mutex);
+	memcpy(stats, &p_dev->health_stats, sizeof(struct mtouch_health_stats));
+	pthread_mutex_unlock(&p_dev->pvt_data->thread_mutex);
+
+	return EOK;
+}
+
+/*
+ * start the firmware update on the worker thread
+ * the touch is available until the device enters the bootloader mode
+ *
+ * syna_dev_t *p_dev : mtouch device instance data
+ * const char *path  : the path of the image file, NULL = the option "fw_img"
+ * unsigned int fw_id: the target firmware id, 0 = the firmware id in the image
+ *
+ * return EOK: the update is started
+ * return -EBUSY: an update is in progress, or the controller is being recovered
+ * otherwise, fail
+ */
+int mtouch_request_fwu(syna_dev_t *p_dev, const char *path, unsigned int fw_id)
+{
+	private_data_t *pvt_data;
+	int retval = EOK;
+
+	_CHECK_POINTER(p_dev);
+	_CHECK_POINTER(p_dev->pvt_data);
+
+	pvt_data = p_dev->pvt_data;
+
+	pthread_mutex_lock(&p_dev->fwu_mutex);
+
+	if (p_dev->fwu_running) {
+		mtouch_warn(MTOUCH_DEV, "%s: an update is in progress", __FUNCTION__);
+		retval = -EBUSY;
+		goto exit;
+	}
+
+	if (p_dev->health_recovering) {
+		mtouch_warn(MTOUCH_DEV, "%s: the controller is being recovered", __FUNCTION__);
+		retval = -EBUSY;
+		goto exit;
+	}
+
+	// the worker of the previous update has finished, release it
+	if (p_dev->fwu_active) {
+		pthread_join(p_dev->fwu_thread, NULL);
+		p_dev->fwu_active = false;
+	}
+
+	if (path) {
+		if (strlen(path) >= 256) {
+			mtouch_error(MTOUCH_DEV, "%s: path of image is too long", __FUNCTION__);
+			retval = -ENAMETOOLONG;
+			goto exit;
+		}
+
+		strcpy(pvt_data->fw_image_path, path);
+		pvt_data->fw_image_id = fw_id;
+	}
+
+	p_dev->fwu_running = true;
+	p_dev->fwu_state = FWU_STATE_CHECKING;
+	p_dev->fwu_result = EOK;
+
+	retval = pthread_create (&p_dev->fwu_thread, NULL, mtouch_fwu_thread, p_dev);
+	if (EOK != retval) {
+		mtouch_error(MTOUCH_DEV, "%s: failure in creating the fw update thread (error: %s)",
+					__FUNCTION__, strerror (retval));
+		retval = -retval;
+		p_dev->fwu_running = false;
+		p_dev->fwu_state = FWU_STATE_FAILED;
+		p_dev->fwu_result = retval;
+		goto exit;
+	}
+
+	pthread_setname_np(p_dev->fwu_thread, "mtouch-synaptics-fwu");
+	p_dev->fwu_active = true;
+
+	mtouch_info(MTOUCH_DEV, "%s: update with %s", __FUNCTION__, pvt_data->fw_image_path);
+
+exit:
+	pthread_mutex_unlock(&p_dev->fwu_mutex);
+
+	return retval;
+}
+
+/*
+ * get the status of the firmware update
+ *
+ * syna_dev_t *p_dev : mtouch device instance data
+ * struct mtouch_fwu_status *status: buffer to store the status
+ *
+ * return EOK: success
+ * otherwise, fail
+ */
+int mtouch_get_fwu_status(syna_dev_t *p_dev, struct mtouch_fwu_status *status)
+{
+	_CHECK_POINTER(p_dev);
+	_CHECK_POINTER(status);
+
+	pthread_mutex_lock(&p_dev->fwu_mutex);
+
+	status->state = p_dev->fwu_state;
+	status->result = p_dev->fwu_result;
+	status->firmware_id = p_dev->rmi4_data->firmware_id;
+
+	if (FWU_STATE_PROGRAMMING == status->state)
+		status->progress = synaptics_rmi4_fwu_get_progress();
+	else if (FWU_STATE_DONE == status->state)
+		status->progress = 100;
+	else
+		status->progress = 0;
+
+	pthread_mutex_unlock(&p_dev->fwu_mutex);
+
+	return EOK;
+}
+
+/*
+ * initialization callback function
+ *
+ * screen calls dlopen() on this specified driver.
+ * upon a successful dlopen(), Screen will use dlsym() to look for mtouch_driver_init()
+ * for driver initialization.
+ * performs the followings:
+ *    - set the default values of the driver
+ *    - parse any options specified in graphics.conf
+ *    - hardware initialization
+ *    - connect to input events library
+ *    - create a separate thread to communicate directly with the hardware
+ *      and trigger the input events library API function mtouch_driver_process_packet()
+ *      to start processing the touch-related event data.
+ */
+void *mtouch_driver_init(const char *options)
+{
+	int retval;
+	syna_dev_t *p_dev;
+	private_data_t *pvt_data;
+
+	// create the mtouch device instance and initialize the hardware
+	p_dev = mtouch_open_dev(options);
+	if (!p_dev) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to open the device", __FUNCTION__);
+		return NULL;
+	}
+	pvt_data = p_dev->pvt_data;
+
+	// create the driver-side filter chain
+	// the filter is left as NULL if all stages are disabled
+	p_dev->filter = synaptics_mtouch_filter_create(pvt_data->filter_iir,
+												pvt_data->filter_one_euro,
+												pvt_data->filter_hysteresis,
+												pvt_data->predict_horizon,
+												p_dev->rmi4_data->sensor_max_x,
+												p_dev->rmi4_data->sensor_max_y);
+
 	// attach to input events framework, libinputevents
 	// to configure mtouch_driver_funcs_t and mtouch_driver_params_t as well
 	retval = mtouch_attach_dev(p_dev);
@@ -632,6 +1643,22 @@ void *mtouch_driver_init(const char *options)
 	pvt_data->thread_event.sigev_coid = pvt_data->thread_coid;
 	pvt_data->thread_event.sigev_code = PULSE_CODE;
 
+	// create the display-synchronous resampling
+	// the timer sends a pulse to the interrupt handling thread at each display refresh
+	p_dev->resample = synaptics_mtouch_resample_create(pvt_data->resample_rate,
+													pvt_data->resample_delay,
+													p_dev->rmi4_data->num_of_fingers);
+	if (p_dev->resample) {
+		SIGEV_PULSE_INIT(&pvt_data->resample_event, pvt_data->thread_coid,
+						THREAD_PRIORITY, RESAMPLE_PULSE_CODE, 0);
+
+		if (timer_create(CLOCK_MONOTONIC, &pvt_data->resample_event, &pvt_data->resample_timer) == -1) {
+			mtouch_error(MTOUCH_DEV, "%s: failure in creating the resampling timer (error: %s)",
+						__FUNCTION__, strerror (errno));
+			goto exit;
+		}
+	}
+
 	// initialize a mutex for isr thread
     pthread_mutex_init (&pvt_data->thread_mutex, NULL);
 
@@ -663,44 +1690,74 @@ void *mtouch_driver_init(const char *options)
         goto exit;
     }
 
-	mtouch_info(MTOUCH_DEV, "%s: finished", __FUNCTION__);
-
+	// initialize a mutex for the fw update, which is shared with the health monitor
+	pthread_mutex_init (&p_dev->fwu_mutex, NULL);
+
+	// create the health monitor, a low-priority thread
+	// the control switch is defined in option "health_interval" in graphics.conf
+	if (pvt_data->health_interval) {
+		pthread_condattr_t condattr;
+		pthread_attr_t attr;
+		struct sched_param param;
+
+		pthread_mutex_init(&p_dev->health_mutex, NULL);
+		pthread_condattr_init(&condattr);
+		pthread_condattr_setclock(&condattr, CLOCK_MONOTONIC);
+		pthread_cond_init(&p_dev->health_cond, &condattr);
+		pthread_condattr_destroy(&condattr);
+
+		pthread_attr_init(&attr);
+		pthread_attr_setschedpolicy(&attr, SCHED_RR);
+		param.sched_priority = HEALTH_THREAD_PRIORITY;
+		pthread_attr_setschedparam(&attr, &param);
+		pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+
+		retval = pthread_create (&p_dev->health_thread, &attr, mtouch_health_thread, p_dev);
+		pthread_attr_destroy(&attr);
+		if (EOK != retval) {
+			mtouch_error(MTOUCH_DEV, "%s: failure in creating the health monitor (error: %s)",
+						__FUNCTION__, strerror (retval));
+			pthread_cond_destroy(&p_dev->health_cond);
+			pthread_mutex_destroy(&p_dev->health_mutex);
+		}
+		else {
+			pthread_setname_np(p_dev->health_thread, "mtouch-synaptics-health");
+			p_dev->health_active = true;
+		}
+	}
 
 	// call firmware updating if it is necessary
 	// the control switch is defined in option "fw_update_startup" in graphics.conf
 	// 1: enabled; 0: disabled
+	// the update runs in the background, the touch is available with the current firmware
 	if (p_dev->pvt_data->fw_update_startup) {
+		mtouch_request_fwu(p_dev, NULL, 0);
+	}
 
-		// disable the hardware to skip all interrupt event during the process
-		mtouch_irq_enable(p_dev, false);
-
-		retval = synaptics_rmi4_fwu_updater(p_dev->pvt_data->fw_image_path,
-											p_dev->pvt_data->fw_image_id);
-		if (retval < 0) {
-	    	mtouch_error(MTOUCH_DEV, "%s: fail to do fw update",
-	    				__FUNCTION__);
-	    	goto exit;
-	    }
-
-		// enable the hardware interrupt
-		mtouch_irq_enable(p_dev, true);
-
-		// re-connect to the input event framework
-		// to update the maximum finger supported
-		mtouch_driver_detach(p_dev->inputevents_hdl);
-		p_dev->inputevents_hdl = NULL;
-		retval = mtouch_attach_dev(p_dev);
-		if (retval < 0) {
-			mtouch_error(MTOUCH_DEV, "%s: fail to re-connect to the input event framework", __FUNCTION__);
-	    	goto exit;
-		}
-
+	// create the control interface to request the update at runtime
+	// the path is defined in option "fw_ctrl" in graphics.conf
+	if (pvt_data->fw_ctrl[0] != '\0') {
+		p_dev->control = synaptics_mtouch_control_create(p_dev, pvt_data->fw_ctrl);
 	}
 
+	mtouch_info(MTOUCH_DEV, "%s: finished", __FUNCTION__);
 
 	return p_dev;
 
 exit:
+	// release the resampling
+	if (p_dev->pvt_data->resample_timer != (timer_t)-1) {
+		timer_delete(p_dev->pvt_data->resample_timer);
+	}
+	if (p_dev->resample) {
+		synaptics_mtouch_resample_destroy(p_dev->resample);
+		p_dev->resample = NULL;
+	}
+	// release the copy of last delivered frame
+	if (p_dev->last_report) {
+		free(p_dev->last_report);
+		p_dev->last_report = NULL;
+	}
 	// break the connection
 	if (p_dev->pvt_data->thread_coid != -1) {
 		ConnectDetach(p_dev->pvt_data->thread_coid);
@@ -714,36 +1771,13 @@ exit:
 		mtouch_driver_detach(p_dev->inputevents_hdl);
 		p_dev->inputevents_hdl = NULL;
 	}
-	// release the RMI4 device
-	if (p_dev->flag != FLAG_UNKNOWN) {
-		synaptics_rmi4_deinit(p_dev);
-		p_dev->rmi4_data = NULL;
-
-		p_dev->flag = FLAG_UNKNOWN;
-	}
-	// close i2c interface
-	if (p_dev->pvt_data->i2c_fd != -1) {
-		close(p_dev->pvt_data->i2c_fd);
-	}
-	if (p_dev->pvt_data->i2c) {
-		free(p_dev->pvt_data->i2c);
-		p_dev->pvt_data->i2c = NULL;
-	}
-	// release path of image
-	if (p_dev->pvt_data->fw_image_path) {
-		free(p_dev->pvt_data->fw_image_path);
-		p_dev->pvt_data->fw_image_path = NULL;
-	}
-	// release private data
-	if (p_dev->pvt_data) {
-		free(p_dev->pvt_data);
-		p_dev->pvt_data = NULL;
-	}
-	// release mtouch device
-	if (p_dev) {
-		free(p_dev);
-		p_dev = NULL;
+	// release the filter chain
+	if (p_dev->filter) {
+		synaptics_mtouch_filter_destroy(p_dev->filter);
+		p_dev->filter = NULL;
 	}
+	// release the RMI4 device, i2c interface and the mtouch device
+	mtouch_close_dev(p_dev);
 
 	return NULL;
 }
@@ -758,6 +1792,33 @@ void mtouch_driver_fini(void *dev)
 {
 	syna_dev_t *p_dev = (syna_dev_t *)dev;
 
+	// no more update is requested
+	if (p_dev->control) {
+		synaptics_mtouch_control_destroy(p_dev->control);
+		p_dev->control = NULL;
+	}
+
+	// wait for the background firmware update, a reflash must not be interrupted
+	if (p_dev->fwu_active) {
+		pthread_join(p_dev->fwu_thread, NULL);
+		p_dev->fwu_active = false;
+	}
+
+	// stop the health monitor
+	if (p_dev->health_active) {
+		pthread_mutex_lock(&p_dev->health_mutex);
+		p_dev->health_stop = true;
+		pthread_cond_signal(&p_dev->health_cond);
+		pthread_mutex_unlock(&p_dev->health_mutex);
+
+		pthread_join(p_dev->health_thread, NULL);
+		pthread_cond_destroy(&p_dev->health_cond);
+		pthread_mutex_destroy(&p_dev->health_mutex);
+		p_dev->health_active = false;
+	}
+
+	pthread_mutex_destroy(&p_dev->fwu_mutex);
+
     // power-off
 	mtouch_power_off();
 
@@ -765,36 +1826,32 @@ void mtouch_driver_fini(void *dev)
     pthread_cancel(p_dev->isr_thread);
     pthread_join(p_dev->isr_thread, NULL);
 
-	// release the RMI4 device
-	synaptics_rmi4_deinit(p_dev);
-	p_dev->rmi4_data = NULL;
-	p_dev->flag = FLAG_UNKNOWN;
-
-	// detach from the input event framework
-	if (p_dev->inputevents_hdl) {
-		mtouch_driver_detach(p_dev->inputevents_hdl);
-		p_dev->inputevents_hdl = NULL;
+	// release the filter chain
+	if (p_dev->filter) {
+		synaptics_mtouch_filter_destroy(p_dev->filter);
+		p_dev->filter = NULL;
 	}
-	// close i2c interface
-	close(p_dev->pvt_data->i2c_fd);
 
-	if (p_dev->pvt_data->i2c) {
-		free(p_dev->pvt_data->i2c);
-		p_dev->pvt_data->i2c = NULL;
+	// release the resampling
+	if (p_dev->pvt_data->resample_timer != (timer_t)-1) {
+		timer_delete(p_dev->pvt_data->resample_timer);
 	}
-	// release path of fw image
-	if (p_dev->pvt_data->fw_image_path) {
-		free(p_dev->pvt_data->fw_image_path);
-		p_dev->pvt_data->fw_image_path = NULL;
+	if (p_dev->resample) {
+		synaptics_mtouch_resample_destroy(p_dev->resample);
+		p_dev->resample = NULL;
 	}
-	// release private data
-	if (p_dev->pvt_data) {
-		free(p_dev->pvt_data);
-		p_dev->pvt_data = NULL;
+
+	// release the copy of last delivered frame
+	if (p_dev->last_report) {
+		free(p_dev->last_report);
+		p_dev->last_report = NULL;
 	}
-	// release mtouch device
-	if (p_dev) {
-		free(p_dev);
-		p_dev = NULL;
+
+	// detach from the input event framework
+	if (p_dev->inputevents_hdl) {
+		mtouch_driver_detach(p_dev->inputevents_hdl);
+		p_dev->inputevents_hdl = NULL;
 	}
+	// release the RMI4 device, i2c interface and the mtouch device
+	mtouch_close_dev(p_dev);
 }
@@ -65,9 +65,11 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <malloc.h>
+#include <limits.h>
 
 #include <sys/mman.h>
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <sys/dcmd_input.h>
 #include <sys/neutrino.h>
 #include <sys/time.h>
@@ -81,6 +83,9 @@
 #include "input/parseopts.h"
 
 #include "synaptics_rmi4_core.h"
+#include "synaptics_mtouch_filter.h"
+#include "synaptics_mtouch_resample.h"
+#include "synaptics_rmi4_f54.h"
 
 /* touch screen interrupt, connected to GPIO_39 */
 #define GPIO_ATTN				(39)
@@ -88,9 +93,19 @@
 
 /* thread priority */
 #define THREAD_PRIORITY			(21)
+#define HEALTH_THREAD_PRIORITY	(10)
+
+/* health monitor defaults, in ms, the monitor is disabled unless health_interval is given */
+#define HEALTH_INTERVAL			(0)
+#define HEALTH_IDLE				(2000)
+
+/* settle times of the power-cycle, in ms */
+#define POWER_OFF_DELAY			(100)
+#define POWER_ON_DELAY			(200)
 
 /* the pulse code sent to ISR */
 #define PULSE_CODE        1
+#define RESAMPLE_PULSE_CODE 2
 
 /* string shown for the mtouch_log */
 #define MTOUCH_DEV				"mtouch-synaptics"
@@ -133,6 +148,22 @@ typedef struct _private_data
 	struct sigevent    	 thread_event;
 	pthread_mutex_t    	 thread_mutex;
 
+	// Resampling related stuff
+	// resample_timer: the timer to deliver the touch report on the display cadence
+	// resample_event: the pulse sent to the interrupt handling thread at each refresh
+	// resample_armed: the timer is running
+	// resample_rate: the delivery cadence in Hz, 0 = deliver on every interrupt
+	// resample_delay: distance between the delivery and the interpolated time in us,
+	//                 0 = estimated report interval
+	// resample_phase: time of a display refresh on CLOCK_MONOTONIC modulo the period, in us,
+	//                 the timer is aligned to it each time it is started
+	timer_t				 resample_timer;
+	struct sigevent		 resample_event;
+	bool				 resample_armed;
+	unsigned int		 resample_rate;
+	unsigned int		 resample_delay;
+	unsigned int		 resample_phase;
+
 	// GPIO related stuff
 	// gpio_attn: the gpio pin defined as the attn
 	unsigned       		 gpio_attn;
@@ -151,9 +182,60 @@ typedef struct _private_data
 	// fw_update_startup: flag to perform fw update during the startup
 	// fw_image: the path of target fw image file
 	// fw_image_id: the target firmware id
+	// fw_journal: the path of the file recording the progress of the reflash, empty = disabled
+	// fw_ctrl: the path of the control interface of the runtime update, empty = disabled
 	unsigned int		 fw_update_startup;
 	char				*fw_image_path;
 	unsigned int		 fw_image_id;
+	char				*fw_journal;
+	char				*fw_ctrl;
+
+	// touch report related stuff
+	// palm_suppression: flag to cancel and suppress the report while a palm is detected
+	// filter_iir: weight of the new sample in the iir smoothing stage, in 1/256
+	// filter_one_euro: speed coefficient of the one-euro smoothing stage
+	// filter_hysteresis: deadband of the hysteresis stage, in sensor units
+	// predict_horizon: time to extrapolate the contacts forward, in us
+	unsigned int		 palm_suppression;
+	unsigned int		 filter_iir;
+	unsigned int		 filter_one_euro;
+	unsigned int		 filter_hysteresis;
+	unsigned int		 predict_horizon;
+
+	// frame_dedup: flag to skip the frame unchanged from the last delivered one
+	// dedup_position: deadband of the position, in sensor units
+	// dedup_size: deadband of the touch width, in sensor units
+	// dedup_keepalive: the maximum time without delivery while contacts are down, in ms
+	unsigned int		 frame_dedup;
+	unsigned int		 dedup_position;
+	unsigned int		 dedup_size;
+	unsigned int		 dedup_keepalive;
+
+	// diagnostics related stuff
+	// f54_capture: the capture mode of the F$54 analog data, enum f54_capture_mode
+	// f54_interval: the interval between the captures, in ms
+	// f54_depth: number of frames kept in the shared-memory ring
+	unsigned int		 f54_capture;
+	unsigned int		 f54_interval;
+	unsigned int		 f54_depth;
+
+	// test interface related stuff
+	// bist_min: lower limit of the full raw capacitance, applied to every node
+	// bist_max: upper limit of the full raw capacitance, applied to every node
+	// bist_limits: the path of the file with the limits of each node
+	unsigned int		 bist_min;
+	unsigned int		 bist_max;
+	char				*bist_limits;
+
+	// health monitor related stuff
+	// health_interval: the interval between the checks, in ms, 0 = disabled
+	// health_idle: time without interrupt before the controller is checked, in ms
+	unsigned int		 health_interval;
+	unsigned int		 health_idle;
+
+	// startup related stuff
+	// pdt_cache: the path of the file to cache the RMI function map, empty = disabled
+	char				*pdt_cache;
 
 } private_data_t;
 
@@ -174,6 +256,49 @@ struct touch_report_t {
 };
 
 
+/*
+ * stages of the recovery run by the health monitor, in the order of escalation
+ */
+enum mtouch_recovery_stage {
+	RECOVERY_REINIT = 0,	// re-apply the interrupt enables and the configured bit
+	RECOVERY_SOFT_RESET,	// soft reset and rebuild the RMI4 device instance
+	RECOVERY_POWER_CYCLE,	// power off/on and rebuild the RMI4 device instance
+	RECOVERY_STAGES,
+};
+
+/*
+ * counters of the health monitor
+ */
+struct mtouch_health_stats {
+	unsigned int checks;						// number of checks performed
+	unsigned int faults[HEALTH_MAX];			// faults detected, by enum synaptics_rmi4_health
+	unsigned int recoveries[RECOVERY_STAGES];	// recoveries completed at each stage
+	unsigned int failures;						// recoveries failed at all stages
+};
+
+/*
+ * states of the firmware update, reported by the control interface
+ */
+enum mtouch_fwu_state {
+	FWU_STATE_IDLE = 0,		// no update requested
+	FWU_STATE_CHECKING,		// the image is compared with the device, the touch is available
+	FWU_STATE_PROGRAMMING,	// the device is handed over to the reflash, the touch is suspended
+	FWU_STATE_UP_TO_DATE,	// the device runs the image already, nothing is programmed
+	FWU_STATE_DONE,			// the device is programmed and reattached
+	FWU_STATE_FAILED,		// the update is failed, see the result
+	FWU_STATE_MAX,
+};
+
+/*
+ * status of the firmware update
+ */
+struct mtouch_fwu_status {
+	enum mtouch_fwu_state state;
+	unsigned int progress;		// the programmed blocks in percent
+	int result;					// EOK, or the negative errno of the failed update
+	unsigned int firmware_id;	// the firmware id of the device
+};
+
 /*
  * mtouch device instance data
  *
@@ -201,6 +326,67 @@ typedef struct {
 	struct touch_report_t 		*touch_report;
 	int 						 touch_count;
 
+	// time of the latest interrupt, in nanoseconds
+	uint64_t					 timestamp;
+
+	// driver-side filter chain, NULL if all stages are disabled
+	struct synaptics_mtouch_filter *filter;
+
+	// display-synchronous resampling, NULL if it is disabled
+	struct synaptics_mtouch_resample *resample;
+
+	// the last frame delivered to the Input Events library
+	// last_report: copy of the frame, used by the unchanged-frame suppression
+	// last_count: number of contacts in the last_report
+	// last_delivery: time of the delivery, in nanoseconds
+	struct touch_report_t 		*last_report;
+	unsigned int				 last_count;
+	uint64_t					 last_delivery;
+
+	// state of the 0D capacitive buttons, one bit per button
+	// button_state: latest state collected from the F$1A
+	// last_button_state: state in the last delivered frame
+	unsigned int				 button_state;
+	unsigned int				 last_button_state;
+
+	// large object handling
+	// large_object: a palm or large object is on the sensor, report is suppressed until it lifts
+	// parser_flags: flags passed to the Input Events library along with the next packet
+	bool						 large_object;
+	unsigned int				 parser_flags;
+
+	// background firmware update
+	// fwu_thread: the worker checking and applying the update, at the startup or on request
+	// fwu_active: the worker is created and must be joined
+	// fwu_flashing: the device is owned by the update, the attention is routed to it
+	// fwu_mutex: protects the fwu_running, health_recovering, fwu_state and fwu_result
+	// fwu_running: the worker has not finished yet, a new request is refused
+	// health_recovering: the health monitor is checking or recovering the controller,
+	//                    a new request is refused
+	// fwu_state, fwu_result: the status of the latest update
+	// control: the control interface of the runtime update, NULL if it is disabled
+	pthread_t					 fwu_thread;
+	bool						 fwu_active;
+	bool						 fwu_flashing;
+	pthread_mutex_t				 fwu_mutex;
+	bool						 fwu_running;
+	bool						 health_recovering;
+	enum mtouch_fwu_state		 fwu_state;
+	int							 fwu_result;
+	struct synaptics_mtouch_control *control;
+
+	// health monitor
+	// health_thread: the low-priority watchdog checking the idle controller
+	// health_active: the watchdog is created and must be joined
+	// health_stop: request the watchdog to exit, signalled by the health_cond
+	// health_stats: the counters, protected by the thread_mutex
+	pthread_t					 health_thread;
+	bool						 health_active;
+	bool						 health_stop;
+	pthread_mutex_t				 health_mutex;
+	pthread_cond_t				 health_cond;
+	struct mtouch_health_stats	 health_stats;
+
 } syna_dev_t;
 
 
@@ -211,6 +397,25 @@ typedef struct {
 int mtouch_i2c_read(syna_dev_t *dev, uint8_t addr, uint16_t len, uint8_t *data);
 int mtouch_i2c_write(syna_dev_t *dev, uint8_t addr, uint16_t len, uint8_t *data);
 
+/*
+ * helper function to create and release the mtouch device instance
+ * shared by the driver interface and the test interface
+ */
+syna_dev_t *mtouch_open_dev(const char *options);
+void mtouch_close_dev(syna_dev_t *p_dev);
+
+/*
+ * helper function to get the counters of the health monitor
+ */
+int mtouch_get_health_stats(syna_dev_t *p_dev, struct mtouch_health_stats *stats);
+
+/*
+ * helper function to start the firmware update at runtime, and to get its status
+ * shared by the driver interface and the control interface
+ */
+int mtouch_request_fwu(syna_dev_t *p_dev, const char *path, unsigned int fw_id);
+int mtouch_get_fwu_status(syna_dev_t *p_dev, struct mtouch_fwu_status *status);
+
 
 /* to check null pointer  */
 #define _CHECK_POINTER(_in_ptr) \
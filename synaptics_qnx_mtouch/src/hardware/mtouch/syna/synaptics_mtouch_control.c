@@ -0,0 +1,361 @@
+/*
+ * $QNXLicenseC:
+ * Copyright 2010, QNX Software Systems.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You
+ * may not reproduce, modify or distribute this software except in
+ * compliance with the License. You may obtain a copy of the License
+ * at: http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OF ANY KIND, either express or implied.
+ *
+ * This file may contain contributions from others, either as
+ * contributors under the License or as licensors under other terms.
+ * Please review this entire file for other proprietary rights or license
+ * notices, as well as the QNX Development Suite License Guide at
+ * http://licensing.qnx.com/license-guide/ for other information.
+ * $
+ */
+
+/*
+ * Synaptics Touchscreen driver
+ *
+ * Copyright (C) 2012-2018 Synaptics Incorporated. All rights reserved.
+ *
+ * The hardware access library is included from QNX software, and the
+ * mtouch framework is also included from install/usr/input/. Both of
+ * libraries are under Apache-2.0.
+ *
+ * Synaptics Touchscreen driver is interacted with QNX software system
+ * as a touchscreen controller, for its licensing rule and related notices,
+ * please scroll down the text to browse all of it.
+ *
+ * INFORMATION CONTAINED IN THIS DOCUMENT IS PROVIDED "AS-IS," AND SYNAPTICS
+ * EXPRESSLY DISCLAIMS ALL EXPRESS AND IMPLIED WARRANTIES, INCLUDING ANY
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE,
+ * AND ANY WARRANTIES OF NON-INFRINGEMENT OF ANY INTELLECTUAL PROPERTY RIGHTS.
+ * IN NO EVENT SHALL SYNAPTICS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, PUNITIVE, OR CONSEQUENTIAL DAMAGES ARISING OUT OF OR IN CONNECTION
+ * WITH THE USE OF THE INFORMATION CONTAINED IN THIS DOCUMENT, HOWEVER CAUSED
+ * AND BASED ON ANY THEORY OF LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, AND EVEN IF SYNAPTICS WAS ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE. IF A TRIBUNAL OF COMPETENT JURISDICTION DOES
+ * NOT PERMIT THE DISCLAIMER OF DIRECT DAMAGES OR ANY OTHER DAMAGES, SYNAPTICS'
+ * TOTAL CUMULATIVE LIABILITY TO ANY PARTY SHALL NOT EXCEED ONE HUNDRED U.S.
+ * DOLLARS.
+ *
+ */
+
+#include "synaptics_mtouch.h"
+#include "synaptics_mtouch_control.h"
+
+
+/*
+ * names of enum mtouch_fwu_state, as reported in the status line
+ */
+static const char * const control_state_names[FWU_STATE_MAX] = {
+	"idle",
+	"checking",
+	"programming",
+	"up-to-date",
+	"done",
+	"failed",
+};
+
+/*
+ * handler of the read message
+ * return one status line of the firmware update
+ *
+ *    state=<state> progress=<percent> result=<errno> firmware_id=<id>
+ *
+ * resmgr_context_t *ctp: the resource manager context
+ * io_read_t *msg: the read message
+ * RESMGR_OCB_T *ocb: the open control block
+ *
+ * return _RESMGR_NOREPLY: replied with the data
+ * otherwise, the errno replied to the client
+ */
+static int synaptics_mtouch_control_read(resmgr_context_t *ctp, io_read_t *msg, RESMGR_OCB_T *ocb)
+{
+	struct synaptics_mtouch_control *control = (struct synaptics_mtouch_control *)ocb->attr;
+	struct mtouch_fwu_status status;
+	char line[CONTROL_STATUS_SIZE];
+	size_t length;
+	size_t nbytes = 0;
+	int retval;
+
+	retval = iofunc_read_verify(ctp, msg, ocb, NULL);
+	if (EOK != retval)
+		return retval;
+
+	if ((msg->i.xtype & _IO_XTYPE_MASK) != _IO_XTYPE_NONE)
+		return ENOSYS;
+
+	retval = mtouch_get_fwu_status(control->dev, &status);
+	if (retval < 0)
+		return -retval;
+
+	retval = snprintf(line, sizeof(line), "state=%s progress=%u result=%d firmware_id=%u\n",
+					(status.state < FWU_STATE_MAX) ? control_state_names[status.state] : "unknown",
+					status.progress, status.result, status.firmware_id);
+	length = (retval < (int)sizeof(line)) ? (size_t)retval : sizeof(line) - 1;
+
+	// one status line per open, the reader stops at the end of it
+	if (ocb->offset < (off_t)length) {
+		nbytes = length - (size_t)ocb->offset;
+		if (nbytes > msg->i.nbytes)
+			nbytes = msg->i.nbytes;
+	}
+
+	_IO_SET_READ_NBYTES(ctp, nbytes);
+
+	if (nbytes) {
+		MsgReply(ctp->rcvid, nbytes, line + ocb->offset, nbytes);
+
+		ocb->offset += nbytes;
+		ocb->attr->flags |= IOFUNC_ATTR_ATIME;
+	}
+	else {
+		MsgReply(ctp->rcvid, 0, NULL, 0);
+	}
+
+	return _RESMGR_NOREPLY;
+}
+
+/*
+ * handler of the write message
+ * request the firmware update with the image, "<path> [<fw_id>]"
+ * the fw_id is optional, the firmware id in the image is used by default
+ *
+ * resmgr_context_t *ctp: the resource manager context
+ * io_write_t *msg: the write message
+ * RESMGR_OCB_T *ocb: the open control block
+ *
+ * return _RESMGR_NPARTS(0): the update is started
+ * otherwise, the errno replied to the client, EBUSY if an update is in progress
+ */
+static int synaptics_mtouch_control_write(resmgr_context_t *ctp, io_write_t *msg, RESMGR_OCB_T *ocb)
+{
+	struct synaptics_mtouch_control *control = (struct synaptics_mtouch_control *)ocb->attr;
+	char request[CONTROL_REQUEST_SIZE];
+	char *path;
+	char *id;
+	char *end;
+	unsigned int fw_id = 0;
+	size_t nbytes;
+	int retval;
+
+	retval = iofunc_write_verify(ctp, msg, ocb, NULL);
+	if (EOK != retval)
+		return retval;
+
+	if ((msg->i.xtype & _IO_XTYPE_MASK) != _IO_XTYPE_NONE)
+		return ENOSYS;
+
+	nbytes = _IO_WRITE_GET_NBYTES(msg);
+	if (nbytes >= sizeof(request))
+		return ENAMETOOLONG;
+
+	if (resmgr_msgread(ctp, request, nbytes, sizeof(msg->i)) != (int)nbytes)
+		return EIO;
+	request[nbytes] = '\0';
+
+	// the newline appended by the echo is dropped
+	request[strcspn(request, "\r\n")] = '\0';
+
+	path = request;
+	id = strpbrk(request, " \t");
+	if (id) {
+		*id++ = '\0';
+		id += strspn(id, " \t");
+		if ('\0' != *id) {
+			fw_id = (unsigned int)strtoul(id, &end, 0);
+			if ('\0' != *end) {
+				mtouch_error(MTOUCH_DEV, "%s: invalid firmware id %s", __FUNCTION__, id);
+				return EINVAL;
+			}
+		}
+	}
+
+	if ('/' != path[0]) {
+		mtouch_error(MTOUCH_DEV, "%s: the full path of the image is expected", __FUNCTION__);
+		return EINVAL;
+	}
+
+	retval = mtouch_request_fwu(control->dev, path, fw_id);
+	if (retval < 0)
+		return -retval;
+
+	_IO_SET_WRITE_NBYTES(ctp, nbytes);
+
+	if (nbytes)
+		ocb->attr->flags |= IOFUNC_ATTR_MTIME | IOFUNC_ATTR_CTIME;
+
+	return _RESMGR_NPARTS(0);
+}
+
+/*
+ * implement the control thread
+ * the routine is created by the pthread_create() in synaptics_mtouch_control_create()
+ *
+ * the messages are handled with the cancellation disabled,
+ * the thread is cancelled only while it waits for the next message
+ *
+ * void* arg: the control interface, struct synaptics_mtouch_control
+ */
+static void* synaptics_mtouch_control_thread(void* arg)
+{
+	struct synaptics_mtouch_control *control = (struct synaptics_mtouch_control *)arg;
+	dispatch_context_t *ctp;
+	int state;
+
+	while (true) {
+		ctp = dispatch_block(control->ctp);
+		if (!ctp) {
+			mtouch_error(MTOUCH_DEV, "%s: failed to receive the message (error: %s)",
+						__FUNCTION__, strerror(errno));
+			break;
+		}
+		control->ctp = ctp;
+
+		pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &state);
+		dispatch_handler(ctp);
+		pthread_setcancelstate(state, NULL);
+	}
+
+	return ( 0 );
+}
+
+/*
+ * create the control interface of the runtime firmware update
+ * the path is registered in the path space, and served by the control thread
+ *
+ *    echo "/path/to/image.img [fw_id]" > path
+ *    cat path
+ *
+ * syna_dev_t *dev: mtouch device instance data
+ * const char *path: the path of the control interface
+ *
+ * return the control interface
+ * return NULL: fail
+ */
+struct synaptics_mtouch_control *synaptics_mtouch_control_create(syna_dev_t *dev, const char *path)
+{
+	struct synaptics_mtouch_control *control;
+	resmgr_attr_t resmgr_attr;
+	pthread_attr_t attr;
+	struct sched_param param;
+	int retval;
+
+	if ((!dev) || (!path) || ('\0' == path[0]))
+		return NULL;
+
+	control = calloc(1, sizeof(struct synaptics_mtouch_control));
+	if (!control) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to allocate memory for the control", __FUNCTION__);
+		return NULL;
+	}
+
+	control->dev = dev;
+	control->id = -1;
+
+	control->dpp = dispatch_create();
+	if (!control->dpp) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to create the dispatch (error: %s)",
+					__FUNCTION__, strerror(errno));
+		goto exit;
+	}
+
+	// the default handlers, except the read and the write
+	iofunc_func_init(_RESMGR_CONNECT_NFUNCS, &control->connect_funcs,
+					_RESMGR_IO_NFUNCS, &control->io_funcs);
+	control->io_funcs.read = synaptics_mtouch_control_read;
+	control->io_funcs.write = synaptics_mtouch_control_write;
+
+	iofunc_attr_init(&control->attr, S_IFCHR | 0600, NULL, NULL);
+
+	memset(&resmgr_attr, 0x00, sizeof(resmgr_attr));
+	resmgr_attr.nparts_max = 1;
+	resmgr_attr.msg_max_size = CONTROL_REQUEST_SIZE;
+
+	control->id = resmgr_attach(control->dpp, &resmgr_attr, path, _FTYPE_ANY, 0,
+								&control->connect_funcs, &control->io_funcs, &control->attr);
+	if (control->id == -1) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to attach %s (error: %s)",
+					__FUNCTION__, path, strerror(errno));
+		goto exit;
+	}
+
+	control->ctp = dispatch_context_alloc(control->dpp);
+	if (!control->ctp) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to allocate the dispatch context (error: %s)",
+					__FUNCTION__, strerror(errno));
+		goto exit;
+	}
+
+	// the control thread runs below the interrupt thread
+	pthread_attr_init(&attr);
+	pthread_attr_setschedpolicy(&attr, SCHED_RR);
+	param.sched_priority = CONTROL_THREAD_PRIORITY;
+	pthread_attr_setschedparam(&attr, &param);
+	pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+
+	retval = pthread_create(&control->thread, &attr, synaptics_mtouch_control_thread, control);
+	pthread_attr_destroy(&attr);
+	if (EOK != retval) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to create the control thread (error: %s)",
+					__FUNCTION__, strerror(retval));
+		goto exit;
+	}
+
+	pthread_setname_np(control->thread, "mtouch-synaptics-ctrl");
+	control->thread_running = true;
+
+	mtouch_info(MTOUCH_DEV, "%s: firmware update is requested through %s", __FUNCTION__, path);
+
+	return control;
+
+exit:
+	synaptics_mtouch_control_destroy(control);
+
+	return NULL;
+}
+
+/*
+ * stop the control thread and remove the path
+ * an update in progress is not interrupted, it is joined by the caller
+ *
+ * struct synaptics_mtouch_control *control: the control interface
+ *
+ * return void
+ */
+void synaptics_mtouch_control_destroy(struct synaptics_mtouch_control *control)
+{
+	if (!control)
+		return;
+
+	if (control->thread_running) {
+		pthread_cancel(control->thread);
+		pthread_join(control->thread, NULL);
+		control->thread_running = false;
+	}
+
+	if (control->id != -1) {
+		resmgr_detach(control->dpp, control->id, _RESMGR_DETACH_ALL);
+		control->id = -1;
+	}
+
+	if (control->ctp) {
+		dispatch_context_free(control->ctp);
+		control->ctp = NULL;
+	}
+
+	if (control->dpp) {
+		dispatch_destroy(control->dpp);
+		control->dpp = NULL;
+	}
+
+	free(control);
+}
@@ -0,0 +1,103 @@
+/*
+ * $QNXLicenseC:
+ * Copyright 2010, QNX Software Systems.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You
+ * may not reproduce, modify or distribute this software except in
+ * compliance with the License. You may obtain a copy of the License
+ * at: http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OF ANY KIND, either express or implied.
+ *
+ * This file may contain contributions from others, either as
+ * contributors under the License or as licensors under other terms.
+ * Please review this entire file for other proprietary rights or license
+ * notices, as well as the QNX Development Suite License Guide at
+ * http://licensing.qnx.com/license-guide/ for other information.
+ * $
+ */
+
+/*
+ * Synaptics Touchscreen driver
+ *
+ * Copyright (C) 2012-2018 Synaptics Incorporated. All rights reserved.
+ *
+ * The hardware access library is included from QNX software, and the
+ * mtouch framework is also included from install/usr/input/. Both of
+ * libraries are under Apache-2.0.
+ *
+ * Synaptics Touchscreen driver is interacted with QNX software system
+ * as a touchscreen controller, for its licensing rule and related notices,
+ * please scroll down the text to browse all of it.
+ *
+ * INFORMATION CONTAINED IN THIS DOCUMENT IS PROVIDED "AS-IS," AND SYNAPTICS
+ * EXPRESSLY DISCLAIMS ALL EXPRESS AND IMPLIED WARRANTIES, INCLUDING ANY
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE,
+ * AND ANY WARRANTIES OF NON-INFRINGEMENT OF ANY INTELLECTUAL PROPERTY RIGHTS.
+ * IN NO EVENT SHALL SYNAPTICS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, PUNITIVE, OR CONSEQUENTIAL DAMAGES ARISING OUT OF OR IN CONNECTION
+ * WITH THE USE OF THE INFORMATION CONTAINED IN THIS DOCUMENT, HOWEVER CAUSED
+ * AND BASED ON ANY THEORY OF LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, AND EVEN IF SYNAPTICS WAS ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE. IF A TRIBUNAL OF COMPETENT JURISDICTION DOES
+ * NOT PERMIT THE DISCLAIMER OF DIRECT DAMAGES OR ANY OTHER DAMAGES, SYNAPTICS'
+ * TOTAL CUMULATIVE LIABILITY TO ANY PARTY SHALL NOT EXCEED ONE HUNDRED U.S.
+ * DOLLARS.
+ *
+ */
+
+#ifndef _SYNAPTICS_MTOUCH_CONTROL_H_
+#define _SYNAPTICS_MTOUCH_CONTROL_H_
+
+#include <sys/iofunc.h>
+#include <sys/dispatch.h>
+
+
+/*
+ * the control interface is served below the interrupt thread
+ */
+#define CONTROL_THREAD_PRIORITY		(10)
+
+/*
+ * size of the request written to the control interface, "<path> [<fw_id>]"
+ */
+#define CONTROL_REQUEST_SIZE		(PATH_MAX + 16)
+
+/*
+ * size of the status line read from the control interface
+ */
+#define CONTROL_STATUS_SIZE			(128)
+
+/*
+ * control interface of the runtime firmware update
+ *
+ * a resource manager serving one path,
+ * a write requests the update of the image, a read returns the status
+ *
+ * attr: attribute of the path, the first member to find the control from the ocb
+ * dev: mtouch device instance data
+ * dpp: the dispatch handle
+ * ctp: the dispatch context of the control thread
+ * id: the link id of the path
+ * connect_funcs, io_funcs: the handlers of the resource manager
+ * thread: the control thread, receiving the messages
+ * thread_running: the control thread is created and must be joined
+ */
+struct synaptics_mtouch_control {
+	iofunc_attr_t attr;
+	syna_dev_t *dev;
+	dispatch_t *dpp;
+	dispatch_context_t *ctp;
+	int id;
+	resmgr_connect_funcs_t connect_funcs;
+	resmgr_io_funcs_t io_funcs;
+	pthread_t thread;
+	bool thread_running;
+};
+
+extern struct synaptics_mtouch_control *synaptics_mtouch_control_create(syna_dev_t *dev, const char *path);
+extern void synaptics_mtouch_control_destroy(struct synaptics_mtouch_control *control);
+
+#endif /* _SYNAPTICS_MTOUCH_CONTROL_H_ */
@@ -0,0 +1,546 @@
+/*
+ * $QNXLicenseC:
+ * Copyright 2010, QNX Software Systems.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You
+ * may not reproduce, modify or distribute this software except in
+ * compliance with the License. You may obtain a copy of the License
+ * at: http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OF ANY KIND, either express or implied.
+ *
+ * This file may contain contributions from others, either as
+ * contributors under the License or as licensors under other terms.
+ * Please review this entire file for other proprietary rights or license
+ * notices, as well as the QNX Development Suite License Guide at
+ * http://licensing.qnx.com/license-guide/ for other information.
+ * $
+ */
+
+/*
+ * Synaptics Touchscreen driver
+ *
+ * Copyright (C) 2012-2018 Synaptics Incorporated. All rights reserved.
+ *
+ * The hardware access library is included from QNX software, and the
+ * mtouch framework is also included from install/usr/input/. Both of
+ * libraries are under Apache-2.0.
+ *
+ * Synaptics Touchscreen driver is interacted with QNX software system
+ * as a touchscreen controller, for its licensing rule and related notices,
+ * please scroll down the text to browse all of it.
+ *
+ * INFORMATION CONTAINED IN THIS DOCUMENT IS PROVIDED "AS-IS," AND SYNAPTICS
+ * EXPRESSLY DISCLAIMS ALL EXPRESS AND IMPLIED WARRANTIES, INCLUDING ANY
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE,
+ * AND ANY WARRANTIES OF NON-INFRINGEMENT OF ANY INTELLECTUAL PROPERTY RIGHTS.
+ * IN NO EVENT SHALL SYNAPTICS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, PUNITIVE, OR CONSEQUENTIAL DAMAGES ARISING OUT OF OR IN CONNECTION
+ * WITH THE USE OF THE INFORMATION CONTAINED IN THIS DOCUMENT, HOWEVER CAUSED
+ * AND BASED ON ANY THEORY OF LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, AND EVEN IF SYNAPTICS WAS ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE. IF A TRIBUNAL OF COMPETENT JURISDICTION DOES
+ * NOT PERMIT THE DISCLAIMER OF DIRECT DAMAGES OR ANY OTHER DAMAGES, SYNAPTICS'
+ * TOTAL CUMULATIVE LIABILITY TO ANY PARTY SHALL NOT EXCEED ONE HUNDRED U.S.
+ * DOLLARS.
+ *
+ */
+
+#include "synaptics_mtouch.h"
+#include "synaptics_mtouch_filter.h"
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/* weight of the new sample at rest, used when the one-euro stage runs without iir */
+#define FILTER_DEFAULT_MIN_ALPHA	(FILTER_Q_ONE / 8)
+
+
+/*
+ * release the state arrays of the filter
+ *
+ * struct synaptics_mtouch_filter *filter: filter instance
+ */
+static void synaptics_mtouch_filter_free_state(struct synaptics_mtouch_filter *filter)
+{
+	if (filter->active)
+		free(filter->active);
+	if (filter->raw_x)
+		free(filter->raw_x);
+	if (filter->pending_time)
+		free(filter->pending_time);
+
+	filter->active = NULL;
+	filter->raw_x = NULL;
+	filter->raw_y = NULL;
+	filter->smooth_x = NULL;
+	filter->smooth_y = NULL;
+	filter->anchor_x = NULL;
+	filter->anchor_y = NULL;
+	filter->speed = NULL;
+	filter->alpha = NULL;
+	filter->base_x = NULL;
+	filter->base_y = NULL;
+	filter->vel_x = NULL;
+	filter->vel_y = NULL;
+	filter->pending_x = NULL;
+	filter->pending_y = NULL;
+	filter->pending_time = NULL;
+	filter->capacity = 0;
+}
+
+/*
+ * allocate the state arrays of the filter
+ * all int32_t arrays are carved from one buffer, and each of them
+ * is aligned to FILTER_LANES elements for the vector kernels
+ *
+ * struct synaptics_mtouch_filter *filter: filter instance
+ * unsigned int count: number of contacts
+ *
+ * return EOK: finish
+ * otherwise, fail
+ */
+static int synaptics_mtouch_filter_alloc_state(struct synaptics_mtouch_filter *filter,
+			unsigned int count)
+{
+	unsigned int capacity;
+	int32_t *buf;
+
+	synaptics_mtouch_filter_free_state(filter);
+
+	capacity = (count + FILTER_LANES - 1) & ~(FILTER_LANES - 1);
+
+	filter->active = calloc(capacity, sizeof(unsigned char));
+	if (!filter->active) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to allocate the contact flags", __FUNCTION__);
+		return -ENOMEM;
+	}
+
+	filter->pending_time = calloc(capacity, sizeof(uint64_t));
+	if (!filter->pending_time) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to allocate the prediction state", __FUNCTION__);
+		synaptics_mtouch_filter_free_state(filter);
+		return -ENOMEM;
+	}
+
+	buf = memalign(16, capacity * FILTER_STATE_ARRAYS * sizeof(int32_t));
+	if (!buf) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to allocate the filter state", __FUNCTION__);
+		synaptics_mtouch_filter_free_state(filter);
+		return -ENOMEM;
+	}
+	memset(buf, 0x00, capacity * FILTER_STATE_ARRAYS * sizeof(int32_t));
+
+	filter->raw_x = buf;
+	filter->raw_y = buf + capacity;
+	filter->smooth_x = buf + capacity * 2;
+	filter->smooth_y = buf + capacity * 3;
+	filter->anchor_x = buf + capacity * 4;
+	filter->anchor_y = buf + capacity * 5;
+	filter->speed = buf + capacity * 6;
+	filter->alpha = buf + capacity * 7;
+	filter->base_x = buf + capacity * 8;
+	filter->base_y = buf + capacity * 9;
+	filter->vel_x = buf + capacity * 10;
+	filter->vel_y = buf + capacity * 11;
+	filter->pending_x = buf + capacity * 12;
+	filter->pending_y = buf + capacity * 13;
+	filter->capacity = capacity;
+
+	return EOK;
+}
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+/*
+ * smoothing kernel, NEON version
+ * s = s + alpha * (raw - s), processing FILTER_LANES contacts at once
+ */
+static void synaptics_mtouch_filter_smooth(int32_t *s, const int32_t *raw,
+			const int32_t *alpha, unsigned int n)
+{
+	unsigned int i;
+	int32x4_t vs, vd;
+
+	for (i = 0; i < n; i += FILTER_LANES) {
+		vs = vld1q_s32(s + i);
+		vd = vsubq_s32(vld1q_s32(raw + i), vs);
+		vd = vmulq_s32(vd, vld1q_s32(alpha + i));
+		vs = vaddq_s32(vs, vshrq_n_s32(vd, FILTER_Q_SHIFT));
+		vst1q_s32(s + i, vs);
+	}
+}
+
+/*
+ * hysteresis kernel, NEON version
+ * the anchor follows the input only when it moves out of the deadband
+ */
+static void synaptics_mtouch_filter_hysteresis(int32_t *a, const int32_t *s,
+			int32_t h, unsigned int n)
+{
+	unsigned int i;
+	int32x4_t vh = vdupq_n_s32(h);
+	int32x4_t vnh = vdupq_n_s32(-h);
+	int32x4_t va, vs, vd;
+	uint32x4_t hi, lo;
+
+	for (i = 0; i < n; i += FILTER_LANES) {
+		va = vld1q_s32(a + i);
+		vs = vld1q_s32(s + i);
+		vd = vsubq_s32(vs, va);
+		hi = vcgtq_s32(vd, vh);
+		lo = vcltq_s32(vd, vnh);
+		va = vbslq_s32(hi, vsubq_s32(vs, vh), va);
+		va = vbslq_s32(lo, vaddq_s32(vs, vh), va);
+		vst1q_s32(a + i, va);
+	}
+}
+#else
+/*
+ * smoothing kernel, generic version
+ * s = s + alpha * (raw - s)
+ */
+static void synaptics_mtouch_filter_smooth(int32_t *s, const int32_t *raw,
+			const int32_t *alpha, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i < n; i++)
+		s[i] += ((raw[i] - s[i]) * alpha[i]) >> FILTER_Q_SHIFT;
+}
+
+/*
+ * hysteresis kernel, generic version
+ * the anchor follows the input only when it moves out of the deadband
+ */
+static void synaptics_mtouch_filter_hysteresis(int32_t *a, const int32_t *s,
+			int32_t h, unsigned int n)
+{
+	unsigned int i;
+	int32_t d;
+
+	for (i = 0; i < n; i++) {
+		d = s[i] - a[i];
+		if (d > h)
+			a[i] = s[i] - h;
+		else if (d < -h)
+			a[i] = s[i] + h;
+	}
+}
+#endif
+
+/*
+ * compute the weight of the new sample for each contact
+ * the iir stage uses a constant weight, and the one-euro stage raises
+ * the weight with the speed of contact, so a slow finger is smoothed
+ * heavily while a fast swipe is followed with little lag
+ *
+ * struct synaptics_mtouch_filter *filter: filter instance
+ * unsigned int n: number of contacts, aligned to FILTER_LANES
+ */
+static void synaptics_mtouch_filter_weight(struct synaptics_mtouch_filter *filter,
+			unsigned int n)
+{
+	unsigned int i;
+	int32_t min_alpha;
+	int32_t alpha;
+
+	min_alpha = (filter->iir_alpha) ? filter->iir_alpha : FILTER_DEFAULT_MIN_ALPHA;
+
+	for (i = 0; i < n; i++) {
+		alpha = min_alpha;
+		if (filter->one_euro_beta)
+			alpha += (filter->one_euro_beta * filter->speed[i]) >> FILTER_Q_SHIFT;
+
+		filter->alpha[i] = (alpha > FILTER_Q_ONE) ? FILTER_Q_ONE : alpha;
+	}
+}
+
+/*
+ * update the error statistics of the prediction stage
+ * the statistics are reported and restarted every FILTER_PREDICT_STATS_PERIOD predictions
+ *
+ * struct synaptics_mtouch_filter *filter: filter instance
+ * int32_t err: error of the evaluated prediction, Q8
+ */
+static void synaptics_mtouch_filter_predict_stats(struct synaptics_mtouch_filter *filter,
+			int32_t err)
+{
+	unsigned int mean;
+
+	filter->predict_count++;
+	filter->predict_err_sum += err;
+	if (err > filter->predict_err_max)
+		filter->predict_err_max = err;
+
+	if (filter->predict_count < FILTER_PREDICT_STATS_PERIOD)
+		return;
+
+	mean = (unsigned int)((filter->predict_err_sum * 100 / filter->predict_count) >> FILTER_Q_SHIFT);
+
+	mtouch_info(MTOUCH_DEV, "%s: horizon = %d us, error mean = %d.%02d, max = %d, reversals = %d (%d predictions)",
+				__FUNCTION__, filter->predict_horizon, mean / 100, mean % 100,
+				filter->predict_err_max >> FILTER_Q_SHIFT,
+				filter->reversal_count, filter->predict_count);
+
+	filter->predict_count = 0;
+	filter->predict_err_sum = 0;
+	filter->predict_err_max = 0;
+	filter->reversal_count = 0;
+}
+
+/*
+ * prediction stage
+ * extrapolate the contact forward by the predict_horizon with its velocity,
+ * on a direction reversal the input is output as it is
+ *
+ * each prediction is kept until a frame passes its target time, then it is compared
+ * with the actual position interpolated at the target time for the error statistics
+ *
+ * struct synaptics_mtouch_filter *filter: filter instance
+ * unsigned int i: index of contact
+ * uint64_t last: the time of previous frame, in nanoseconds
+ * uint64_t now: the time of current frame, in nanoseconds
+ * int32_t *x, int32_t *y: input and output coordinates, Q8
+ */
+static void synaptics_mtouch_filter_predict(struct synaptics_mtouch_filter *filter,
+			unsigned int i, uint64_t last, uint64_t now, int32_t *x, int32_t *y)
+{
+	int32_t dx, dy;
+	int32_t vx, vy;
+	int32_t ax, ay;
+	int32_t frac;
+	int64_t dt;
+	bool reversal;
+
+	dx = *x - filter->base_x[i];
+	dy = *y - filter->base_y[i];
+
+	// evaluate the pending prediction
+	if ((filter->pending_time[i]) && (now >= filter->pending_time[i])) {
+		frac = FILTER_Q_ONE;
+		if ((now > last) && (filter->pending_time[i] > last))
+			frac = (int32_t)(((filter->pending_time[i] - last) << FILTER_Q_SHIFT) / (now - last));
+
+		ax = filter->base_x[i] + ((dx * frac) >> FILTER_Q_SHIFT);
+		ay = filter->base_y[i] + ((dy * frac) >> FILTER_Q_SHIFT);
+
+		synaptics_mtouch_filter_predict_stats(filter,
+					abs(ax - filter->pending_x[i]) + abs(ay - filter->pending_y[i]));
+
+		filter->pending_time[i] = 0;
+	}
+
+	filter->base_x[i] = *x;
+	filter->base_y[i] = *y;
+
+	// velocity of this frame, sensor units per ms in Q8
+	dt = (now > last) ? (int64_t)(now - last) : 1000000;
+	vx = (int32_t)(((int64_t)dx * 1000000) / dt);
+	vy = (int32_t)(((int64_t)dy * 1000000) / dt);
+
+	reversal = (((int64_t)vx * filter->vel_x[i]) < 0) ||
+				(((int64_t)vy * filter->vel_y[i]) < 0);
+	if (reversal) {
+		// restart the velocity estimation from the new direction,
+		// and fall back to the input in this frame
+		filter->vel_x[i] = vx;
+		filter->vel_y[i] = vy;
+		filter->reversal_count++;
+		return;
+	}
+
+	filter->vel_x[i] += (vx - filter->vel_x[i]) >> FILTER_VELOCITY_SHIFT;
+	filter->vel_y[i] += (vy - filter->vel_y[i]) >> FILTER_VELOCITY_SHIFT;
+
+	*x += (int32_t)(((int64_t)filter->vel_x[i] * filter->predict_horizon) / 1000);
+	*y += (int32_t)(((int64_t)filter->vel_y[i] * filter->predict_horizon) / 1000);
+
+	// keep the prediction inside the sensor
+	if (*x < 0)
+		*x = 0;
+	else if (*x > (filter->max_x << FILTER_Q_SHIFT))
+		*x = filter->max_x << FILTER_Q_SHIFT;
+	if (*y < 0)
+		*y = 0;
+	else if (*y > (filter->max_y << FILTER_Q_SHIFT))
+		*y = filter->max_y << FILTER_Q_SHIFT;
+
+	if (0 == filter->pending_time[i]) {
+		filter->pending_x[i] = *x;
+		filter->pending_y[i] = *y;
+		filter->pending_time[i] = now + (uint64_t)filter->predict_horizon * 1000;
+	}
+}
+
+/*
+ * create the driver-side filter chain
+ * the stages are applied in the order of smoothing (iir or one-euro), hysteresis and prediction
+ *
+ * unsigned int iir_alpha: weight of the new sample in Q8, 0 = disabled
+ * unsigned int one_euro_beta: speed coefficient of the one-euro stage, 0 = disabled
+ * unsigned int hysteresis: deadband in sensor units, 0 = disabled
+ * unsigned int predict_horizon: prediction horizon in us, 0 = disabled
+ * int max_x, int max_y: the maximum coordinates of the sensor
+ *
+ * return filter instance: success
+ * return NULL: all stages are disabled, or fail
+ */
+struct synaptics_mtouch_filter *synaptics_mtouch_filter_create(unsigned int iir_alpha,
+			unsigned int one_euro_beta, unsigned int hysteresis,
+			unsigned int predict_horizon, int max_x, int max_y)
+{
+	struct synaptics_mtouch_filter *filter;
+
+	if (!iir_alpha && !one_euro_beta && !hysteresis && !predict_horizon)
+		return NULL;
+
+	filter = calloc(1, sizeof(struct synaptics_mtouch_filter));
+	if (!filter) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to allocate the filter", __FUNCTION__);
+		return NULL;
+	}
+
+	filter->iir_alpha = (iir_alpha > FILTER_Q_ONE) ? FILTER_Q_ONE : iir_alpha;
+	filter->one_euro_beta = one_euro_beta;
+	filter->hysteresis = hysteresis;
+	filter->predict_horizon = predict_horizon;
+	filter->max_x = max_x;
+	filter->max_y = max_y;
+
+	mtouch_info(MTOUCH_DEV, "%s: iir = %d/%d, one-euro beta = %d, hysteresis = %d, prediction = %d us",
+				__FUNCTION__, filter->iir_alpha, FILTER_Q_ONE,
+				filter->one_euro_beta, filter->hysteresis, filter->predict_horizon);
+
+	return filter;
+}
+
+/*
+ * release the driver-side filter chain
+ *
+ * struct synaptics_mtouch_filter *filter: filter instance
+ */
+void synaptics_mtouch_filter_destroy(struct synaptics_mtouch_filter *filter)
+{
+	if (!filter)
+		return;
+
+	synaptics_mtouch_filter_free_state(filter);
+	free(filter);
+}
+
+/*
+ * apply the filter chain to the touch report in place
+ * the caller should hold the rmi4_report_mutex
+ *
+ * struct synaptics_mtouch_filter *filter: filter instance
+ * struct touch_report_t *touch_report: the touch report of current frame
+ * unsigned int count: number of contacts in the touch report
+ * uint64_t timestamp: the time of current frame, in nanoseconds
+ *
+ * return EOK: finish
+ * otherwise, fail
+ */
+int synaptics_mtouch_filter_process(struct synaptics_mtouch_filter *filter,
+			struct touch_report_t *touch_report, unsigned int count, uint64_t timestamp)
+{
+	int retval;
+	unsigned int i;
+	unsigned int n;
+	uint64_t dt;
+	uint64_t last;
+	int32_t x, y;
+	int32_t delta;
+
+	_CHECK_POINTER(filter);
+	_CHECK_POINTER(touch_report);
+
+	if (count > filter->capacity) {
+		retval = synaptics_mtouch_filter_alloc_state(filter, count);
+		if (retval < 0)
+			return retval;
+	}
+
+	n = (count + FILTER_LANES - 1) & ~(FILTER_LANES - 1);
+
+	// elapsed time since previous frame, at least 1 ms
+	last = filter->timestamp;
+	dt = timestamp - last;
+	if ((0 == last) || (dt < 1000000))
+		dt = 1000000;
+	filter->timestamp = timestamp;
+
+	// load the frame into fixed-point arrays
+	// a contact landing in this frame starts from its raw position
+	for (i = 0; i < count; i++) {
+		if (FINGER_LANDING != touch_report[i].is_touched) {
+			filter->active[i] = 0;
+			continue;
+		}
+
+		x = touch_report[i].touch_points.x << FILTER_Q_SHIFT;
+		y = touch_report[i].touch_points.y << FILTER_Q_SHIFT;
+
+		if (!filter->active[i]) {
+			filter->smooth_x[i] = filter->anchor_x[i] = x;
+			filter->smooth_y[i] = filter->anchor_y[i] = y;
+			filter->speed[i] = 0;
+			filter->base_x[i] = x;
+			filter->base_y[i] = y;
+			filter->vel_x[i] = 0;
+			filter->vel_y[i] = 0;
+			filter->pending_time[i] = 0;
+			filter->active[i] = 1;
+		}
+		else {
+			delta = abs(x - filter->raw_x[i]) + abs(y - filter->raw_y[i]);
+			delta = (int32_t)(((uint64_t)delta * 1000000) / dt);
+			filter->speed[i] += (delta - filter->speed[i]) >> FILTER_SPEED_SHIFT;
+		}
+
+		filter->raw_x[i] = x;
+		filter->raw_y[i] = y;
+	}
+
+	// smoothing stage
+	if (filter->iir_alpha || filter->one_euro_beta) {
+		synaptics_mtouch_filter_weight(filter, n);
+		synaptics_mtouch_filter_smooth(filter->smooth_x, filter->raw_x, filter->alpha, n);
+		synaptics_mtouch_filter_smooth(filter->smooth_y, filter->raw_y, filter->alpha, n);
+	}
+	else {
+		memcpy(filter->smooth_x, filter->raw_x, n * sizeof(int32_t));
+		memcpy(filter->smooth_y, filter->raw_y, n * sizeof(int32_t));
+	}
+
+	// hysteresis stage
+	if (filter->hysteresis) {
+		synaptics_mtouch_filter_hysteresis(filter->anchor_x, filter->smooth_x,
+					filter->hysteresis << FILTER_Q_SHIFT, n);
+		synaptics_mtouch_filter_hysteresis(filter->anchor_y, filter->smooth_y,
+					filter->hysteresis << FILTER_Q_SHIFT, n);
+	}
+	else {
+		memcpy(filter->anchor_x, filter->smooth_x, n * sizeof(int32_t));
+		memcpy(filter->anchor_y, filter->smooth_y, n * sizeof(int32_t));
+	}
+
+	// prediction stage, and store the result back to the frame
+	for (i = 0; i < count; i++) {
+		if (!filter->active[i])
+			continue;
+
+		x = filter->anchor_x[i];
+		y = filter->anchor_y[i];
+
+		if (filter->predict_horizon)
+			synaptics_mtouch_filter_predict(filter, i, last, timestamp, &x, &y);
+
+		touch_report[i].touch_points.x = (x + (FILTER_Q_ONE >> 1)) >> FILTER_Q_SHIFT;
+		touch_report[i].touch_points.y = (y + (FILTER_Q_ONE >> 1)) >> FILTER_Q_SHIFT;
+	}
+
+	return EOK;
+}
@@ -0,0 +1,160 @@
+/*
+ * $QNXLicenseC:
+ * Copyright 2010, QNX Software Systems.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You
+ * may not reproduce, modify or distribute this software except in
+ * compliance with the License. You may obtain a copy of the License
+ * at: http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OF ANY KIND, either express or implied.
+ *
+ * This file may contain contributions from others, either as
+ * contributors under the License or as licensors under other terms.
+ * Please review this entire file for other proprietary rights or license
+ * notices, as well as the QNX Development Suite License Guide at
+ * http://licensing.qnx.com/license-guide/ for other information.
+ * $
+ */
+
+/*
+ * Synaptics Touchscreen driver
+ *
+ * Copyright (C) 2012-2018 Synaptics Incorporated. All rights reserved.
+ *
+ * The hardware access library is included from QNX software, and the
+ * mtouch framework is also included from install/usr/input/. Both of
+ * libraries are under Apache-2.0.
+ *
+ * Synaptics Touchscreen driver is interacted with QNX software system
+ * as a touchscreen controller, for its licensing rule and related notices,
+ * please scroll down the text to browse all of it.
+ *
+ * INFORMATION CONTAINED IN THIS DOCUMENT IS PROVIDED "AS-IS," AND SYNAPTICS
+ * EXPRESSLY DISCLAIMS ALL EXPRESS AND IMPLIED WARRANTIES, INCLUDING ANY
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE,
+ * AND ANY WARRANTIES OF NON-INFRINGEMENT OF ANY INTELLECTUAL PROPERTY RIGHTS.
+ * IN NO EVENT SHALL SYNAPTICS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, PUNITIVE, OR CONSEQUENTIAL DAMAGES ARISING OUT OF OR IN CONNECTION
+ * WITH THE USE OF THE INFORMATION CONTAINED IN THIS DOCUMENT, HOWEVER CAUSED
+ * AND BASED ON ANY THEORY OF LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, AND EVEN IF SYNAPTICS WAS ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE. IF A TRIBUNAL OF COMPETENT JURISDICTION DOES
+ * NOT PERMIT THE DISCLAIMER OF DIRECT DAMAGES OR ANY OTHER DAMAGES, SYNAPTICS'
+ * TOTAL CUMULATIVE LIABILITY TO ANY PARTY SHALL NOT EXCEED ONE HUNDRED U.S.
+ * DOLLARS.
+ *
+ */
+
+
+#ifndef _SYNAPTICS_MTOUCH_FILTER_H_
+#define _SYNAPTICS_MTOUCH_FILTER_H_
+
+
+/*
+ * the filter works on the fixed-point coordinates
+ * FILTER_Q_SHIFT bits are used for the fractional part
+ */
+#define FILTER_Q_SHIFT				(8)
+#define FILTER_Q_ONE				(1 << FILTER_Q_SHIFT)
+
+/*
+ * contacts are processed in groups of FILTER_LANES,
+ * the width of one 128-bit vector of 32-bit elements
+ */
+#define FILTER_LANES				(4)
+
+/*
+ * smoothing factor of the speed estimation used by the one-euro stage
+ */
+#define FILTER_SPEED_SHIFT			(2)
+
+/*
+ * smoothing factor of the velocity estimation used by the prediction stage
+ */
+#define FILTER_VELOCITY_SHIFT		(1)
+
+/*
+ * number of evaluated predictions between two reports of the error statistics
+ */
+#define FILTER_PREDICT_STATS_PERIOD	(500)
+
+/*
+ * number of int32_t state arrays, see struct synaptics_mtouch_filter
+ */
+#define FILTER_STATE_ARRAYS			(14)
+
+
+struct touch_report_t;
+
+/*
+ * driver-side filter chain
+ *
+ * the state is kept as structure of arrays, one element per contact,
+ * and the capacity is always aligned to FILTER_LANES
+ *
+ * iir_alpha: weight of the new sample in Q8, 0 = stage disabled
+ * one_euro_beta: speed coefficient of the adaptive weight, 0 = stage disabled
+ * hysteresis: deadband in sensor units, 0 = stage disabled
+ * predict_horizon: time to extrapolate the contacts forward in us, 0 = stage disabled
+ * max_x, max_y: the maximum coordinates of the sensor
+ * capacity: number of contacts allocated in the state arrays
+ * active: contacts which were down in the previous frame
+ * raw_x, raw_y: the input coordinates of current frame
+ * smooth_x, smooth_y: the output of the smoothing stage
+ * anchor_x, anchor_y: the output of the hysteresis stage
+ * speed: the estimated speed of each contact, sensor units per ms in Q8
+ * alpha: weight of the new sample applied to each contact in Q8
+ * base_x, base_y: the input of the prediction stage in the previous frame
+ * vel_x, vel_y: the estimated velocity of each contact, sensor units per ms in Q8
+ * pending_x, pending_y: the prediction which is waiting for evaluation
+ * pending_time: the target time of the pending prediction, 0 = none
+ * timestamp: the time of the previous frame, in nanoseconds
+ * predict_count: number of evaluated predictions in current period
+ * predict_err_sum: sum of the prediction errors in current period, Q8
+ * predict_err_max: the maximum prediction error in current period, Q8
+ * reversal_count: number of direction reversals in current period
+ */
+struct synaptics_mtouch_filter {
+	unsigned int iir_alpha;
+	unsigned int one_euro_beta;
+	unsigned int hysteresis;
+	unsigned int predict_horizon;
+	int32_t max_x;
+	int32_t max_y;
+
+	unsigned int capacity;
+	unsigned char *active;
+	int32_t *raw_x;
+	int32_t *raw_y;
+	int32_t *smooth_x;
+	int32_t *smooth_y;
+	int32_t *anchor_x;
+	int32_t *anchor_y;
+	int32_t *speed;
+	int32_t *alpha;
+	int32_t *base_x;
+	int32_t *base_y;
+	int32_t *vel_x;
+	int32_t *vel_y;
+	int32_t *pending_x;
+	int32_t *pending_y;
+	uint64_t *pending_time;
+	uint64_t timestamp;
+
+	unsigned int predict_count;
+	uint64_t predict_err_sum;
+	int32_t predict_err_max;
+	unsigned int reversal_count;
+};
+
+extern struct synaptics_mtouch_filter *synaptics_mtouch_filter_create(unsigned int iir_alpha,
+			unsigned int one_euro_beta, unsigned int hysteresis,
+			unsigned int predict_horizon, int max_x, int max_y);
+extern void synaptics_mtouch_filter_destroy(struct synaptics_mtouch_filter *filter);
+extern int synaptics_mtouch_filter_process(struct synaptics_mtouch_filter *filter,
+			struct touch_report_t *touch_report, unsigned int count, uint64_t timestamp);
+
+#endif /* _SYNAPTICS_MTOUCH_FILTER_H_ */
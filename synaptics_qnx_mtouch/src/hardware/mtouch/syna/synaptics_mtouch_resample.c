@@ -0,0 +1,341 @@
+/*
+ * $QNXLicenseC:
+ * Copyright 2010, QNX Software Systems.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You
+ * may not reproduce, modify or distribute this software except in
+ * compliance with the License. You may obtain a copy of the License
+ * at: http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OF ANY KIND, either express or implied.
+ *
+ * This file may contain contributions from others, either as
+ * contributors under the License or as licensors under other terms.
+ * Please review this entire file for other proprietary rights or license
+ * notices, as well as the QNX Development Suite License Guide at
+ * http://licensing.qnx.com/license-guide/ for other information.
+ * $
+ */
+
+/*
+ * Synaptics Touchscreen driver
+ *
+ * Copyright (C) 2012-2018 Synaptics Incorporated. All rights reserved.
+ *
+ * The hardware access library is included from QNX software, and the
+ * mtouch framework is also included from install/usr/input/. Both of
+ * libraries are under Apache-2.0.
+ *
+ * Synaptics Touchscreen driver is interacted with QNX software system
+ * as a touchscreen controller, for its licensing rule and related notices,
+ * please scroll down the text to browse all of it.
+ *
+ * INFORMATION CONTAINED IN THIS DOCUMENT IS PROVIDED "AS-IS," AND SYNAPTICS
+ * EXPRESSLY DISCLAIMS ALL EXPRESS AND IMPLIED WARRANTIES, INCLUDING ANY
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE,
+ * AND ANY WARRANTIES OF NON-INFRINGEMENT OF ANY INTELLECTUAL PROPERTY RIGHTS.
+ * IN NO EVENT SHALL SYNAPTICS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, PUNITIVE, OR CONSEQUENTIAL DAMAGES ARISING OUT OF OR IN CONNECTION
+ * WITH THE USE OF THE INFORMATION CONTAINED IN THIS DOCUMENT, HOWEVER CAUSED
+ * AND BASED ON ANY THEORY OF LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, AND EVEN IF SYNAPTICS WAS ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE. IF A TRIBUNAL OF COMPETENT JURISDICTION DOES
+ * NOT PERMIT THE DISCLAIMER OF DIRECT DAMAGES OR ANY OTHER DAMAGES, SYNAPTICS'
+ * TOTAL CUMULATIVE LIABILITY TO ANY PARTY SHALL NOT EXCEED ONE HUNDRED U.S.
+ * DOLLARS.
+ *
+ */
+
+#include "synaptics_mtouch.h"
+#include "synaptics_mtouch_resample.h"
+
+
+/*
+ * get the frame in the history
+ *
+ * struct synaptics_mtouch_resample *resample: resampling instance
+ * unsigned int age: 0 is the newest frame, (filled - 1) is the oldest one
+ *
+ * return the index of frame
+ */
+static unsigned int synaptics_mtouch_resample_index(struct synaptics_mtouch_resample *resample,
+			unsigned int age)
+{
+	return (resample->head + RESAMPLE_HISTORY_DEPTH - age) % RESAMPLE_HISTORY_DEPTH;
+}
+
+/*
+ * allocate the history for the specified number of contacts
+ * the history is emptied
+ *
+ * struct synaptics_mtouch_resample *resample: resampling instance
+ * unsigned int count: number of contacts in one frame
+ *
+ * return EOK: finish
+ * otherwise, fail
+ */
+static int synaptics_mtouch_resample_alloc(struct synaptics_mtouch_resample *resample,
+			unsigned int count)
+{
+	if (resample->history)
+		free(resample->history);
+	if (resample->output)
+		free(resample->output);
+
+	resample->history = calloc(RESAMPLE_HISTORY_DEPTH * count, sizeof(struct touch_report_t));
+	resample->output = calloc(count, sizeof(struct touch_report_t));
+	if ((!resample->history) || (!resample->output)) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to allocate the history", __FUNCTION__);
+
+		if (resample->history)
+			free(resample->history);
+		if (resample->output)
+			free(resample->output);
+		resample->history = NULL;
+		resample->output = NULL;
+		resample->count = 0;
+		return -ENOMEM;
+	}
+
+	resample->count = count;
+	synaptics_mtouch_resample_reset(resample);
+
+	return EOK;
+}
+
+/*
+ * create the display-synchronous resampling
+ *
+ * unsigned int rate: the delivery cadence, in Hz, 0 = disabled
+ * unsigned int delay: distance between the delivery and the target time, in us,
+ *                     0 = use the estimated report interval
+ * unsigned int count: number of contacts in one frame
+ *
+ * return resampling instance: success
+ * return NULL: disabled, or fail
+ */
+struct synaptics_mtouch_resample *synaptics_mtouch_resample_create(unsigned int rate,
+			unsigned int delay, unsigned int count)
+{
+	struct synaptics_mtouch_resample *resample;
+
+	if (0 == rate)
+		return NULL;
+
+	resample = calloc(1, sizeof(struct synaptics_mtouch_resample));
+	if (!resample) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to allocate the resampling", __FUNCTION__);
+		return NULL;
+	}
+
+	resample->period = 1000000000ULL / rate;
+	resample->delay = (uint64_t)delay * 1000;
+
+	if (synaptics_mtouch_resample_alloc(resample, count) < 0) {
+		free(resample);
+		return NULL;
+	}
+
+	mtouch_info(MTOUCH_DEV, "%s: rate = %d Hz, delay = %d us", __FUNCTION__, rate, delay);
+
+	return resample;
+}
+
+/*
+ * release the display-synchronous resampling
+ *
+ * struct synaptics_mtouch_resample *resample: resampling instance
+ */
+void synaptics_mtouch_resample_destroy(struct synaptics_mtouch_resample *resample)
+{
+	if (!resample)
+		return;
+
+	if (resample->history)
+		free(resample->history);
+	if (resample->output)
+		free(resample->output);
+
+	free(resample);
+}
+
+/*
+ * empty the history
+ * it is called when the frames were delivered out of the resampling, e.g. a cancellation
+ *
+ * struct synaptics_mtouch_resample *resample: resampling instance
+ */
+void synaptics_mtouch_resample_reset(struct synaptics_mtouch_resample *resample)
+{
+	if (!resample)
+		return;
+
+	resample->head = 0;
+	resample->filled = 0;
+	resample->last_target = 0;
+	resample->updated = false;
+
+	if (resample->output)
+		memset(resample->output, 0x00, resample->count * sizeof(struct touch_report_t));
+}
+
+/*
+ * push a frame reported by the sensor into the history
+ *
+ * struct synaptics_mtouch_resample *resample: resampling instance
+ * struct touch_report_t *touch_report: the touch report of current frame
+ * unsigned int count: number of contacts in the touch report
+ * uint64_t timestamp: the time of current frame, in nanoseconds
+ *
+ * return EOK: finish
+ * otherwise, fail
+ */
+int synaptics_mtouch_resample_push(struct synaptics_mtouch_resample *resample,
+			struct touch_report_t *touch_report, unsigned int count, uint64_t timestamp)
+{
+	int retval;
+	uint64_t dt;
+
+	_CHECK_POINTER(resample);
+	_CHECK_POINTER(touch_report);
+
+	// the number of contacts is changed after re-initialization
+	if (count != resample->count) {
+		retval = synaptics_mtouch_resample_alloc(resample, count);
+		if (retval < 0)
+			return retval;
+	}
+
+	if (resample->filled) {
+		// estimate the report interval of the sensor
+		dt = timestamp - resample->history_time[resample->head];
+		if (0 == resample->interval)
+			resample->interval = dt;
+		else
+			resample->interval = resample->interval - (resample->interval >> RESAMPLE_INTERVAL_SHIFT)
+								+ (dt >> RESAMPLE_INTERVAL_SHIFT);
+
+		resample->head = (resample->head + 1) % RESAMPLE_HISTORY_DEPTH;
+	}
+
+	memcpy(resample->history + resample->head * count, touch_report,
+			count * sizeof(struct touch_report_t));
+	resample->history_time[resample->head] = timestamp;
+
+	if (resample->filled < RESAMPLE_HISTORY_DEPTH)
+		resample->filled++;
+
+	resample->updated = true;
+
+	return EOK;
+}
+
+/*
+ * produce the frame of current display refresh
+ *
+ * for each contact, the position is interpolated between the two frames around
+ * the target time when the contact is down in both of them; otherwise, the state
+ * of the frame before the target time is used, so that the landing and lifting
+ * are reported at their own time. a tap shorter than the cadence is reported
+ * with the position it was down.
+ *
+ * struct synaptics_mtouch_resample *resample: resampling instance
+ * uint64_t now: the time of current display refresh, in nanoseconds
+ *
+ * return the resampled frame
+ * return NULL: nothing to be delivered
+ */
+struct touch_report_t *synaptics_mtouch_resample_sample(struct synaptics_mtouch_resample *resample,
+			uint64_t now)
+{
+	unsigned int i;
+	unsigned int age;
+	unsigned int older;
+	unsigned int newer;
+	uint64_t delay;
+	uint64_t target;
+	uint64_t t1, t2;
+	int32_t frac;
+	bool touched;
+	bool was_touched;
+	struct touch_report_t *f1;
+	struct touch_report_t *f2;
+	struct touch_report_t *f;
+
+	if ((!resample) || (0 == resample->filled))
+		return NULL;
+
+	// nothing reported since the previous refresh, and no contact is down
+	if (!resample->updated) {
+		touched = false;
+		for (i = 0; i < resample->count; i++) {
+			if (FINGER_LANDING == resample->output[i].is_touched)
+				touched = true;
+		}
+		if (!touched)
+			return NULL;
+	}
+
+	delay = (resample->delay) ? resample->delay : resample->interval;
+	target = (now > delay) ? now - delay : 0;
+
+	// find the newest frame before the target time
+	for (age = 0; age < resample->filled - 1; age++) {
+		if (resample->history_time[synaptics_mtouch_resample_index(resample, age)] <= target)
+			break;
+	}
+
+	older = synaptics_mtouch_resample_index(resample, age);
+	f1 = resample->history + older * resample->count;
+	t1 = resample->history_time[older];
+
+	f2 = NULL;
+	t2 = t1;
+	if ((age > 0) && (t1 <= target)) {
+		newer = synaptics_mtouch_resample_index(resample, age - 1);
+		f2 = resample->history + newer * resample->count;
+		t2 = resample->history_time[newer];
+	}
+
+	frac = 0;
+	if ((f2) && (t2 > t1))
+		frac = (int32_t)(((target - t1) << 8) / (t2 - t1));
+
+	for (i = 0; i < resample->count; i++) {
+		was_touched = (FINGER_LANDING == resample->output[i].is_touched);
+
+		resample->output[i] = f1[i];
+
+		if ((f2) && (FINGER_LANDING == f1[i].is_touched) && (FINGER_LANDING == f2[i].is_touched)) {
+			resample->output[i].touch_points.x = f1[i].touch_points.x +
+					(((f2[i].touch_points.x - f1[i].touch_points.x) * frac) >> 8);
+			resample->output[i].touch_points.y = f1[i].touch_points.y +
+					(((f2[i].touch_points.y - f1[i].touch_points.y) * frac) >> 8);
+		}
+
+		if ((was_touched) || (FINGER_LANDING == resample->output[i].is_touched))
+			continue;
+
+		// a tap between two refreshes, report the position it was down
+		for (age = 0; age < resample->filled; age++) {
+			newer = synaptics_mtouch_resample_index(resample, age);
+			if (resample->history_time[newer] <= resample->last_target)
+				break;
+			if (resample->history_time[newer] > target)
+				continue;
+
+			f = resample->history + newer * resample->count;
+			if (FINGER_LANDING == f[i].is_touched) {
+				resample->output[i] = f[i];
+				break;
+			}
+		}
+	}
+
+	resample->last_target = target;
+	resample->updated = false;
+
+	return resample->output;
+}
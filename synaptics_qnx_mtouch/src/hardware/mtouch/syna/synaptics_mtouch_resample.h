@@ -0,0 +1,112 @@
+/*
+ * $QNXLicenseC:
+ * Copyright 2010, QNX Software Systems.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You
+ * may not reproduce, modify or distribute this software except in
+ * compliance with the License. You may obtain a copy of the License
+ * at: http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OF ANY KIND, either express or implied.
+ *
+ * This file may contain contributions from others, either as
+ * contributors under the License or as licensors under other terms.
+ * Please review this entire file for other proprietary rights or license
+ * notices, as well as the QNX Development Suite License Guide at
+ * http://licensing.qnx.com/license-guide/ for other information.
+ * $
+ */
+
+/*
+ * Synaptics Touchscreen driver
+ *
+ * Copyright (C) 2012-2018 Synaptics Incorporated. All rights reserved.
+ *
+ * The hardware access library is included from QNX software, and the
+ * mtouch framework is also included from install/usr/input/. Both of
+ * libraries are under Apache-2.0.
+ *
+ * Synaptics Touchscreen driver is interacted with QNX software system
+ * as a touchscreen controller, for its licensing rule and related notices,
+ * please scroll down the text to browse all of it.
+ *
+ * INFORMATION CONTAINED IN THIS DOCUMENT IS PROVIDED "AS-IS," AND SYNAPTICS
+ * EXPRESSLY DISCLAIMS ALL EXPRESS AND IMPLIED WARRANTIES, INCLUDING ANY
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE,
+ * AND ANY WARRANTIES OF NON-INFRINGEMENT OF ANY INTELLECTUAL PROPERTY RIGHTS.
+ * IN NO EVENT SHALL SYNAPTICS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, PUNITIVE, OR CONSEQUENTIAL DAMAGES ARISING OUT OF OR IN CONNECTION
+ * WITH THE USE OF THE INFORMATION CONTAINED IN THIS DOCUMENT, HOWEVER CAUSED
+ * AND BASED ON ANY THEORY OF LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, AND EVEN IF SYNAPTICS WAS ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE. IF A TRIBUNAL OF COMPETENT JURISDICTION DOES
+ * NOT PERMIT THE DISCLAIMER OF DIRECT DAMAGES OR ANY OTHER DAMAGES, SYNAPTICS'
+ * TOTAL CUMULATIVE LIABILITY TO ANY PARTY SHALL NOT EXCEED ONE HUNDRED U.S.
+ * DOLLARS.
+ *
+ */
+
+
+#ifndef _SYNAPTICS_MTOUCH_RESAMPLE_H_
+#define _SYNAPTICS_MTOUCH_RESAMPLE_H_
+
+
+/*
+ * number of frames kept in the history
+ */
+#define RESAMPLE_HISTORY_DEPTH		(8)
+
+/*
+ * smoothing factor of the report interval estimation
+ */
+#define RESAMPLE_INTERVAL_SHIFT		(3)
+
+
+struct touch_report_t;
+
+/*
+ * display-synchronous resampling
+ *
+ * the frames reported by the sensor are kept in a short history with their
+ * timestamps, and one frame is produced per display refresh by interpolating
+ * the history at the target time, which is "now - delay"
+ *
+ * period: the delivery cadence, in nanoseconds
+ * delay: distance between the delivery time and the target time, in nanoseconds,
+ *        0 = use the estimated report interval of the sensor
+ * interval: the estimated report interval of the sensor, in nanoseconds
+ * count: number of contacts in one frame
+ * head: index of the newest frame in the history
+ * filled: number of frames in the history
+ * history: the frames reported by the sensor
+ * history_time: the time of each frame in the history
+ * output: the resampled frame
+ * last_target: the target time of the previous resampled frame
+ * updated: frames were pushed since the previous resampled frame
+ */
+struct synaptics_mtouch_resample {
+	uint64_t period;
+	uint64_t delay;
+	uint64_t interval;
+	unsigned int count;
+	unsigned int head;
+	unsigned int filled;
+	struct touch_report_t *history;
+	uint64_t history_time[RESAMPLE_HISTORY_DEPTH];
+	struct touch_report_t *output;
+	uint64_t last_target;
+	bool updated;
+};
+
+extern struct synaptics_mtouch_resample *synaptics_mtouch_resample_create(unsigned int rate,
+			unsigned int delay, unsigned int count);
+extern void synaptics_mtouch_resample_destroy(struct synaptics_mtouch_resample *resample);
+extern void synaptics_mtouch_resample_reset(struct synaptics_mtouch_resample *resample);
+extern int synaptics_mtouch_resample_push(struct synaptics_mtouch_resample *resample,
+			struct touch_report_t *touch_report, unsigned int count, uint64_t timestamp);
+extern struct touch_report_t *synaptics_mtouch_resample_sample(struct synaptics_mtouch_resample *resample,
+			uint64_t now);
+
+#endif /* _SYNAPTICS_MTOUCH_RESAMPLE_H_ */
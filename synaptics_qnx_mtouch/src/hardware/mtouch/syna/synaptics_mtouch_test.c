@@ -0,0 +1,546 @@
+/*
+ * $QNXLicenseC:
+ * Copyright 2010, QNX Software Systems.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You
+ * may not reproduce, modify or distribute this software except in
+ * compliance with the License. You may obtain a copy of the License
+ * at: http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OF ANY KIND, either express or implied.
+ *
+ * This file may contain contributions from others, either as
+ * contributors under the License or as licensors under other terms.
+ * Please review this entire file for other proprietary rights or license
+ * notices, as well as the QNX Development Suite License Guide at
+ * http://licensing.qnx.com/license-guide/ for other information.
+ * $
+ */
+
+/*
+ * Synaptics Touchscreen driver
+ *
+ * Copyright (C) 2012-2018 Synaptics Incorporated. All rights reserved.
+ *
+ * The hardware access library is included from QNX software, and the
+ * mtouch framework is also included from install/usr/input/. Both of
+ * libraries are under Apache-2.0.
+ *
+ * Synaptics Touchscreen driver is interacted with QNX software system
+ * as a touchscreen controller, for its licensing rule and related notices,
+ * please scroll down the text to browse all of it.
+ *
+ * INFORMATION CONTAINED IN THIS DOCUMENT IS PROVIDED "AS-IS," AND SYNAPTICS
+ * EXPRESSLY DISCLAIMS ALL EXPRESS AND IMPLIED WARRANTIES, INCLUDING ANY
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE,
+ * AND ANY WARRANTIES OF NON-INFRINGEMENT OF ANY INTELLECTUAL PROPERTY RIGHTS.
+ * IN NO EVENT SHALL SYNAPTICS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, PUNITIVE, OR CONSEQUENTIAL DAMAGES ARISING OUT OF OR IN CONNECTION
+ * WITH THE USE OF THE INFORMATION CONTAINED IN THIS DOCUMENT, HOWEVER CAUSED
+ * AND BASED ON ANY THEORY OF LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, AND EVEN IF SYNAPTICS WAS ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE. IF A TRIBUNAL OF COMPETENT JURISDICTION DOES
+ * NOT PERMIT THE DISCLAIMER OF DIRECT DAMAGES OR ANY OTHER DAMAGES, SYNAPTICS'
+ * TOTAL CUMULATIVE LIABILITY TO ANY PARTY SHALL NOT EXCEED ONE HUNDRED U.S.
+ * DOLLARS.
+ *
+ */
+
+#include "synaptics_mtouch.h"
+#include "synaptics_mtouch_test.h"
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/*
+ * number of nodes processed at once by the NEON kernel
+ */
+#define TEST_LANES (8)
+
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+/*
+ * image statistics kernel, NEON version
+ * min, max, sum and the nodes out of [lower, upper], TEST_LANES nodes at once
+ *
+ * const uint16_t *image: the image
+ * const uint16_t *lower: lower limit of each node
+ * const uint16_t *upper: upper limit of each node
+ * unsigned int count: number of nodes
+ * struct mtouch_test_stats *stats: the statistics
+ */
+static void mtouch_test_image_stats(const uint16_t *image, const uint16_t *lower,
+			const uint16_t *upper, unsigned int count, struct mtouch_test_stats *stats)
+{
+	unsigned int i;
+	unsigned int lane;
+	uint16x8_t vmin = vdupq_n_u16(0xFFFF);
+	uint16x8_t vmax = vdupq_n_u16(0);
+	uint16x8_t vfail = vdupq_n_u16(0);
+	uint32x4_t vsum = vdupq_n_u32(0);
+	uint16x8_t v, out;
+	uint16_t min_lanes[TEST_LANES];
+	uint16_t max_lanes[TEST_LANES];
+	uint16_t fail_lanes[TEST_LANES];
+	uint32_t sum_lanes[4];
+
+	stats->min = 0xFFFF;
+	stats->max = 0;
+	stats->sum = 0;
+	stats->fail_count = 0;
+
+	for (i = 0; i + TEST_LANES <= count; i += TEST_LANES) {
+		v = vld1q_u16(image + i);
+		vmin = vminq_u16(vmin, v);
+		vmax = vmaxq_u16(vmax, v);
+		vsum = vpadalq_u16(vsum, v);
+
+		// the comparison gives all ones for the failed node, subtracting it counts one
+		out = vorrq_u16(vcltq_u16(v, vld1q_u16(lower + i)),
+						vcgtq_u16(v, vld1q_u16(upper + i)));
+		vfail = vsubq_u16(vfail, out);
+	}
+
+	vst1q_u16(min_lanes, vmin);
+	vst1q_u16(max_lanes, vmax);
+	vst1q_u16(fail_lanes, vfail);
+	vst1q_u32(sum_lanes, vsum);
+
+	for (lane = 0; lane < TEST_LANES; lane++) {
+		if (min_lanes[lane] < stats->min)
+			stats->min = min_lanes[lane];
+		if (max_lanes[lane] > stats->max)
+			stats->max = max_lanes[lane];
+		stats->fail_count += fail_lanes[lane];
+	}
+	for (lane = 0; lane < 4; lane++)
+		stats->sum += sum_lanes[lane];
+
+	// remaining nodes
+	for (; i < count; i++) {
+		if (image[i] < stats->min)
+			stats->min = image[i];
+		if (image[i] > stats->max)
+			stats->max = image[i];
+		stats->sum += image[i];
+		if ((image[i] < lower[i]) || (image[i] > upper[i]))
+			stats->fail_count++;
+	}
+}
+#else
+/*
+ * image statistics kernel, scalar version
+ * min, max, sum and the nodes out of [lower, upper]
+ *
+ * const uint16_t *image: the image
+ * const uint16_t *lower: lower limit of each node
+ * const uint16_t *upper: upper limit of each node
+ * unsigned int count: number of nodes
+ * struct mtouch_test_stats *stats: the statistics
+ */
+static void mtouch_test_image_stats(const uint16_t *image, const uint16_t *lower,
+			const uint16_t *upper, unsigned int count, struct mtouch_test_stats *stats)
+{
+	unsigned int i;
+	uint16_t min = 0xFFFF;
+	uint16_t max = 0;
+	uint64_t sum = 0;
+	unsigned int fail_count = 0;
+
+	for (i = 0; i < count; i++) {
+		if (image[i] < min)
+			min = image[i];
+		if (image[i] > max)
+			max = image[i];
+		sum += image[i];
+		fail_count += (image[i] < lower[i]) | (image[i] > upper[i]);
+	}
+
+	stats->min = min;
+	stats->max = max;
+	stats->sum = sum;
+	stats->fail_count = fail_count;
+}
+#endif
+
+/*
+ * load the limits of each node
+ *
+ * the limits file is a text file with tx * rx lower limits followed by tx * rx
+ * upper limits, in the order of the F$54 image. the values are separated by
+ * spaces, new lines or commas. without the limits file, the bist_min and the
+ * bist_max are applied to every node.
+ *
+ * struct mtouch_test_handle *test: test interface instance data
+ *
+ * return EOK: success
+ * otherwise, fail
+ */
+static int mtouch_test_load_limits(struct mtouch_test_handle *test)
+{
+	FILE *fp;
+	unsigned int i;
+	unsigned int value;
+	unsigned int count = test->rx * test->tx;
+	private_data_t *pvt_data = test->dev->pvt_data;
+
+	for (i = 0; i < count; i++) {
+		test->lower[i] = pvt_data->bist_min;
+		test->upper[i] = pvt_data->bist_max;
+	}
+
+	if ((!pvt_data->bist_limits) || ('\0' == pvt_data->bist_limits[0]))
+		return EOK;
+
+	fp = fopen(pvt_data->bist_limits, "r");
+	if (!fp) {
+		mtouch_error(MTOUCH_DEV, "%s: limits file %s not found",
+					__FUNCTION__, pvt_data->bist_limits);
+		return -ENOENT;
+	}
+
+	for (i = 0; i < count * 2; i++) {
+		if (1 != fscanf(fp, " %u ,", &value))
+			break;
+
+		if (i < count)
+			test->lower[i] = (value > 0xFFFF) ? 0xFFFF : value;
+		else
+			test->upper[i - count] = (value > 0xFFFF) ? 0xFFFF : value;
+	}
+
+	fclose(fp);
+
+	if (i != count * 2) {
+		mtouch_error(MTOUCH_DEV, "%s: %d values in %s, %d expected",
+					__FUNCTION__, i, pvt_data->bist_limits, count * 2);
+		return -EINVAL;
+	}
+
+	mtouch_info(MTOUCH_DEV, "%s: limits of %d nodes loaded from %s",
+				__FUNCTION__, count, pvt_data->bist_limits);
+
+	return EOK;
+}
+
+/*
+ * release the test interface instance data
+ *
+ * struct mtouch_test_handle *test: test interface instance data
+ */
+static void mtouch_test_release(struct mtouch_test_handle *test)
+{
+	if (test->image)
+		free(test->image);
+	if (test->lower)
+		free(test->lower);
+	if (test->upper)
+		free(test->upper);
+
+	mtouch_close_dev(test->dev);
+
+	free(test);
+}
+
+/*
+ * initialize the test driver interface
+ *
+ * the device is brought up without the interrupt thread and without
+ * connecting to the Input Events library. the options are taken from the
+ * environment variable MTOUCH_TEST_OPTIONS_ENV, the bus is not guessed.
+ * MTOUCH_TEST_OVERRIDES keeps the F$54 capture engine and the health
+ * monitor off in the test instance.
+ *
+ * return the handle passed to the other test functions
+ * NULL, fail
+ */
+void *mtouch_test_init(void)
+{
+	int retval;
+	const char *env;
+	char *options;
+	unsigned int count;
+	struct mtouch_test_handle *test;
+
+	env = getenv(MTOUCH_TEST_OPTIONS_ENV);
+	if ((!env) || (!strstr(env, MTOUCH_TEST_BUS_OPTION))) {
+		mtouch_error(MTOUCH_DEV, "%s: %s must give the bus, %s<device>",
+					__FUNCTION__, MTOUCH_TEST_OPTIONS_ENV, MTOUCH_TEST_BUS_OPTION);
+		return NULL;
+	}
+
+	test = calloc(1, sizeof(struct mtouch_test_handle));
+	if (!test) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to allocate the test handle", __FUNCTION__);
+		return NULL;
+	}
+
+	// the later options take precedence
+	options = calloc(strlen(env) + sizeof(MTOUCH_TEST_OVERRIDES), sizeof(char));
+	if (!options) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to allocate the options", __FUNCTION__);
+		free(test);
+		return NULL;
+	}
+	strcpy(options, env);
+	strcat(options, MTOUCH_TEST_OVERRIDES);
+
+	test->dev = mtouch_open_dev(options);
+	free(options);
+	if (!test->dev) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to open the device", __FUNCTION__);
+		goto exit;
+	}
+
+	// the BIST is available on the device with F$54 only
+	if (!test->dev->rmi4_data->f54) {
+		mtouch_info(MTOUCH_DEV, "%s: f54 not found, bist is not supported", __FUNCTION__);
+		return test;
+	}
+
+	retval = synaptics_rmi4_f54_get_electrodes(test->dev->rmi4_data, &test->rx, &test->tx);
+	if (retval < 0) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to get the electrodes", __FUNCTION__);
+		goto exit;
+	}
+
+	// the buffers are aligned for the vector kernel
+	count = test->rx * test->tx;
+	test->image = memalign(16, count * sizeof(uint16_t));
+	test->lower = memalign(16, count * sizeof(uint16_t));
+	test->upper = memalign(16, count * sizeof(uint16_t));
+	if ((!test->image) || (!test->lower) || (!test->upper)) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to allocate the image buffers", __FUNCTION__);
+		goto exit;
+	}
+
+	retval = mtouch_test_load_limits(test);
+	if (retval < 0) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to load the limits", __FUNCTION__);
+		goto exit;
+	}
+
+	mtouch_info(MTOUCH_DEV, "%s: rx = %d, tx = %d", __FUNCTION__, test->rx, test->tx);
+
+	return test;
+
+exit:
+	mtouch_test_release(test);
+
+	return NULL;
+}
+
+/*
+ * clean up the test driver interface
+ *
+ * void* dev: handle returned by mtouch_test_init()
+ */
+void mtouch_test_fini(void* dev)
+{
+	struct mtouch_test_handle *test = (struct mtouch_test_handle *)dev;
+
+	if (!test)
+		return;
+
+	mtouch_test_release(test);
+}
+
+/*
+ * run the built-in-self-test
+ *
+ * the full raw capacitance image is captured through F$54, and every node is
+ * checked against its limits
+ *
+ * void* dev: handle returned by mtouch_test_init()
+ * uint8_t* passfail: 1 = all nodes within the limits, 0 = otherwise
+ * uint16_t* max: maximum value of the image
+ * uint16_t* min: minimum value of the image
+ *
+ * return MTOUCH_TEST_RESULT_*
+ */
+int mtouch_test_bist(void* dev, uint8_t* passfail, uint16_t* max, uint16_t* min)
+{
+	int retval;
+	unsigned int i;
+	unsigned int count;
+	unsigned int logged = 0;
+	struct mtouch_test_stats stats;
+	struct mtouch_test_handle *test = (struct mtouch_test_handle *)dev;
+	struct synaptics_rmi4_data *rmi4_data;
+
+	if ((!test) || (!test->image))
+		return MTOUCH_TEST_RESULT_NOT_SUPPORTED;
+
+	if ((!passfail) || (!max) || (!min)) {
+		mtouch_error(MTOUCH_DEV, "%s: invalid output pointer", __FUNCTION__);
+		return MTOUCH_TEST_RESULT_NOT_SUPPORTED;
+	}
+
+	rmi4_data = test->dev->rmi4_data;
+	count = test->rx * test->tx;
+
+	// the firmware update is in progress
+	if (EOK != pthread_mutex_trylock(&rmi4_data->rmi4_fwu_mutex))
+		return MTOUCH_TEST_RESULT_NOT_NOW;
+
+	retval = synaptics_rmi4_f54_read_image(rmi4_data, F54_FULL_RAW_CAP_NO_RX_COUPLING,
+				test->image, count);
+
+	pthread_mutex_unlock(&rmi4_data->rmi4_fwu_mutex);
+
+	if (-ETIMEDOUT == retval) {
+		mtouch_error(MTOUCH_DEV, "%s: timeout waiting for the full raw capacitance", __FUNCTION__);
+		return MTOUCH_TEST_RESULT_TIMEOUT;
+	}
+	if (retval < 0) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to read the full raw capacitance", __FUNCTION__);
+		return MTOUCH_TEST_RESULT_I2C_FAILURE;
+	}
+
+	mtouch_test_image_stats(test->image, test->lower, test->upper, count, &stats);
+
+	*passfail = (0 == stats.fail_count) ? 1 : 0;
+	*max = stats.max;
+	*min = stats.min;
+
+	mtouch_info(MTOUCH_DEV, "%s: min = %d, max = %d, mean = %d, %d nodes failed",
+				__FUNCTION__, stats.min, stats.max, (int)(stats.sum / count), stats.fail_count);
+
+	// the failed nodes are located in the slow path, only when the BIST fails
+	for (i = 0; (i < count) && (logged < stats.fail_count) && (logged < MTOUCH_TEST_LOG_NODES); i++) {
+		if ((test->image[i] < test->lower[i]) || (test->image[i] > test->upper[i])) {
+			mtouch_warn(MTOUCH_DEV, "%s: tx %d rx %d = %d, limits [%d, %d]",
+						__FUNCTION__, i / test->rx, i % test->rx,
+						test->image[i], test->lower[i], test->upper[i]);
+			logged++;
+		}
+	}
+
+	return MTOUCH_TEST_RESULT_COMPLETED;
+}
+
+/*
+ * helper function to return an ID to the caller
+ * the first byte is the number of the additional bytes
+ *
+ * struct mtouch_test_handle *test: test interface instance data
+ * const unsigned char *id: the ID
+ * unsigned int length: size of the ID, in bytes
+ *
+ * return the buffer of the ID
+ */
+static uint8_t *mtouch_test_set_id(struct mtouch_test_handle *test,
+			const unsigned char *id, unsigned int length)
+{
+	if (length > MTOUCH_TEST_ID_SIZE - 1)
+		length = MTOUCH_TEST_ID_SIZE - 1;
+
+	test->id[0] = length;
+	memcpy(&test->id[1], id, length);
+
+	return test->id;
+}
+
+/*
+ * read the supplier ID, the manufacturer ID in F$01
+ *
+ * void* dev: handle returned by mtouch_test_init()
+ * uint8_t** supplier: the supplier ID
+ *
+ * return MTOUCH_TEST_RESULT_*
+ */
+int mtouch_test_read_supplier_id(void* dev, uint8_t** supplier)
+{
+	struct mtouch_test_handle *test = (struct mtouch_test_handle *)dev;
+
+	if ((!test) || (!supplier))
+		return MTOUCH_TEST_RESULT_NOT_SUPPORTED;
+
+	*supplier = mtouch_test_set_id(test,
+				&test->dev->rmi4_data->rmi4_mod_info.manufacturer_id, 1);
+
+	return MTOUCH_TEST_RESULT_COMPLETED;
+}
+
+/*
+ * read the serial ID
+ * the date code, the tester ID and the serial number in F$01 query 4 - 10
+ *
+ * void* dev: handle returned by mtouch_test_init()
+ * uint8_t** serial: the serial ID
+ *
+ * return MTOUCH_TEST_RESULT_*
+ */
+int mtouch_test_read_serial_id(void* dev, uint8_t** serial)
+{
+	int retval;
+	unsigned char data[7];
+	struct mtouch_test_handle *test = (struct mtouch_test_handle *)dev;
+	struct synaptics_rmi4_data *rmi4_data;
+
+	if ((!test) || (!serial))
+		return MTOUCH_TEST_RESULT_NOT_SUPPORTED;
+
+	rmi4_data = test->dev->rmi4_data;
+
+	retval = synaptics_rmi4_reg_read(rmi4_data,
+				rmi4_data->f01->base_addr.query_base + 4,
+				data,
+				sizeof(data));
+	if (retval < 0) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to read the serial number", __FUNCTION__);
+		return MTOUCH_TEST_RESULT_I2C_FAILURE;
+	}
+
+	*serial = mtouch_test_set_id(test, data, sizeof(data));
+
+	return MTOUCH_TEST_RESULT_COMPLETED;
+}
+
+/*
+ * read the product ID string in F$01
+ *
+ * void* dev: handle returned by mtouch_test_init()
+ * uint8_t** product: the product ID
+ *
+ * return MTOUCH_TEST_RESULT_*
+ */
+int mtouch_test_read_product_id(void *dev, uint8_t** product)
+{
+	struct mtouch_test_handle *test = (struct mtouch_test_handle *)dev;
+	unsigned char *product_id;
+
+	if ((!test) || (!product))
+		return MTOUCH_TEST_RESULT_NOT_SUPPORTED;
+
+	product_id = test->dev->rmi4_data->rmi4_mod_info.product_id_string;
+
+	*product = mtouch_test_set_id(test, product_id,
+				strnlen((char *)product_id, PRODUCT_ID_SIZE));
+
+	return MTOUCH_TEST_RESULT_COMPLETED;
+}
+
+/*
+ * read the firmware version, the firmware build ID in little-endian
+ *
+ * void* dev: handle returned by mtouch_test_init()
+ * uint8_t** fwv: the firmware version
+ *
+ * return MTOUCH_TEST_RESULT_*
+ */
+int mtouch_test_read_firmware_version(void* dev, uint8_t** fwv)
+{
+	struct mtouch_test_handle *test = (struct mtouch_test_handle *)dev;
+
+	if ((!test) || (!fwv))
+		return MTOUCH_TEST_RESULT_NOT_SUPPORTED;
+
+	*fwv = mtouch_test_set_id(test, test->dev->rmi4_data->rmi4_mod_info.build_id,
+				BUILD_ID_SIZE);
+
+	return MTOUCH_TEST_RESULT_COMPLETED;
+}
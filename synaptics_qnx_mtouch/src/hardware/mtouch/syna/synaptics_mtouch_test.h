@@ -0,0 +1,119 @@
+/*
+ * $QNXLicenseC:
+ * Copyright 2010, QNX Software Systems.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You
+ * may not reproduce, modify or distribute this software except in
+ * compliance with the License. You may obtain a copy of the License
+ * at: http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OF ANY KIND, either express or implied.
+ *
+ * This file may contain contributions from others, either as
+ * contributors under the License or as licensors under other terms.
+ * Please review this entire file for other proprietary rights or license
+ * notices, as well as the QNX Development Suite License Guide at
+ * http://licensing.qnx.com/license-guide/ for other information.
+ * $
+ */
+
+/*
+ * Synaptics Touchscreen driver
+ *
+ * Copyright (C) 2012-2018 Synaptics Incorporated. All rights reserved.
+ *
+ * The hardware access library is included from QNX software, and the
+ * mtouch framework is also included from install/usr/input/. Both of
+ * libraries are under Apache-2.0.
+ *
+ * Synaptics Touchscreen driver is interacted with QNX software system
+ * as a touchscreen controller, for its licensing rule and related notices,
+ * please scroll down the text to browse all of it.
+ *
+ * INFORMATION CONTAINED IN THIS DOCUMENT IS PROVIDED "AS-IS," AND SYNAPTICS
+ * EXPRESSLY DISCLAIMS ALL EXPRESS AND IMPLIED WARRANTIES, INCLUDING ANY
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE,
+ * AND ANY WARRANTIES OF NON-INFRINGEMENT OF ANY INTELLECTUAL PROPERTY RIGHTS.
+ * IN NO EVENT SHALL SYNAPTICS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, PUNITIVE, OR CONSEQUENTIAL DAMAGES ARISING OUT OF OR IN CONNECTION
+ * WITH THE USE OF THE INFORMATION CONTAINED IN THIS DOCUMENT, HOWEVER CAUSED
+ * AND BASED ON ANY THEORY OF LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, AND EVEN IF SYNAPTICS WAS ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE. IF A TRIBUNAL OF COMPETENT JURISDICTION DOES
+ * NOT PERMIT THE DISCLAIMER OF DIRECT DAMAGES OR ANY OTHER DAMAGES, SYNAPTICS'
+ * TOTAL CUMULATIVE LIABILITY TO ANY PARTY SHALL NOT EXCEED ONE HUNDRED U.S.
+ * DOLLARS.
+ *
+ */
+
+
+#ifndef _SYNAPTICS_MTOUCH_TEST_H_
+#define _SYNAPTICS_MTOUCH_TEST_H_
+
+
+/*
+ * the test interface brings up the device by itself,
+ * the options are taken from this environment variable, which must name the
+ * bus with i2c_devname. the format is the same as the options in graphics.conf
+ * the overrides are appended, the test instance runs neither the F$54 capture
+ * engine nor the health monitor
+ */
+#define MTOUCH_TEST_OPTIONS_ENV		"MTOUCH_SYNA_OPTIONS"
+#define MTOUCH_TEST_BUS_OPTION		"i2c_devname="
+#define MTOUCH_TEST_OVERRIDES		",f54_capture=0,health_interval=0"
+
+/*
+ * default limits of the BIST, applied to every node
+ */
+#define MTOUCH_TEST_BIST_MIN		(0)
+#define MTOUCH_TEST_BIST_MAX		(0xFFFF)
+
+/*
+ * size of the buffers for the IDs, the first byte is the length
+ */
+#define MTOUCH_TEST_ID_SIZE			(PRODUCT_ID_SIZE + 2)
+
+/*
+ * number of failed nodes printed in the log
+ */
+#define MTOUCH_TEST_LOG_NODES		(16)
+
+/*
+ * statistics of one image
+ *
+ * min: minimum value
+ * max: maximum value
+ * sum: sum of all nodes
+ * fail_count: number of nodes out of their limits
+ */
+struct mtouch_test_stats {
+	uint16_t min;
+	uint16_t max;
+	uint64_t sum;
+	unsigned int fail_count;
+};
+
+/*
+ * test interface instance data
+ *
+ * dev: mtouch device instance data
+ * rx: number of receiver electrodes
+ * tx: number of transmitter electrodes
+ * image: the full raw capacitance image
+ * lower: lower limit of each node
+ * upper: upper limit of each node
+ * id: buffer for the IDs returned to the caller
+ */
+struct mtouch_test_handle {
+	syna_dev_t *dev;
+	unsigned char rx;
+	unsigned char tx;
+	uint16_t *image;
+	uint16_t *lower;
+	uint16_t *upper;
+	uint8_t id[MTOUCH_TEST_ID_SIZE];
+};
+
+#endif /* _SYNAPTICS_MTOUCH_TEST_H_ */
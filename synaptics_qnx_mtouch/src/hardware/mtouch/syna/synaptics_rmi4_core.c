@@ -55,9 +55,12 @@
 
 extern int synaptics_rmi4_fwu_init(struct synaptics_rmi4_data *rmi4_data, const unsigned char fn_version);
 extern void synaptics_rmi4_fwu_deinit(void);
+extern int synaptics_rmi4_fwu_get_config_id(unsigned char *config_id, unsigned int size);
 
 static syna_dev_t *g_syna_dev;
 
+static void synaptics_rmi4_empty_all_rmi_func(struct synaptics_rmi4_data *rmi4_data);
+
 /*
  * helper function to configure the page selected register
  * and update the rmi4_data->current_page to skip redundant i2c operation
@@ -214,39 +217,37 @@ exit:
 int synaptics_rmi4_int_enable(struct synaptics_rmi4_data *rmi4_data, bool enable)
 {
 	int retval = EOK;
-	unsigned char data = 0x00;
+	unsigned char data[MAX_INTR_REGISTERS] = {0};
 	unsigned short intr_addr;
 
 	_CHECK_POINTER(rmi4_data);
 	_CHECK_POINTER(rmi4_data->f01);
 
-	if (rmi4_data->num_of_intr_regs > 1)
-		mtouch_warn(MTOUCH_DEV,  "%s: configure 1 interrupt source only", __FUNCTION__);
-
+	// the interrupt enable registers are located next to the device control register
+	// one register for every 8 interrupt sources
 	intr_addr = rmi4_data->f01->base_addr.ctrl_base + 1;
 
-	if (0x00 != rmi4_data->intr_mask) {
+	if (0 == memcmp(rmi4_data->intr_mask, data, rmi4_data->num_of_intr_regs))
+		return retval;
 
-		if (enable) {
-			retval = synaptics_rmi4_reg_write(rmi4_data,
-						intr_addr,
-						&(rmi4_data->intr_mask),
-						sizeof(rmi4_data->intr_mask));
-			if (retval < 0) {
-				mtouch_error(MTOUCH_DEV,  "%s: fail to configure rmi reg 0x%x", __FUNCTION__, intr_addr);
-				return retval;
-			}
+	if (enable) {
+		retval = synaptics_rmi4_reg_write(rmi4_data,
+					intr_addr,
+					rmi4_data->intr_mask,
+					rmi4_data->num_of_intr_regs);
+		if (retval < 0) {
+			mtouch_error(MTOUCH_DEV,  "%s: fail to configure rmi reg 0x%x", __FUNCTION__, intr_addr);
+			return retval;
 		}
-		else {
-			data = 0x00;
-			retval = synaptics_rmi4_reg_write(rmi4_data,
-						intr_addr,
-						&data,
-						sizeof(data));
-			if (retval < 0) {
-				mtouch_error(MTOUCH_DEV,  "%s: fail to set rmi reg 0x%x to zero", __FUNCTION__, intr_addr);
-				return retval;
-			}
+	}
+	else {
+		retval = synaptics_rmi4_reg_write(rmi4_data,
+					intr_addr,
+					data,
+					rmi4_data->num_of_intr_regs);
+		if (retval < 0) {
+			mtouch_error(MTOUCH_DEV,  "%s: fail to set rmi reg 0x%x to zero", __FUNCTION__, intr_addr);
+			return retval;
 		}
 	}
 
@@ -284,6 +285,55 @@ int synaptics_rmi4_sw_reset(struct synaptics_rmi4_data *rmi4_data)
 	return EOK;
 }
 
+/*
+ * apply the palm / large object policy to the touch report
+ * once a palm is detected, all active contacts are cancelled and the Input Events
+ * library is notified with the LARGE_OBJECT and CANCEL flags along with the next packet;
+ * after that, the report is suppressed until no object is present on the sensor
+ * the caller should hold the rmi4_report_mutex
+ *
+ * struct synaptics_rmi4_data *rmi4_data: RMI4 device instance data
+ * unsigned char palm_count: number of palms detected in this frame
+ * unsigned char object_count: number of objects present in this frame
+ * unsigned char touch_count: number of fingers reported in this frame
+ *
+ * return the number of touch points to report
+ */
+static unsigned char synaptics_rmi4_large_object_filter(struct synaptics_rmi4_data *rmi4_data,
+			unsigned char palm_count, unsigned char object_count, unsigned char touch_count)
+{
+	unsigned char finger;
+
+	if (!g_syna_dev->pvt_data->palm_suppression)
+		return touch_count;
+
+	if (palm_count) {
+		if (!g_syna_dev->large_object) {
+			mtouch_info(MTOUCH_DEV, "%s: large object detected, cancel %d contacts",
+					__FUNCTION__, touch_count);
+
+			g_syna_dev->large_object = true;
+			g_syna_dev->parser_flags = MTOUCH_PARSER_FLAG_LARGE_OBJECT | MTOUCH_PARSER_FLAG_CANCEL;
+		}
+	}
+	else if ((g_syna_dev->large_object) && (0 == object_count)) {
+		mtouch_info(MTOUCH_DEV, "%s: large object lifted", __FUNCTION__);
+
+		g_syna_dev->large_object = false;
+	}
+
+	if (!g_syna_dev->large_object)
+		return touch_count;
+
+	// set all supported fingers as FINGER_LEAVE
+	for (finger = 0; finger < rmi4_data->num_of_fingers; finger++) {
+		if (FINGER_LANDING == g_syna_dev->touch_report[finger].is_touched)
+			g_syna_dev->touch_report[finger].is_touched = FINGER_LIFTING;
+	}
+
+	return 0;
+}
+
 /*
  * collect the touch report from RMI F$11
  *
@@ -383,6 +433,11 @@ static int synaptics_rmi4_f11_abs_report(void *input)
 		}
 	}
 
+	// apply the driver-side filter chain
+	if (g_syna_dev->filter)
+		synaptics_mtouch_filter_process(g_syna_dev->filter, g_syna_dev->touch_report,
+					fingers_supported, g_syna_dev->timestamp);
+
 exit:
 	pthread_mutex_unlock(&rmi4_data->rmi4_report_mutex);
 
@@ -403,6 +458,8 @@ static int synaptics_rmi4_f12_abs_report(void *input)
 
 	int retval;
 	unsigned char touch_count = 0;  // number of touch points
+	unsigned char palm_count = 0;   // number of palms detected
+	unsigned char object_count = 0; // number of objects present
 	unsigned char index;
 	unsigned char finger;
 	unsigned char fingers_to_process;
@@ -462,12 +519,18 @@ static int synaptics_rmi4_f12_abs_report(void *input)
 	fingers_to_process = (fingers_to_process > objects_already_present)?
 						fingers_to_process : objects_already_present;
 	if (0 == fingers_to_process) {
+		pthread_mutex_lock(&rmi4_data->rmi4_report_mutex);
+
 		// set all supported fingers as FINGER_LEAVE
 		for (finger = 0; finger < rmi4_data->num_of_fingers; finger++) {
 			if (FINGER_LANDING == g_syna_dev->touch_report[finger].is_touched)
 				g_syna_dev->touch_report[finger].is_touched = FINGER_LIFTING;
 		}
 
+		synaptics_rmi4_large_object_filter(rmi4_data, 0, 0, 0);
+
+		pthread_mutex_unlock(&rmi4_data->rmi4_report_mutex);
+
 		return 0;
 	}
 
@@ -496,6 +559,9 @@ static int synaptics_rmi4_f12_abs_report(void *input)
 		wx = finger_data->wx;
 		wy = finger_data->wy;
 
+		if (finger_status)
+			object_count++;
+
 		switch (finger_status) {
 		case F12_FINGER_STATUS:
 		case F12_GLOVED_FINGER_STATUS:
@@ -516,6 +582,8 @@ static int synaptics_rmi4_f12_abs_report(void *input)
 		case F12_PALM_STATUS:
 			mtouch_info(MTOUCH_DEV, "%s: (palm %d detected ) x = %d, y = %d, wx = %d, wy = %d",
 					__FUNCTION__, finger, x, y, wx, wy);
+
+			palm_count++;
 			break;
 
 		default:
@@ -536,25 +604,90 @@ static int synaptics_rmi4_f12_abs_report(void *input)
 		}
 	}
 
+	touch_count = synaptics_rmi4_large_object_filter(rmi4_data,
+						palm_count, object_count, touch_count);
+
+	// apply the driver-side filter chain
+	if (g_syna_dev->filter)
+		synaptics_mtouch_filter_process(g_syna_dev->filter, g_syna_dev->touch_report,
+					rmi4_data->num_of_fingers, g_syna_dev->timestamp);
+
 	pthread_mutex_unlock(&rmi4_data->rmi4_report_mutex);
 
 	return touch_count;
 }
 
+/*
+ * collect the button report from RMI F$1A
+ * each bit of the data register stands for the state of one 0D button
+ *
+ * void *: should be the struct synaptics_rmi4_data *
+ *
+ * return >=0: number of buttons pressed
+ * otherwise, fail
+ */
+static int synaptics_rmi4_f1a_button_report(void *input)
+{
+	struct synaptics_rmi4_data *rmi4_data = (struct synaptics_rmi4_data *)input;
+
+	int retval;
+	unsigned char button;
+	unsigned char *data;
+	unsigned int button_state = 0;
+	int button_count = 0;
+
+	_CHECK_POINTER(g_syna_dev);
+	_CHECK_POINTER(rmi4_data->f1a->data);
+
+	data = (unsigned char *)rmi4_data->f1a->data;
+
+	retval = synaptics_rmi4_reg_read(rmi4_data,
+				rmi4_data->f1a->base_addr.data_base,
+				data,
+				rmi4_data->f1a->data_size);
+	if (retval < 0) {
+		mtouch_error(MTOUCH_DEV, "%s: fail to read f1a reg 0x%x",
+					__FUNCTION__, rmi4_data->f1a->base_addr.data_base);
+		return -EIO;
+	}
+
+	for (button = 0; button < rmi4_data->valid_button_count; button++) {
+		if (data[button / 8] & (1 << (button % 8))) {
+			button_state |= 1 << button;
+			button_count++;
+		}
+	}
+
+	mtouch_info(MTOUCH_DEV, "%s: button state = 0x%02x", __FUNCTION__, button_state);
+
+	pthread_mutex_lock(&rmi4_data->rmi4_report_mutex);
+	g_syna_dev->button_state = button_state;
+	pthread_mutex_unlock(&rmi4_data->rmi4_report_mutex);
+
+	return button_count;
+}
+
 /*
  * prepare the sensor report, which is called by ISR
  * use interrupt status information to determine the source that are flagging the interrupt
  *
+ * every pending source in the interrupt dispatch table is serviced in one pass,
+ * so that the sources coalesced in one interrupt are not lost
+ *
  * struct synaptics_rmi4_data *rmi4_data: RMI4 device instance data
  *
- * return EOK: finish
+ * return >=0: bitmask of the sources serviced, INTERRUPT_STATUS_*
  * otherwise, fail
  */
 int synaptics_rmi4_sersor_report(struct synaptics_rmi4_data *rmi4_data)
 {
 	int retval;
+	int sources = 0;
+	unsigned char ii;
+	unsigned char reg;
 	unsigned char data[MAX_INTR_REGISTERS + 1];
 	struct synaptics_rmi4_f01_device_status status;
+	struct synaptics_rmi4_intr_handler *handler;
 
 	_CHECK_POINTER(g_syna_dev);
 	_CHECK_POINTER(rmi4_data);
@@ -572,64 +705,89 @@ int synaptics_rmi4_sersor_report(struct synaptics_rmi4_data *rmi4_data)
 	status.data[0] = data[0];
 	if (status.unconfigured && !status.flash_prog) {
 		mtouch_info(MTOUCH_DEV, "%s: spontaneous reset detected", __FUNCTION__);
-	}
 
-	// check-and-compare the interrupt mask
-	// find the source of the interrupt accordingly
-	if (data[1] & INTERRUPT_STATUS_FLASH) {
-		_CHECK_POINTER(rmi4_data->f34);
-		if ((data[1] & rmi4_data->f34->intr_mask) &&
-			(rmi4_data->f34->attn_handle != NULL)) {
-			rmi4_data->f34->attn_handle(rmi4_data);
+		// the interrupt status belongs to the reset, skip the dispatch
+		retval = synaptics_rmi4_recover(rmi4_data);
+		if (retval < 0) {
+			mtouch_error(MTOUCH_DEV, "%s: failed to recover from the reset", __FUNCTION__);
+			return retval;
 		}
 
-		retval = INTERRUPT_STATUS_FLASH;
+		return INTERRUPT_STATUS_RESET;
 	}
-	if (data[1] & INTERRUPT_STATUS_DEVICE) {
-		_CHECK_POINTER(rmi4_data->f01);
-		if ((data[1] & rmi4_data->f01->intr_mask) &&
-			(rmi4_data->f01->attn_handle != NULL)) {
-			rmi4_data->f01->attn_handle(rmi4_data);
-		}
 
-		retval = INTERRUPT_STATUS_DEVICE;
-	}
-	if (data[1] & INTERRUPT_STATUS_TOUCH) {
-		if (rmi4_data->f11) {
-			if ((data[1] & rmi4_data->f11->intr_mask) &&
-				(rmi4_data->f11->attn_handle != NULL)) {
-				g_syna_dev->touch_count = rmi4_data->f11->attn_handle(rmi4_data);
-			}
+	// check-and-compare the interrupt mask of each entry in the dispatch table
+	// and service all the sources flagging the interrupt
+	for (ii = 0; ii < rmi4_data->num_of_intr_handlers; ii++) {
+		handler = &rmi4_data->intr_handlers[ii];
+
+		// the interrupt status registers follow the device status register
+		for (reg = 0; reg < rmi4_data->num_of_intr_regs; reg++) {
+			if (data[1 + reg] & handler->fn->intr_mask[reg])
+				break;
 		}
-		else if (rmi4_data->f12) {
-			if ((data[1] & rmi4_data->f12->intr_mask) &&
-				(rmi4_data->f12->attn_handle != NULL)) {
-				g_syna_dev->touch_count = rmi4_data->f12->attn_handle(rmi4_data);
+		if (reg == rmi4_data->num_of_intr_regs)
+			continue;
+
+		if (handler->fn->attn_handle != NULL) {
+			retval = handler->fn->attn_handle(rmi4_data);
+			if (retval < 0) {
+				mtouch_error(MTOUCH_DEV, "%s: failed to service F%02x interrupt",
+							__FUNCTION__, handler->fn->func_num);
+				continue;
 			}
-		}
 
-		retval = INTERRUPT_STATUS_TOUCH;
-	}
-	if (data[1] & INTERRUPT_STATUS_BUTTON) {
-		_CHECK_POINTER(rmi4_data->f1a);
-		if ((data[1] & rmi4_data->f1a->intr_mask) &&
-			(rmi4_data->f1a->attn_handle != NULL)) {
-			rmi4_data->f1a->attn_handle(rmi4_data);
+			if (INTERRUPT_STATUS_TOUCH == handler->status)
+				g_syna_dev->touch_count = retval;
 		}
 
-		retval = INTERRUPT_STATUS_BUTTON;
+		sources |= handler->status;
 	}
-	if (data[1] & INTERRUPT_STATUS_SENSOR) {
-		_CHECK_POINTER(rmi4_data->f55);
-		if ((data[1] & rmi4_data->f55->intr_mask) &&
-			(rmi4_data->f55->attn_handle != NULL)) {
-			rmi4_data->f55->attn_handle(rmi4_data);
-		}
 
-		retval = INTERRUPT_STATUS_SENSOR;
-	}
+	return sources;
+}
 
-	return retval;
+/*
+ * check the health of the controller, which is called by the health monitor
+ * while no interrupt has arrived for a while
+ *
+ * only the device status is read from F$01, the interrupt status is not
+ * touched since it is cleared by the read. a lost ATTN is detected by the
+ * health monitor, which services the pending interrupt status.
+ * the caller must hold the thread_mutex.
+ *
+ * struct synaptics_rmi4_data *rmi4_data: RMI4 device instance data
+ *
+ * return >=0: the health, enum synaptics_rmi4_health
+ * otherwise, fail
+ */
+int synaptics_rmi4_check_health(struct synaptics_rmi4_data *rmi4_data)
+{
+	int retval;
+	struct synaptics_rmi4_f01_device_status status;
+
+	_CHECK_POINTER(rmi4_data);
+	_CHECK_POINTER(rmi4_data->f01);
+
+	retval = synaptics_rmi4_reg_read(rmi4_data,
+				rmi4_data->f01->base_addr.data_base,
+				status.data,
+				sizeof(status.data));
+	if (retval < 0)
+		return HEALTH_NO_RESPONSE;
+
+	// the controller was reset, but the interrupt was not serviced
+	if (status.unconfigured && !status.flash_prog)
+		return HEALTH_RESET;
+
+	if ((STATUS_CONFIG_CRC_FAILURE == status.status_code) ||
+		(STATUS_FIRMWARE_CRC_FAILURE == status.status_code))
+		return HEALTH_BAD_CRC;
+
+	if (STATUS_DEVICE_FAILURE == status.status_code)
+		return HEALTH_DEVICE_FAILURE;
+
+	return HEALTH_OK;
 }
 
 /*
@@ -1080,6 +1238,49 @@ exit:
 }
 
 
+/*
+ * Function $1A initialization
+ * f1a implements the 0D capacitive buttons
+ *
+ * struct synaptics_rmi4_data *rmi4_data: RMI4 device instance data
+ *
+ * return EOK: complete f1a initialization
+ * otherwise, fail
+ */
+static int synaptics_rmi4_f1a_init(struct synaptics_rmi4_data *rmi4_data)
+{
+	int retval;
+	unsigned short reg_addr;
+	struct synaptics_rmi4_f1a_query query;
+
+	_CHECK_POINTER(rmi4_data);
+	_CHECK_POINTER(rmi4_data->f1a);
+
+	// maximum number of buttons supported
+	reg_addr = rmi4_data->f1a->base_addr.query_base;
+	retval = synaptics_rmi4_reg_read(rmi4_data, reg_addr, query.data, sizeof(query.data));
+	if (retval < 0) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to read register 0x%04x", __FUNCTION__, reg_addr);
+		return -EIO;
+	}
+
+	rmi4_data->valid_button_count = query.max_button_count + 1;
+
+	// buffer to read the button data, one bit per button
+	rmi4_data->f1a->data_size = (rmi4_data->valid_button_count + 7) / 8;
+	rmi4_data->f1a->data = calloc(rmi4_data->f1a->data_size, sizeof(unsigned char));
+	if (!rmi4_data->f1a->data) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to allocate memory for f1a data", __FUNCTION__);
+		return -ENOMEM;
+	}
+
+	mtouch_info(MTOUCH_DEV, "%s: number of buttons = %d",
+				__FUNCTION__, rmi4_data->valid_button_count);
+
+	return EOK;
+}
+
+
 /*
  * helper function to complete the device configuration
  *
@@ -1118,249 +1319,821 @@ static int synaptics_rmi4_set_configured(struct synaptics_rmi4_data *rmi4_data)
 	return EOK;
 }
 
+/*
+ * re-apply the settings of the controller from the cached values
+ * the register map is not changed, so the PDT is not scanned again:
+ *    - the page select register, back to 0 after a reset
+ *    - the interrupt enables, rmi4_data->intr_mask
+ *    - the CONFIGURED bit of F$01
+ * the contacts reported before are released. the reset counters are not
+ * touched, the health monitor applies this to faults other than a reset
+ *
+ * struct synaptics_rmi4_data *rmi4_data: RMI4 device instance data
+ *
+ * return EOK: complete
+ * otherwise, fail
+ */
+int synaptics_rmi4_restore_settings(struct synaptics_rmi4_data *rmi4_data)
+{
+	int retval;
+	unsigned char ii;
+
+	_CHECK_POINTER(rmi4_data);
+	_CHECK_POINTER(g_syna_dev);
+
+	// force the page to be written at the next access
+	pthread_mutex_lock(&rmi4_data->rmi4_io_ctrl_mutex);
+	rmi4_data->current_page = MASK_8BIT;
+	pthread_mutex_unlock(&rmi4_data->rmi4_io_ctrl_mutex);
+
+	retval = synaptics_rmi4_int_enable(rmi4_data, true);
+	if (retval < 0) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to enable the interrupts", __FUNCTION__);
+		return retval;
+	}
+
+	retval = synaptics_rmi4_set_configured(rmi4_data);
+	if (retval < 0) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to set configured", __FUNCTION__);
+		return retval;
+	}
+
+	// release all contacts
+	pthread_mutex_lock(&rmi4_data->rmi4_report_mutex);
+	if (g_syna_dev->touch_report) {
+		for (ii = 0; ii < rmi4_data->num_of_fingers; ii++)
+			g_syna_dev->touch_report[ii].is_touched = FINGER_LIFTING;
+	}
+	g_syna_dev->touch_count = 0;
+	g_syna_dev->button_state = 0;
+	pthread_mutex_unlock(&rmi4_data->rmi4_report_mutex);
+
+	return EOK;
+}
+
+/*
+ * recover from a spontaneous reset of the controller
+ * the settings lost in the reset are re-applied by synaptics_rmi4_restore_settings(),
+ * and the reset is counted with the time of the recovery
+ *
+ * struct synaptics_rmi4_data *rmi4_data: RMI4 device instance data
+ *
+ * return EOK: complete the recovery
+ * otherwise, fail
+ */
+int synaptics_rmi4_recover(struct synaptics_rmi4_data *rmi4_data)
+{
+	int retval;
+	uint64_t start;
+	uint64_t end;
+
+	_CHECK_POINTER(rmi4_data);
+
+	ClockTime(CLOCK_MONOTONIC, NULL, &start);
+
+	retval = synaptics_rmi4_restore_settings(rmi4_data);
+	if (retval < 0)
+		return retval;
+
+	ClockTime(CLOCK_MONOTONIC, NULL, &end);
+
+	rmi4_data->reset_count++;
+	rmi4_data->recovery_time = (unsigned int)((end - start) / 1000);
+	if (rmi4_data->recovery_time > rmi4_data->recovery_time_max)
+		rmi4_data->recovery_time_max = rmi4_data->recovery_time;
+
+	mtouch_info(MTOUCH_DEV, "%s: recovered in %d us (resets = %d, max = %d us)",
+				__FUNCTION__, rmi4_data->recovery_time, rmi4_data->reset_count,
+				rmi4_data->recovery_time_max);
+
+	return EOK;
+}
+
 /*
  * helper function to setup the synaptics_rmi4_fn
  *
  * save the base address of RMI command register, RMI query register, RMI control register,
  * and RMI data register. The interrupt mask is initialized as well
  *
+ * the interrupt sources are numbered in the PDT order, so the sources of the function
+ * occupy the bits from intr_count to (intr_count + intr_src_count - 1), which may spread
+ * over several interrupt registers
+ *
  * struct synaptics_rmi4_fn_desc rmi_fd: a particular function descriptor fields in PDT entry
  * struct synaptics_rmi4_fn *rmi_fn    : a particular RMI Function
  * unsigned char page                  : page located
- * unsigned char int_msk               : interrupt mask
+ * unsigned char intr_count            : number of interrupt sources ahead of this function
  *
  * return void
  */
 static void synaptics_rmi4_set_func(struct synaptics_rmi4_fn_desc rmi_fd, struct synaptics_rmi4_fn *rmi_fn,
-							unsigned char page, unsigned char int_msk)
+							unsigned char page, unsigned char intr_count)
 {
+	unsigned int bit;
+
 	rmi_fn->base_addr.cmd_base   = (page << 8) | rmi_fd.cmd_base_addr;
 	rmi_fn->base_addr.query_base = (page << 8) | rmi_fd.query_base_addr;
 	rmi_fn->base_addr.ctrl_base  = (page << 8) | rmi_fd.ctrl_base_addr;
 	rmi_fn->base_addr.data_base  = (page << 8) | rmi_fd.data_base_addr;
 
-	if (int_msk != 0xff)
-		rmi_fn->intr_mask = 1 << (int_msk);
+	memset(rmi_fn->intr_mask, 0x00, sizeof(rmi_fn->intr_mask));
+
+	for (bit = intr_count; bit < (unsigned int)(intr_count + rmi_fd.intr_src_count); bit++) {
+		if (bit >= (MAX_INTR_REGISTERS * 8)) {
+			mtouch_error(MTOUCH_DEV, "%s: F%02x interrupt source %d is out of range",
+						__FUNCTION__, rmi_fd.fn_number, bit);
+			break;
+		}
+
+		rmi_fn->intr_mask[bit / 8] |= 1 << (bit % 8);
+	}
 
 	rmi_fn->func_num = rmi_fd.fn_number;
 
 	return;
 }
 
+/*
+ * helper function to add the RMI function into the interrupt dispatch table
+ * the interrupt enable mask is updated as well
+ *
+ * struct synaptics_rmi4_data *rmi4_data: RMI4 device instance data
+ * struct synaptics_rmi4_fn *rmi_fn    : a particular RMI Function
+ * unsigned int status                 : source of interrupt reported, INTERRUPT_STATUS_*
+ *
+ * return void
+ */
+static void synaptics_rmi4_register_intr(struct synaptics_rmi4_data *rmi4_data,
+							struct synaptics_rmi4_fn *rmi_fn, unsigned int status)
+{
+	unsigned char reg;
+	unsigned char sources = 0;
+	struct synaptics_rmi4_intr_handler *handler;
+
+	for (reg = 0; reg < MAX_INTR_REGISTERS; reg++)
+		sources |= rmi_fn->intr_mask[reg];
+
+	// the function has no interrupt source
+	if (0 == sources)
+		return;
+
+	if (rmi4_data->num_of_intr_handlers >= MAX_RMI4_FUNCS) {
+		mtouch_error(MTOUCH_DEV, "%s: dispatch table is full, F%02x is not serviced",
+					__FUNCTION__, rmi_fn->func_num);
+		return;
+	}
+
+	handler = &rmi4_data->intr_handlers[rmi4_data->num_of_intr_handlers++];
+	handler->fn = rmi_fn;
+	handler->status = status;
+
+	for (reg = 0; reg < MAX_INTR_REGISTERS; reg++)
+		rmi4_data->intr_mask[reg] |= rmi_fn->intr_mask[reg];
+
+	return;
+}
+
 
 /*
- * to parse the Page Description Table (PDT) and reconstruct the entire
- * RMI register address map
+ * restore the parameters derived from the F$11 queries
+ * it replaces synaptics_rmi4_f11_init() when the PDT cache is valid
  *
- * the PDT is defined as a general properties query register,
- * followed by an array of Function Descriptors.  The contents of the
- * Page Description table are stored from high page offsets down towards
- * lower page offsets, starting at page offset PdtTop.
+ * struct synaptics_rmi4_data *rmi4_data: RMI4 device instance data
+ * const struct synaptics_rmi4_pdt_cache *cache: the PDT cache
+ *
+ * return EOK: complete f11 initialization
+ * otherwise, fail
+ */
+static int synaptics_rmi4_f11_restore(struct synaptics_rmi4_data *rmi4_data,
+							const struct synaptics_rmi4_pdt_cache *cache)
+{
+	_CHECK_POINTER(rmi4_data);
+	_CHECK_POINTER(rmi4_data->f11);
+
+	rmi4_data->num_of_fingers = cache->num_of_fingers;
+	rmi4_data->sensor_max_x = cache->sensor_max_x;
+	rmi4_data->sensor_max_y = cache->sensor_max_y;
+	rmi4_data->max_touch_width = cache->max_touch_width;
+
+	return EOK;
+}
+
+/*
+ * restore the parameters derived from the F$12 queries and controls
+ * it replaces synaptics_rmi4_f12_init() when the PDT cache is valid
  *
  * struct synaptics_rmi4_data *rmi4_data: RMI4 device instance data
+ * const struct synaptics_rmi4_pdt_cache *cache: the PDT cache
  *
- * return EOK: complete device query
+ * return EOK: complete f12 initialization
  * otherwise, fail
  */
-static int synaptics_rmi4_query_device(struct synaptics_rmi4_data *rmi4_data)
+static int synaptics_rmi4_f12_restore(struct synaptics_rmi4_data *rmi4_data,
+							const struct synaptics_rmi4_pdt_cache *cache)
 {
-	int retval;
+	_CHECK_POINTER(rmi4_data);
+	_CHECK_POINTER(rmi4_data->f12);
 
-	unsigned char page_number;
-	unsigned short pdt_entry_addr;
-	struct synaptics_rmi4_fn_desc rmi_fd;
+	rmi4_data->f12->extra = calloc(1, sizeof(struct synaptics_rmi4_f12_extra_data));
+	if (!rmi4_data->f12->extra) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to allocate memory for f12->extra", __FUNCTION__);
+		return -ENOMEM;
+	}
+	memcpy(rmi4_data->f12->extra, &cache->f12_extra, sizeof(struct synaptics_rmi4_f12_extra_data));
 
-	unsigned char intr_count = 0;
-	bool is_f01_found = false;
-	bool is_f34_found = false;
+	rmi4_data->num_of_fingers = cache->num_of_fingers;
+	rmi4_data->sensor_max_x = cache->sensor_max_x;
+	rmi4_data->sensor_max_y = cache->sensor_max_y;
+	rmi4_data->max_touch_width = cache->max_touch_width;
+	rmi4_data->report_enable = cache->report_enable;
 
-	unsigned char f01_query[F01_STD_QUERY_LEN] = {0};
+	rmi4_data->f12->data_size = rmi4_data->num_of_fingers * sizeof(struct synaptics_rmi4_f12_finger_data);
+	rmi4_data->f12->data = calloc(1, rmi4_data->f12->data_size);
+	if (!rmi4_data->f12->data) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to allocate private data for f12",
+					__FUNCTION__);
+		return -ENOMEM;
+	}
+
+	return EOK;
+}
 
+/*
+ * restore the number of buttons derived from the F$1A queries
+ * it replaces synaptics_rmi4_f1a_init() when the PDT cache is valid
+ *
+ * struct synaptics_rmi4_data *rmi4_data: RMI4 device instance data
+ * const struct synaptics_rmi4_pdt_cache *cache: the PDT cache
+ *
+ * return EOK: complete f1a initialization
+ * otherwise, fail
+ */
+static int synaptics_rmi4_f1a_restore(struct synaptics_rmi4_data *rmi4_data,
+							const struct synaptics_rmi4_pdt_cache *cache)
+{
 	_CHECK_POINTER(rmi4_data);
+	_CHECK_POINTER(rmi4_data->f1a);
 
-	memset(&rmi4_data->intr_mask, 0x00, sizeof(unsigned char));
+	rmi4_data->valid_button_count = cache->valid_button_count;
 
-	// Scan the page description tables of the pages to service
-	for (page_number = 0; page_number < PAGES_TO_SERVICE; page_number++) {
-		for (pdt_entry_addr = PDT_START; pdt_entry_addr > PDT_END; pdt_entry_addr -= PDT_ENTRY_SIZE) {
+	rmi4_data->f1a->data_size = (rmi4_data->valid_button_count + 7) / 8;
+	rmi4_data->f1a->data = calloc(rmi4_data->f1a->data_size, sizeof(unsigned char));
+	if (!rmi4_data->f1a->data) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to allocate memory for f1a data", __FUNCTION__);
+		return -ENOMEM;
+	}
 
-			pdt_entry_addr |= (page_number << 8);
+	return EOK;
+}
 
-            retval = synaptics_rmi4_reg_read(rmi4_data, pdt_entry_addr,
-            			(unsigned char *)&rmi_fd, sizeof(rmi_fd));
-            if (retval < 0)
-                return -EIO;
+/*
+ * helper function to set up one RMI function of the PDT
+ * the function handler is created and added to the interrupt dispatch table
+ *
+ * struct synaptics_rmi4_data *rmi4_data: RMI4 device instance data
+ * struct synaptics_rmi4_fn_desc rmi_fd: the function descriptor
+ * unsigned char page_number: the page of the function
+ * unsigned char intr_count: number of interrupt sources of the functions before
+ * const struct synaptics_rmi4_pdt_cache *cache: restore the derived parameters
+ *        from the cache, or NULL to read them from the device
+ *
+ * return EOK: success
+ * otherwise, fail
+ */
+static int synaptics_rmi4_add_func(struct synaptics_rmi4_data *rmi4_data,
+							struct synaptics_rmi4_fn_desc rmi_fd, unsigned char page_number,
+							unsigned char intr_count, const struct synaptics_rmi4_pdt_cache *cache)
+{
+	int retval;
 
-            pdt_entry_addr &= ~(MASK_8BIT << 8);
+	switch (rmi_fd.fn_number) {
 
-            if (rmi_fd.fn_number == 0) {
-                break;
-            }
+	case SYNAPTICS_RMI4_F01:	/* Function $01: RMI device control */
+		if (0 == rmi_fd.intr_src_count)
+			break;
 
-            if ((is_f01_found) && (is_f34_found) && (rmi_fd.fn_number == SYNAPTICS_RMI4_F34)) {
-                break;
-            }
+		rmi4_data->f01 = calloc(1, sizeof(struct synaptics_rmi4_fn));
+		if (!rmi4_data->f01) {
+			mtouch_error(MTOUCH_DEV, "%s: failed to allocate memory for f01",
+						__FUNCTION__);
+			return -ENODEV;
+		}
+		synaptics_rmi4_set_func(rmi_fd, rmi4_data->f01, page_number, intr_count);
 
-            mtouch_info(MTOUCH_DEV, "%s: F%02x found (page %d)",
-            			__FUNCTION__, rmi_fd.fn_number, page_number);
+		rmi4_data->f01->attn_handle = NULL;
 
-            switch (rmi_fd.fn_number) {
+		synaptics_rmi4_register_intr(rmi4_data, rmi4_data->f01, INTERRUPT_STATUS_DEVICE);
 
-            case SYNAPTICS_RMI4_F01:	/* Function $01: RMI device control */
-                if (0 == rmi_fd.intr_src_count)
-                    break;
+		break;
 
-                rmi4_data->f01 = calloc(1, sizeof(struct synaptics_rmi4_fn));
-				if (!rmi4_data->f01) {
-					mtouch_error(MTOUCH_DEV, "%s: failed to allocate memory for f01",
-								__FUNCTION__);
-					return -ENODEV;
-				}
-				synaptics_rmi4_set_func(rmi_fd, rmi4_data->f01, page_number, intr_count);
+	case SYNAPTICS_RMI4_F11:	/* Function $11: 2D sensors  */
+		if (0 == rmi_fd.intr_src_count)
+			break;
 
-				rmi4_data->f01->attn_handle = NULL;
+		rmi4_data->f11 = calloc(1, sizeof(struct synaptics_rmi4_fn));
+		if (!rmi4_data->f11) {
+			mtouch_error(MTOUCH_DEV, "%s: failed to allocate memory for f11",
+						__FUNCTION__);
+			return -ENODEV;
+		}
+		synaptics_rmi4_set_func(rmi_fd, rmi4_data->f11, page_number, intr_count);
 
-				is_f01_found = true;
+		rmi4_data->f11->attn_handle = synaptics_rmi4_f11_abs_report;
 
-	            rmi4_data->intr_mask |= rmi4_data->f01->intr_mask;
+		if (cache)
+			retval = synaptics_rmi4_f11_restore(rmi4_data, cache);
+		else
+			retval = synaptics_rmi4_f11_init(rmi4_data);
+		if (retval != EOK) {
+			mtouch_error(MTOUCH_DEV, "%s: failed to init f11",
+						__FUNCTION__);
+			return -ENODEV;
+		}
 
-				break;
+		synaptics_rmi4_register_intr(rmi4_data, rmi4_data->f11, INTERRUPT_STATUS_TOUCH);
 
-            case SYNAPTICS_RMI4_F11:	/* Function $11: 2D sensors  */
-                if (0 == rmi_fd.intr_src_count)
-                    break;
+		break;
 
-            	rmi4_data->f11 = calloc(1, sizeof(struct synaptics_rmi4_fn));
-				if (!rmi4_data->f11) {
-					mtouch_error(MTOUCH_DEV, "%s: failed to allocate memory for f11",
-								__FUNCTION__);
-					return -ENODEV;
-				}
-				synaptics_rmi4_set_func(rmi_fd, rmi4_data->f11, page_number, intr_count);
+	case SYNAPTICS_RMI4_F12:	/* Function $12: 2D sensors  */
+		if (0 == rmi_fd.intr_src_count)
+			break;
 
-				rmi4_data->f11->attn_handle = synaptics_rmi4_f11_abs_report;
+		rmi4_data->f12 = calloc(1, sizeof(struct synaptics_rmi4_fn));
+		if (!rmi4_data->f12) {
+			mtouch_error(MTOUCH_DEV, "%s: failed to allocate memory for f12",
+						__FUNCTION__);
+			return -ENODEV;
+		}
+		synaptics_rmi4_set_func(rmi_fd, rmi4_data->f12, page_number, intr_count);
 
-				retval = synaptics_rmi4_f11_init(rmi4_data);
-				if (retval != EOK) {
-					mtouch_error(MTOUCH_DEV, "%s: failed to init f11",
-								__FUNCTION__);
-					return -ENODEV;
-				}
+		rmi4_data->f12->attn_handle = synaptics_rmi4_f12_abs_report;
 
-	            rmi4_data->intr_mask |= rmi4_data->f11->intr_mask;
+		if (cache)
+			retval = synaptics_rmi4_f12_restore(rmi4_data, cache);
+		else
+			retval = synaptics_rmi4_f12_init(rmi4_data);
+		if (retval != EOK) {
+			mtouch_error(MTOUCH_DEV, "%s: failed to init f12",
+						__FUNCTION__);
+			return -ENODEV;
+		}
 
-				break;
+		synaptics_rmi4_register_intr(rmi4_data, rmi4_data->f12, INTERRUPT_STATUS_TOUCH);
 
-            case SYNAPTICS_RMI4_F12:	/* Function $12: 2D sensors  */
-                if (0 == rmi_fd.intr_src_count)
-                    break;
+		break;
 
-            	rmi4_data->f12 = calloc(1, sizeof(struct synaptics_rmi4_fn));
-				if (!rmi4_data->f12) {
-					mtouch_error(MTOUCH_DEV, "%s: failed to allocate memory for f12",
-								__FUNCTION__);
-					return -ENODEV;
-				}
-				synaptics_rmi4_set_func(rmi_fd, rmi4_data->f12, page_number, intr_count);
+	case SYNAPTICS_RMI4_F34:	/* Function $34: flash memory management  */
+		rmi4_data->f34 = calloc(1, sizeof(struct synaptics_rmi4_fn));
+		if (!rmi4_data->f34) {
+			mtouch_error(MTOUCH_DEV, "%s: failed to allocate memory for f34",
+						__FUNCTION__);
+			return -ENODEV;
+		}
+		synaptics_rmi4_set_func(rmi_fd, rmi4_data->f34, page_number, intr_count);
 
-				rmi4_data->f12->attn_handle = synaptics_rmi4_f12_abs_report;
+		rmi4_data->f34->attn_handle = NULL;
 
-				retval = synaptics_rmi4_f12_init(rmi4_data);
-				if (retval != EOK) {
-					mtouch_error(MTOUCH_DEV, "%s: failed to init f12",
-								__FUNCTION__);
-					return -ENODEV;
-				}
+		retval = synaptics_rmi4_fwu_init(rmi4_data, rmi_fd.fn_version);
+		if (retval != EOK) {
+			mtouch_error(MTOUCH_DEV, "%s: failed to init f34",
+						__FUNCTION__);
+			return -ENODEV;
+		}
 
-	            rmi4_data->intr_mask |= rmi4_data->f12->intr_mask;
+		synaptics_rmi4_register_intr(rmi4_data, rmi4_data->f34, INTERRUPT_STATUS_FLASH);
 
-				break;
+		break;
 
-            case SYNAPTICS_RMI4_F34:	/* Function $34: flash memory management  */
-            	rmi4_data->f34 = calloc(1, sizeof(struct synaptics_rmi4_fn));
-				if (!rmi4_data->f34) {
-					mtouch_error(MTOUCH_DEV, "%s: failed to allocate memory for f34",
-								__FUNCTION__);
-					return -ENODEV;
-				}
-				synaptics_rmi4_set_func(rmi_fd, rmi4_data->f34, page_number, intr_count);
+	case SYNAPTICS_RMI4_F54:	/* Function $54: test reporting   */
+		rmi4_data->f54 = calloc(1, sizeof(struct synaptics_rmi4_fn));
+		if (!rmi4_data->f54) {
+			mtouch_error(MTOUCH_DEV, "%s: failed to allocate memory for f54",
+						__FUNCTION__);
+			return -ENODEV;
+		}
+		synaptics_rmi4_set_func(rmi_fd, rmi4_data->f54, page_number, intr_count);
+
+		rmi4_data->f54->attn_handle = NULL;
+
+		// the capture engine is optional, the touch report works without it
+		retval = synaptics_rmi4_f54_init(rmi4_data,
+					g_syna_dev->pvt_data->f54_capture,
+					g_syna_dev->pvt_data->f54_interval,
+					g_syna_dev->pvt_data->f54_depth);
+		if (retval != EOK) {
+			mtouch_warn(MTOUCH_DEV, "%s: failed to init f54 capture",
+						__FUNCTION__);
+		}
 
-				rmi4_data->f34->attn_handle = NULL;
+		synaptics_rmi4_register_intr(rmi4_data, rmi4_data->f54, INTERRUPT_STATUS_ANALOG);
 
-				retval = synaptics_rmi4_fwu_init(rmi4_data, rmi_fd.fn_version);
-				if (retval != EOK) {
-					mtouch_error(MTOUCH_DEV, "%s: failed to init f34",
-								__FUNCTION__);
-					return -ENODEV;
-				}
+		break;
 
-				is_f34_found = true;
+	case SYNAPTICS_RMI4_F55:	/* Function $55: sensor tuning   */
+		rmi4_data->f55 = calloc(1, sizeof(struct synaptics_rmi4_fn));
+		if (!rmi4_data->f55) {
+			mtouch_error(MTOUCH_DEV, "%s: failed to allocate memory for f55",
+						__FUNCTION__);
+			return -ENODEV;
+		}
+		synaptics_rmi4_set_func(rmi_fd, rmi4_data->f55, page_number, intr_count);
 
-	            rmi4_data->intr_mask |= rmi4_data->f34->intr_mask;
+		rmi4_data->f55->attn_handle = NULL;
 
-				break;
+		synaptics_rmi4_register_intr(rmi4_data, rmi4_data->f55, INTERRUPT_STATUS_SENSOR);
 
-			case SYNAPTICS_RMI4_F54:	/* Function $54: test reporting   */
-				rmi4_data->f54 = calloc(1, sizeof(struct synaptics_rmi4_fn));
-				if (!rmi4_data->f54) {
-					mtouch_error(MTOUCH_DEV, "%s: failed to allocate memory for f54",
-								__FUNCTION__);
-					return -ENODEV;
-				}
-				synaptics_rmi4_set_func(rmi_fd, rmi4_data->f54, page_number, intr_count);
+		break;
 
-				rmi4_data->f54->attn_handle = NULL;
+	case SYNAPTICS_RMI4_F1A:	/* Function $1A: capacitive button sensors */
+		if (0 == rmi_fd.intr_src_count)
+			break;
 
-	            rmi4_data->intr_mask |= rmi4_data->f54->intr_mask;
+		rmi4_data->f1a = calloc(1, sizeof(struct synaptics_rmi4_fn));
+		if (!rmi4_data->f1a) {
+			mtouch_error(MTOUCH_DEV, "%s: failed to allocate memory for f1a",
+						__FUNCTION__);
+			return -ENODEV;
+		}
+		synaptics_rmi4_set_func(rmi_fd, rmi4_data->f1a, page_number, intr_count);
 
-				break;
+		rmi4_data->f1a->attn_handle = synaptics_rmi4_f1a_button_report;
 
-			case SYNAPTICS_RMI4_F55:	/* Function $55: sensor tuning   */
-				rmi4_data->f55 = calloc(1, sizeof(struct synaptics_rmi4_fn));
-				if (!rmi4_data->f55) {
-					mtouch_error(MTOUCH_DEV, "%s: failed to allocate memory for f55",
-								__FUNCTION__);
-					return -ENODEV;
-				}
-				synaptics_rmi4_set_func(rmi_fd, rmi4_data->f55, page_number, intr_count);
+		if (cache)
+			retval = synaptics_rmi4_f1a_restore(rmi4_data, cache);
+		else
+			retval = synaptics_rmi4_f1a_init(rmi4_data);
+		if (retval != EOK) {
+			mtouch_error(MTOUCH_DEV, "%s: failed to init f1a",
+						__FUNCTION__);
+			return -ENODEV;
+		}
 
-				rmi4_data->f55->attn_handle = NULL;
+		synaptics_rmi4_register_intr(rmi4_data, rmi4_data->f1a, INTERRUPT_STATUS_BUTTON);
+		break;
 
-	            rmi4_data->intr_mask |= rmi4_data->f55->intr_mask;
+	default:
+		break;
+	}
 
-				break;
+	return EOK;
+}
+
+/*
+ * helper function to compute the checksum of the PDT cache
+ *
+ * const struct synaptics_rmi4_pdt_cache *cache: the PDT cache
+ *
+ * return the checksum
+ */
+static unsigned int synaptics_rmi4_pdt_cache_checksum(const struct synaptics_rmi4_pdt_cache *cache)
+{
+	unsigned int ii;
+	unsigned int checksum = 0;
+	const unsigned char *data = (const unsigned char *)cache;
+
+	for (ii = 0; ii < offsetof(struct synaptics_rmi4_pdt_cache, checksum); ii++)
+		checksum += data[ii];
+
+	return checksum;
+}
+
+/*
+ * load the PDT cache from the file
+ *
+ * const char *path: the path of the cache file
+ * struct synaptics_rmi4_pdt_cache *cache: the PDT cache
+ *
+ * return EOK: the cache is loaded
+ * otherwise, no cache or invalid cache
+ */
+static int synaptics_rmi4_pdt_cache_load(const char *path, struct synaptics_rmi4_pdt_cache *cache)
+{
+	FILE *fp;
+	size_t size;
+
+	fp = fopen(path, "rb");
+	if (!fp) {
+		mtouch_info(MTOUCH_DEV, "%s: no PDT cache in %s", __FUNCTION__, path);
+		return -ENOENT;
+	}
+
+	size = fread(cache, 1, sizeof(struct synaptics_rmi4_pdt_cache), fp);
+	fclose(fp);
+
+	if ((size != sizeof(struct synaptics_rmi4_pdt_cache)) ||
+		(cache->magic != PDT_CACHE_MAGIC) ||
+		(cache->version != PDT_CACHE_VERSION) ||
+		(cache->num_of_entries > MAX_RMI4_FUNCS) ||
+		(cache->checksum != synaptics_rmi4_pdt_cache_checksum(cache))) {
+		mtouch_warn(MTOUCH_DEV, "%s: invalid PDT cache in %s", __FUNCTION__, path);
+		return -EINVAL;
+	}
+
+	return EOK;
+}
+
+/*
+ * sync the directory of the PDT cache, so that the rename survives a power loss
+ *
+ * const char *path: the path of the cache file
+ *
+ * return void
+ */
+static void synaptics_rmi4_pdt_cache_sync_dir(const char *path)
+{
+	int fd;
+	char *slash;
+	char dir_path[PATH_MAX];
+
+	snprintf(dir_path, sizeof(dir_path), "%s", path);
+
+	slash = strrchr(dir_path, '/');
+	if (!slash)
+		snprintf(dir_path, sizeof(dir_path), ".");
+	else if (slash == dir_path)
+		slash[1] = '\0';
+	else
+		slash[0] = '\0';
+
+	fd = open(dir_path, O_RDONLY);
+	if (fd < 0) {
+		mtouch_warn(MTOUCH_DEV, "%s: failed to open %s", __FUNCTION__, dir_path);
+		return;
+	}
+
+	if (fsync(fd) != 0)
+		mtouch_warn(MTOUCH_DEV, "%s: failed to sync %s", __FUNCTION__, dir_path);
+
+	close(fd);
+}
+
+/*
+ * save the PDT cache to the file
+ * the entries are collected in the PDT scan, the rest is taken from the device
+ *
+ * struct synaptics_rmi4_data *rmi4_data: RMI4 device instance data
+ * const char *path: the path of the cache file
+ * struct synaptics_rmi4_pdt_cache *cache: the PDT cache
+ *
+ * return void
+ */
+static void synaptics_rmi4_pdt_cache_save(struct synaptics_rmi4_data *rmi4_data,
+							const char *path, struct synaptics_rmi4_pdt_cache *cache)
+{
+	FILE *fp;
+	size_t size;
+	int retval;
+	char tmp_path[PATH_MAX];
+
+	if (cache->num_of_entries > MAX_RMI4_FUNCS) {
+		mtouch_warn(MTOUCH_DEV, "%s: too many functions to cache", __FUNCTION__);
+		return;
+	}
+
+	cache->magic = PDT_CACHE_MAGIC;
+	cache->version = PDT_CACHE_VERSION;
+	memcpy(cache->product_id, rmi4_data->rmi4_mod_info.product_id_string, PRODUCT_ID_SIZE);
+	cache->firmware_id = rmi4_data->firmware_id;
+	synaptics_rmi4_fwu_get_config_id(cache->config_id, sizeof(cache->config_id));
+
+	cache->num_of_fingers = rmi4_data->num_of_fingers;
+	cache->sensor_max_x = rmi4_data->sensor_max_x;
+	cache->sensor_max_y = rmi4_data->sensor_max_y;
+	cache->max_touch_width = rmi4_data->max_touch_width;
+	cache->report_enable = rmi4_data->report_enable;
+	cache->valid_button_count = rmi4_data->valid_button_count;
+	if ((rmi4_data->f12) && (rmi4_data->f12->extra))
+		memcpy(&cache->f12_extra, rmi4_data->f12->extra, sizeof(struct synaptics_rmi4_f12_extra_data));
+
+	cache->checksum = synaptics_rmi4_pdt_cache_checksum(cache);
+
+	// write a temporary file, sync it, then rename it, a power loss never leaves a partial cache
+	snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+	fp = fopen(tmp_path, "wb");
+	if (!fp) {
+		mtouch_warn(MTOUCH_DEV, "%s: failed to create %s", __FUNCTION__, tmp_path);
+		return;
+	}
+
+	size = fwrite(cache, 1, sizeof(struct synaptics_rmi4_pdt_cache), fp);
+	fflush(fp);
+	retval = fsync(fileno(fp));
+	fclose(fp);
+
+	if ((size != sizeof(struct synaptics_rmi4_pdt_cache)) || (retval != 0) ||
+		(rename(tmp_path, path) != 0)) {
+		mtouch_warn(MTOUCH_DEV, "%s: failed to save %s", __FUNCTION__, path);
+		unlink(tmp_path);
+		return;
+	}
+
+	synaptics_rmi4_pdt_cache_sync_dir(path);
+
+	mtouch_info(MTOUCH_DEV, "%s: PDT cache saved in %s", __FUNCTION__, path);
+}
+
+/*
+ * check the PDT cache against the device, before any function is set up
+ * the product ID and the firmware ID are read from F$01, the configuration ID
+ * from F$34, at the addresses recorded in the cache
+ *
+ * struct synaptics_rmi4_data *rmi4_data: RMI4 device instance data
+ * const struct synaptics_rmi4_pdt_cache *cache: the PDT cache
+ *
+ * return true if the cache matches the device
+ */
+static bool synaptics_rmi4_pdt_cache_match(struct synaptics_rmi4_data *rmi4_data,
+							const struct synaptics_rmi4_pdt_cache *cache)
+{
+	int retval;
+	unsigned char ii;
+	unsigned char config_id_size;
+	unsigned char f01_query[F01_STD_QUERY_LEN] = {0};
+	unsigned char build_id[3] = {0};
+	unsigned char config_id[PDT_CACHE_CONFIG_ID_SIZE] = {0};
+	unsigned int firmware_id;
+	const struct synaptics_rmi4_pdt_cache_entry *f01 = NULL;
+	const struct synaptics_rmi4_pdt_cache_entry *f34 = NULL;
+
+	for (ii = 0; ii < cache->num_of_entries; ii++) {
+		if (SYNAPTICS_RMI4_F01 == cache->entries[ii].fd.fn_number)
+			f01 = &cache->entries[ii];
+		else if (SYNAPTICS_RMI4_F34 == cache->entries[ii].fd.fn_number)
+			f34 = &cache->entries[ii];
+	}
+
+	if ((!f01) || (!f34))
+		return false;
+
+	retval = synaptics_rmi4_reg_read(rmi4_data,
+				(f01->page << 8) | f01->fd.query_base_addr,
+				f01_query,
+				F01_STD_QUERY_LEN);
+	if (retval < 0)
+		return false;
+
+	if (memcmp(cache->product_id, &f01_query[11], PRODUCT_ID_SIZE))
+		return false;
+
+	retval = synaptics_rmi4_reg_read(rmi4_data,
+				((f01->page << 8) | f01->fd.query_base_addr) + F01_BUID_ID_OFFSET,
+				build_id,
+				sizeof(build_id));
+	if (retval < 0)
+		return false;
 
-            case SYNAPTICS_RMI4_F1A:	/* Function $1A: capacitive button sensors */
-                if (0 == rmi_fd.intr_src_count)
-                    break;
+	firmware_id = (unsigned int)build_id[0] +
+			(unsigned int)build_id[1] * 0x100 +
+			(unsigned int)build_id[2] * 0x10000;
+
+	if (cache->firmware_id != firmware_id)
+		return false;
+
+	// the size of the configuration ID depends on the bootloader
+	config_id_size = (F34_V2 == f34->fd.fn_version) ? V7_CONFIG_ID_SIZE : V5V6_CONFIG_ID_SIZE;
+	if (config_id_size > sizeof(config_id))
+		config_id_size = sizeof(config_id);
+
+	retval = synaptics_rmi4_reg_read(rmi4_data,
+				(f34->page << 8) | f34->fd.ctrl_base_addr,
+				config_id,
+				config_id_size);
+	if (retval < 0)
+		return false;
 
-            	rmi4_data->f1a = calloc(1, sizeof(struct synaptics_rmi4_fn));
-				if (!rmi4_data->f1a) {
-					mtouch_error(MTOUCH_DEV, "%s: failed to allocate memory for f1a",
-								__FUNCTION__);
-					return -ENODEV;
-				}
-				synaptics_rmi4_set_func(rmi_fd, rmi4_data->f1a, page_number, intr_count);
+	if (memcmp(cache->config_id, config_id, config_id_size))
+		return false;
 
-				rmi4_data->f1a->attn_handle = NULL;
+	return true;
+}
 
-	            rmi4_data->intr_mask |= rmi4_data->f1a->intr_mask;
+/*
+ * scan the Page Description Table (PDT) and set up the RMI functions found
+ *
+ * the PDT is defined as a general properties query register,
+ * followed by an array of Function Descriptors.  The contents of the
+ * Page Description table are stored from high page offsets down towards
+ * lower page offsets, starting at page offset PdtTop.
+ *
+ * the descriptors of a page are fetched in one burst read and parsed in
+ * memory. the scan ends at the first page without any function.
+ *
+ * struct synaptics_rmi4_data *rmi4_data: RMI4 device instance data
+ * struct synaptics_rmi4_pdt_cache *cache: the entries found are recorded for the cache
+ * unsigned char *intr_count: number of interrupt sources of all functions
+ *
+ * return EOK: complete the scan
+ * otherwise, fail
+ */
+static int synaptics_rmi4_scan_pdt(struct synaptics_rmi4_data *rmi4_data,
+							struct synaptics_rmi4_pdt_cache *cache, unsigned char *intr_count)
+{
+	int retval;
+	unsigned char page_number;
+	unsigned short pdt_entry_addr;
+	unsigned char pdt[PDT_REGION_SIZE];
+	struct synaptics_rmi4_fn_desc rmi_fd;
+
+	// Scan the page description tables of the pages to service
+	for (page_number = 0; page_number < PAGES_TO_SERVICE; page_number++) {
+
+		retval = synaptics_rmi4_reg_read(rmi4_data, (page_number << 8) | PDT_REGION_START,
+					pdt, sizeof(pdt));
+		if (retval < 0)
+			return -EIO;
+
+		// no function on this page, the rest of pages are empty as well
+		if (pdt[PDT_START - PDT_REGION_START + offsetof(struct synaptics_rmi4_fn_desc, fn_number)] == 0)
+			break;
+
+		for (pdt_entry_addr = PDT_START; pdt_entry_addr > PDT_END; pdt_entry_addr -= PDT_ENTRY_SIZE) {
+
+			memcpy(&rmi_fd, &pdt[pdt_entry_addr - PDT_REGION_START], sizeof(rmi_fd));
+
+			if (rmi_fd.fn_number == 0) {
 				break;
+			}
 
-			default:
+			if ((rmi4_data->f01) && (rmi4_data->f34) && (rmi_fd.fn_number == SYNAPTICS_RMI4_F34)) {
 				break;
-            }
+			}
+
+			mtouch_info(MTOUCH_DEV, "%s: F%02x found (page %d)",
+						__FUNCTION__, rmi_fd.fn_number, page_number);
 
-			intr_count += rmi_fd.intr_src_count;
+			retval = synaptics_rmi4_add_func(rmi4_data, rmi_fd, page_number, *intr_count, NULL);
+			if (retval != EOK)
+				return retval;
+
+			// record the entry, the cache is dropped if there are too many
+			if (cache->num_of_entries < MAX_RMI4_FUNCS) {
+				cache->entries[cache->num_of_entries].page = page_number;
+				cache->entries[cache->num_of_entries].fd = rmi_fd;
+			}
+			cache->num_of_entries++;
+
+			*intr_count += rmi_fd.intr_src_count;
 		}
 	}
 
-    if (!is_f01_found || !is_f34_found) {
+	return EOK;
+}
+
+/*
+ * set up the RMI functions from the PDT cache, without scanning the PDT
+ *
+ * struct synaptics_rmi4_data *rmi4_data: RMI4 device instance data
+ * const struct synaptics_rmi4_pdt_cache *cache: the PDT cache
+ * unsigned char *intr_count: number of interrupt sources of all functions
+ *
+ * return EOK: success
+ * otherwise, fail
+ */
+static int synaptics_rmi4_apply_pdt_cache(struct synaptics_rmi4_data *rmi4_data,
+							const struct synaptics_rmi4_pdt_cache *cache, unsigned char *intr_count)
+{
+	int retval;
+	unsigned char ii;
+
+	for (ii = 0; ii < cache->num_of_entries; ii++) {
+		retval = synaptics_rmi4_add_func(rmi4_data, cache->entries[ii].fd,
+					cache->entries[ii].page, *intr_count, cache);
+		if (retval != EOK)
+			return retval;
+
+		*intr_count += cache->entries[ii].fd.intr_src_count;
+	}
+
+	return EOK;
+}
+
+/*
+ * read the device information from F$01 once the RMI functions are set up
+ *
+ * struct synaptics_rmi4_data *rmi4_data: RMI4 device instance data
+ * unsigned char intr_count: number of interrupt sources of all functions
+ *
+ * return EOK: success
+ * otherwise, fail
+ */
+static int synaptics_rmi4_read_device_info(struct synaptics_rmi4_data *rmi4_data,
+							unsigned char intr_count)
+{
+	int retval;
+	unsigned char f01_query[F01_STD_QUERY_LEN] = {0};
+
+	if ((!rmi4_data->f01) || (!rmi4_data->f34)) {
 		mtouch_error(MTOUCH_DEV, "%s: failed to find f01 and f34", __FUNCTION__);
-        return -ENODEV;
-    }
+		return -ENODEV;
+	}
 
 	rmi4_data->num_of_intr_regs = (intr_count + 7) / 8;
+	if (rmi4_data->num_of_intr_regs > MAX_INTR_REGISTERS) {
+		mtouch_warn(MTOUCH_DEV, "%s: %d interrupt sources, only %d registers are serviced",
+					__FUNCTION__, intr_count, MAX_INTR_REGISTERS);
+		rmi4_data->num_of_intr_regs = MAX_INTR_REGISTERS;
+	}
 	mtouch_debug(MTOUCH_DEV, "%s: number of interrupt registers = %d",
     			__FUNCTION__, rmi4_data->num_of_intr_regs);
 
@@ -1408,6 +2181,79 @@ static int synaptics_rmi4_query_device(struct synaptics_rmi4_data *rmi4_data)
 	return EOK;
 }
 
+/*
+ * to parse the Page Description Table (PDT) and reconstruct the entire
+ * RMI register address map
+ *
+ * with the option pdt_cache, the map is restored from the cache file and
+ * validated against the IDs of the device. the PDT is scanned only when the
+ * cache is missing or stale, and the cache is saved after the scan.
+ *
+ * struct synaptics_rmi4_data *rmi4_data: RMI4 device instance data
+ *
+ * return EOK: complete device query
+ * otherwise, fail
+ */
+static int synaptics_rmi4_query_device(struct synaptics_rmi4_data *rmi4_data)
+{
+	int retval;
+	unsigned char intr_count = 0;
+	struct synaptics_rmi4_pdt_cache cache;
+	const char *cache_path;
+
+	_CHECK_POINTER(rmi4_data);
+	_CHECK_POINTER(g_syna_dev);
+
+	cache_path = g_syna_dev->pvt_data->pdt_cache;
+	if ((cache_path) && ('\0' == cache_path[0]))
+		cache_path = NULL;
+
+	memset(rmi4_data->intr_mask, 0x00, sizeof(rmi4_data->intr_mask));
+	rmi4_data->num_of_intr_handlers = 0;
+
+	// restore the map from the cache, only if it matches the device
+	// nothing is set up from a stale cache
+	if ((cache_path) && (EOK == synaptics_rmi4_pdt_cache_load(cache_path, &cache))) {
+		if (synaptics_rmi4_pdt_cache_match(rmi4_data, &cache)) {
+			retval = synaptics_rmi4_apply_pdt_cache(rmi4_data, &cache, &intr_count);
+			if (EOK == retval)
+				retval = synaptics_rmi4_read_device_info(rmi4_data, intr_count);
+
+			if (EOK == retval) {
+				mtouch_info(MTOUCH_DEV, "%s: RMI functions restored from %s",
+							__FUNCTION__, cache_path);
+				return EOK;
+			}
+
+			mtouch_warn(MTOUCH_DEV, "%s: fail to restore the PDT cache, scan the PDT", __FUNCTION__);
+
+			synaptics_rmi4_empty_all_rmi_func(rmi4_data);
+
+			memset(rmi4_data->intr_mask, 0x00, sizeof(rmi4_data->intr_mask));
+			rmi4_data->num_of_intr_handlers = 0;
+			intr_count = 0;
+		}
+		else {
+			mtouch_info(MTOUCH_DEV, "%s: PDT cache is stale, scan the PDT", __FUNCTION__);
+		}
+	}
+
+	memset(&cache, 0x00, sizeof(cache));
+
+	retval = synaptics_rmi4_scan_pdt(rmi4_data, &cache, &intr_count);
+	if (EOK != retval)
+		return retval;
+
+	retval = synaptics_rmi4_read_device_info(rmi4_data, intr_count);
+	if (EOK != retval)
+		return retval;
+
+	if (cache_path)
+		synaptics_rmi4_pdt_cache_save(rmi4_data, cache_path, &cache);
+
+	return EOK;
+}
+
 
 /*
  * release the all RMI functions
@@ -1448,6 +2294,9 @@ static void synaptics_rmi4_empty_all_rmi_func(struct synaptics_rmi4_data *rmi4_d
 		rmi4_data->f34 = NULL;
 	}
 	if (rmi4_data->f54) {
+
+		synaptics_rmi4_f54_deinit();
+
 		free(rmi4_data->f54);
 		rmi4_data->f54 = NULL;
 	}
@@ -1456,6 +2305,10 @@ static void synaptics_rmi4_empty_all_rmi_func(struct synaptics_rmi4_data *rmi4_d
 		rmi4_data->f55 = NULL;
 	}
 	if (rmi4_data->f1a) {
+
+		free(rmi4_data->f1a->data);
+		rmi4_data->f1a->data = NULL;
+
 		free(rmi4_data->f1a);
 		rmi4_data->f1a = NULL;
 	}
@@ -56,6 +56,8 @@
 #define PDT_START				(0x00E9)
 #define PDT_END					(0x00D0)
 #define PDT_ENTRY_SIZE			(0x0006)
+#define PDT_REGION_START		(PDT_END + 1)
+#define PDT_REGION_SIZE			(PDT_START + PDT_ENTRY_SIZE - PDT_REGION_START)
 #define PAGES_TO_SERVICE		(10)
 #define PAGE_SELECT_LEN 		(2)
 #define ADDRESS_LEN 			(2)
@@ -135,12 +137,25 @@
 #define NO_SLEEP_ON				(1 << 2)
 #define CONFIGURED				(1 << 7)
 
+/* sources of interrupt, returned by synaptics_rmi4_sersor_report() as a bitmask */
 #define INTERRUPT_STATUS_FLASH	(1 << 0)
 #define INTERRUPT_STATUS_DEVICE	(1 << 1)
 #define INTERRUPT_STATUS_TOUCH	(1 << 2)
 #define INTERRUPT_STATUS_ANALOG	(1 << 3)
 #define INTERRUPT_STATUS_BUTTON	(1 << 4)
 #define INTERRUPT_STATUS_SENSOR	(1 << 5)
+#define INTERRUPT_STATUS_RESET	(1 << 6)
+
+/* health of the controller, returned by synaptics_rmi4_check_health() */
+enum synaptics_rmi4_health {
+	HEALTH_OK = 0,
+	HEALTH_NO_RESPONSE,		// no response on the bus, hang or brown-out
+	HEALTH_RESET,			// reset without the interrupt serviced
+	HEALTH_BAD_CRC,			// configuration or firmware CRC failure
+	HEALTH_DEVICE_FAILURE,	// device failure reported
+	HEALTH_ATTN_LOST,		// pending interrupt without the ATTN asserted
+	HEALTH_MAX,
+};
 
 #define FINGER_LANDING			(1)
 #define FINGER_LIFTING			(0)
@@ -192,7 +207,7 @@ struct synaptics_rmi4_fn_full_addr {
  * struct synaptics_rmi4_fn - function handler
  *
  * func_num: function name
- * intr_mask: interrupt mask
+ * intr_mask: interrupt mask, one byte per interrupt register
  * base_addr: contains the base address
  * attn_handle: function pointer to interrupt handler
  * data_size: size of private data
@@ -201,7 +216,7 @@ struct synaptics_rmi4_fn_full_addr {
  */
 struct synaptics_rmi4_fn {
 	unsigned char func_num;
-	unsigned char intr_mask;
+	unsigned char intr_mask[MAX_INTR_REGISTERS];
 	struct synaptics_rmi4_fn_full_addr base_addr;
 	int (*attn_handle)(void *data);
 	int data_size;
@@ -209,6 +224,17 @@ struct synaptics_rmi4_fn {
 	void *extra;
 };
 
+/*
+ * struct synaptics_rmi4_intr_handler - entry of the interrupt dispatch table
+ *
+ * fn: function handler which owns the interrupt sources
+ * status: source of interrupt reported to the caller, INTERRUPT_STATUS_*
+ */
+struct synaptics_rmi4_intr_handler {
+	struct synaptics_rmi4_fn *fn;
+	unsigned int status;
+};
+
 /*
  * struct synaptics_rmi4_device_info - device information
  *
@@ -236,7 +262,7 @@ struct synaptics_rmi4_device_info {
  *
  *  rmi4_mod_info: device information
  *  num_of_intr_regs: number of interrupt registers
- *  intr_mask: interrupt enable mask
+ *  intr_mask: interrupt enable mask, one byte per interrupt register
  *  num_of_fingers: maximum number of fingers for 2D touch
  *  report_enable: input data to report for F$12
  *  sensor_max_x: maximum x coordinate for 2D touch
@@ -253,6 +279,13 @@ struct synaptics_rmi4_device_info {
  *  f54: function handler of f$54
  *  f55: function handler of f$55
  *
+ *  intr_handlers: interrupt dispatch table, built from the PDT
+ *  num_of_intr_handlers: number of entries in the interrupt dispatch table
+ *
+ *  reset_count: number of spontaneous resets recovered
+ *  recovery_time: time spent in the last recovery, in us
+ *  recovery_time_max: the longest recovery, in us
+ *
  *  current_page: current RMI page for register access
  *  rmi4_io_ctrl_mutex: mutex for the RMI io control
  *  rmi4_report_mutex: mutex for getting the touch report
@@ -263,7 +296,7 @@ struct synaptics_rmi4_data {
 	// device information
     struct synaptics_rmi4_device_info rmi4_mod_info;
     unsigned short num_of_intr_regs;
-    unsigned char intr_mask;
+    unsigned char intr_mask[MAX_INTR_REGISTERS];
 	unsigned char num_of_fingers;
 	unsigned char report_enable;
 	int sensor_max_x;
@@ -281,6 +314,15 @@ struct synaptics_rmi4_data {
 	struct synaptics_rmi4_fn *f54;
 	struct synaptics_rmi4_fn *f55;
 
+	// interrupt dispatch table
+	struct synaptics_rmi4_intr_handler intr_handlers[MAX_RMI4_FUNCS];
+	unsigned char num_of_intr_handlers;
+
+	// spontaneous reset recovery
+	unsigned int reset_count;
+	unsigned int recovery_time;
+	unsigned int recovery_time_max;
+
 	// RMI helper
     unsigned char current_page;
 	pthread_mutex_t rmi4_io_ctrl_mutex;
@@ -313,6 +355,52 @@ struct synaptics_rmi4_f12_extra_data {
 	unsigned char ctrl20_offset;
 };
 
+/*
+ * struct synaptics_rmi4_pdt_cache - the RMI function map saved across the boots
+ *
+ * the cache is valid for the device with the same product ID, firmware ID
+ * and configuration ID
+ *
+ * magic: PDT_CACHE_MAGIC
+ * version: PDT_CACHE_VERSION
+ * product_id: product ID string of F$01
+ * firmware_id: firmware build ID
+ * config_id: configuration ID of F$34
+ * num_of_entries: number of PDT entries, in the order of the scan
+ * entries: page number and function descriptor of each PDT entry
+ * num_of_fingers, sensor_max_x, sensor_max_y, max_touch_width, report_enable,
+ * valid_button_count, f12_extra: parameters derived from the F$11/F$12/F$1A queries
+ * checksum: sum of all bytes above
+ */
+#define PDT_CACHE_MAGIC			(0x43544450)	/* "PDTC" */
+#define PDT_CACHE_VERSION		(1)
+#define PDT_CACHE_CONFIG_ID_SIZE (32)
+
+struct synaptics_rmi4_pdt_cache_entry {
+	unsigned char page;
+	struct synaptics_rmi4_fn_desc fd;
+};
+
+struct synaptics_rmi4_pdt_cache {
+	unsigned int magic;
+	unsigned int version;
+	unsigned char product_id[PRODUCT_ID_SIZE];
+	unsigned int firmware_id;
+	unsigned char config_id[PDT_CACHE_CONFIG_ID_SIZE];
+	unsigned char num_of_entries;
+	struct synaptics_rmi4_pdt_cache_entry entries[MAX_RMI4_FUNCS];
+
+	unsigned char num_of_fingers;
+	int sensor_max_x;
+	int sensor_max_y;
+	unsigned char max_touch_width;
+	unsigned char report_enable;
+	unsigned char valid_button_count;
+	struct synaptics_rmi4_f12_extra_data f12_extra;
+
+	unsigned int checksum;
+};
+
 
 /*
  *
@@ -742,6 +830,30 @@ struct synaptics_rmi4_f12_ctrl_58 {
 	};
 };
 
+struct synaptics_rmi4_f1a_query {
+	union {
+		struct {
+			/* query 0 */
+			unsigned char max_button_count:3;
+			unsigned char f1a_query0_b3__4:2;
+			unsigned char has_query4:1;
+			unsigned char has_query3:1;
+			unsigned char has_query2:1;
+
+			/* query 1 */
+			unsigned char has_general_control:1;
+			unsigned char has_interrupt_enable:1;
+			unsigned char has_multibutton_select:1;
+			unsigned char has_tx_rx_map:1;
+			unsigned char has_perbutton_threshold:1;
+			unsigned char has_release_threshold:1;
+			unsigned char has_strongestbtn_hysteresis:1;
+			unsigned char has_filter_strength:1;
+		} __attribute__((packed));
+		unsigned char data[2];
+	};
+};
+
 struct synaptics_rmi4_f12_finger_data {
 	unsigned char object_type_and_status;
 	unsigned char x_lsb;
@@ -761,6 +873,9 @@ extern int synaptics_rmi4_reg_write(struct synaptics_rmi4_data *rmi4_data,
 extern int synaptics_rmi4_sw_reset(struct synaptics_rmi4_data *rmi4_data);
 extern int synaptics_rmi4_int_enable(struct synaptics_rmi4_data *rmi4_data, bool enable);
 extern int synaptics_rmi4_reinit();
+extern int synaptics_rmi4_restore_settings(struct synaptics_rmi4_data *rmi4_data);
+extern int synaptics_rmi4_recover(struct synaptics_rmi4_data *rmi4_data);
+extern int synaptics_rmi4_check_health(struct synaptics_rmi4_data *rmi4_data);
 
 #endif /* _SYNAPTICS_RMI_CORE_H_ */
 
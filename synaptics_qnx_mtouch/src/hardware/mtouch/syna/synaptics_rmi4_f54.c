@@ -0,0 +1,974 @@
+/*
+ * $QNXLicenseC:
+ * Copyright 2010, QNX Software Systems.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You
+ * may not reproduce, modify or distribute this software except in
+ * compliance with the License. You may obtain a copy of the License
+ * at: http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OF ANY KIND, either express or implied.
+ *
+ * This file may contain contributions from others, either as
+ * contributors under the License or as licensors under other terms.
+ * Please review this entire file for other proprietary rights or license
+ * notices, as well as the QNX Development Suite License Guide at
+ * http://licensing.qnx.com/license-guide/ for other information.
+ * $
+ */
+
+/*
+ * Synaptics Touchscreen driver
+ *
+ * Copyright (C) 2012-2018 Synaptics Incorporated. All rights reserved.
+ *
+ * The hardware access library is included from QNX software, and the
+ * mtouch framework is also included from install/usr/input/. Both of
+ * libraries are under Apache-2.0.
+ *
+ * Synaptics Touchscreen driver is interacted with QNX software system
+ * as a touchscreen controller, for its licensing rule and related notices,
+ * please scroll down the text to browse all of it.
+ *
+ * INFORMATION CONTAINED IN THIS DOCUMENT IS PROVIDED "AS-IS," AND SYNAPTICS
+ * EXPRESSLY DISCLAIMS ALL EXPRESS AND IMPLIED WARRANTIES, INCLUDING ANY
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE,
+ * AND ANY WARRANTIES OF NON-INFRINGEMENT OF ANY INTELLECTUAL PROPERTY RIGHTS.
+ * IN NO EVENT SHALL SYNAPTICS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, PUNITIVE, OR CONSEQUENTIAL DAMAGES ARISING OUT OF OR IN CONNECTION
+ * WITH THE USE OF THE INFORMATION CONTAINED IN THIS DOCUMENT, HOWEVER CAUSED
+ * AND BASED ON ANY THEORY OF LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, AND EVEN IF SYNAPTICS WAS ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE. IF A TRIBUNAL OF COMPETENT JURISDICTION DOES
+ * NOT PERMIT THE DISCLAIMER OF DIRECT DAMAGES OR ANY OTHER DAMAGES, SYNAPTICS'
+ * TOTAL CUMULATIVE LIABILITY TO ANY PARTY SHALL NOT EXCEED ONE HUNDRED U.S.
+ * DOLLARS.
+ *
+ */
+
+#include "synaptics_mtouch.h"
+#include "synaptics_rmi4_f54.h"
+
+#define F54_GET_REPORT (1)
+#define F54_FORCE_CAL (2)
+#define F54_FORCE_UPDATE (4)
+
+/*
+ * the query registers locating the F$54 control 7
+ * query 4, the touch controller family, and query 5 bit 0, has the pixel touch
+ * threshold adjustment (control 3). query 3 is two bytes
+ */
+#define F54_QUERY_SIZE (7)
+#define F54_QUERY_FAMILY (5)
+#define F54_QUERY_PIXEL_THRESHOLD (6)
+
+/*
+ * control 7 of F$54, the CBC of the touch controller family 1
+ */
+#define F54_CTRL7_CBC_TX_CARRIER (1 << 4)
+
+#define F54_THREAD_PRIORITY (10)
+
+/*
+ * struct synaptics_rmi4_f54_handle - F$54 capture engine
+ *
+ * rmi4_data: RMI4 device instance data
+ * f54: function handler of f$54
+ * rx: number of receiver electrodes
+ * tx: number of transmitter electrodes
+ * mode: the capture mode, enum f54_capture_mode
+ * interval_ms: the interval between the captures, in ms
+ * report: buffer for reading the report data
+ * frame: the decoded frame
+ * noise_min, noise_max: per-pixel extremes for F54_CAPTURE_NOISE
+ * noise_count: number of frames accumulated for F54_CAPTURE_NOISE
+ * shm_fd: the shared-memory object
+ * shm_size: size of the shared-memory object
+ * shm: mapping of the shared-memory object
+ * thread: the capture thread
+ * thread_running: the capture thread is created
+ * stop: request the capture thread to exit, read and written under the mutex
+ * report_ready: the report complete interrupt is received
+ * mutex, cond: to wake up the capture thread
+ */
+/*
+ * struct synaptics_rmi4_f54_prep - settings saved by the preparation of the
+ * full raw capacitance report
+ *
+ * device_ctrl: the F$01 device control
+ * nosleep: the no-sleep bit is changed
+ * ctrl7_addr: address of the F$54 control 7
+ * ctrl7: the F$54 control 7
+ * cbc: the CBC is changed
+ */
+struct synaptics_rmi4_f54_prep {
+	unsigned char device_ctrl;
+	bool nosleep;
+	unsigned short ctrl7_addr;
+	unsigned char ctrl7;
+	bool cbc;
+};
+
+struct synaptics_rmi4_f54_handle {
+	struct synaptics_rmi4_data *rmi4_data;
+	struct synaptics_rmi4_fn *f54;
+	unsigned char rx;
+	unsigned char tx;
+	unsigned int mode;
+	unsigned int interval_ms;
+	unsigned char *report;
+	int16_t *frame;
+	int16_t *noise_min;
+	int16_t *noise_max;
+	unsigned int noise_count;
+	int shm_fd;
+	size_t shm_size;
+	struct synaptics_rmi4_f54_shm_header *shm;
+	pthread_t thread;
+	bool thread_running;
+	bool stop;
+	bool report_ready;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+};
+
+static struct synaptics_rmi4_f54_handle *g_f54;
+
+/* serializes the interrupt thread in synaptics_rmi4_f54_attn() against the release of g_f54 */
+static pthread_mutex_t f54_attn_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * helper function to wait on the condition of the capture engine
+ * the caller should hold the g_f54->mutex
+ *
+ * uint64_t timeout: absolute time to stop waiting, CLOCK_MONOTONIC in nanoseconds
+ *
+ * return void
+ */
+static void synaptics_rmi4_f54_wait(uint64_t timeout)
+{
+	struct timespec ts;
+
+	nsec2timespec(&ts, timeout);
+
+	pthread_cond_timedwait(&g_f54->cond, &g_f54->mutex, &ts);
+}
+
+/*
+ * handle the F$54 interrupt, which is asserted when the requested report is ready
+ * called by the interrupt thread
+ *
+ * void *: should be the struct synaptics_rmi4_data *
+ *
+ * return EOK: success
+ */
+static int synaptics_rmi4_f54_attn(void *input)
+{
+	pthread_mutex_lock(&f54_attn_mutex);
+
+	// the capture engine is released
+	if (!g_f54) {
+		pthread_mutex_unlock(&f54_attn_mutex);
+		return EOK;
+	}
+
+	pthread_mutex_lock(&g_f54->mutex);
+	g_f54->report_ready = true;
+	pthread_cond_broadcast(&g_f54->cond);
+	pthread_mutex_unlock(&g_f54->mutex);
+
+	pthread_mutex_unlock(&f54_attn_mutex);
+
+	return EOK;
+}
+
+/*
+ * request a report from the device and read the report data
+ *
+ * the completion is signaled by the F$54 interrupt when the capture engine
+ * is running. the command register is polled as well, in case the interrupt
+ * is not delivered. the report data is read in chunks of F54_READ_CHUNK bytes,
+ * and the bus is released between the chunks so that the touch report is not
+ * held off by a full frame.
+ *
+ * struct synaptics_rmi4_data *rmi4_data: RMI4 device instance data
+ * unsigned char report_type: the F$54 report type
+ * unsigned char *report: buffer for the report data
+ * unsigned int size: size of the report data, in bytes
+ *
+ * return EOK: success
+ * otherwise, fail
+ */
+static int synaptics_rmi4_f54_get_report(struct synaptics_rmi4_data *rmi4_data,
+			unsigned char report_type, unsigned char *report, unsigned int size)
+{
+	int retval;
+	unsigned char command;
+	unsigned char index[2] = {0, 0};
+	unsigned int offset;
+	unsigned int length;
+	unsigned int elapsed;
+	uint64_t now;
+	bool stop;
+	struct synaptics_rmi4_fn *f54 = rmi4_data->f54;
+
+	// select the report type
+	retval = synaptics_rmi4_reg_write(rmi4_data,
+				f54->base_addr.data_base,
+				&report_type,
+				sizeof(report_type));
+	if (retval < 0) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to write report type", __FUNCTION__);
+		return -EIO;
+	}
+
+	if (g_f54) {
+		pthread_mutex_lock(&g_f54->mutex);
+		g_f54->report_ready = false;
+		pthread_mutex_unlock(&g_f54->mutex);
+	}
+
+	command = F54_GET_REPORT;
+	retval = synaptics_rmi4_reg_write(rmi4_data,
+				f54->base_addr.cmd_base,
+				&command,
+				sizeof(command));
+	if (retval < 0) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to write get report command", __FUNCTION__);
+		return -EIO;
+	}
+
+	// wait for the completion
+	for (elapsed = 0; elapsed < F54_REPORT_TIMEOUT_MS; elapsed += F54_REPORT_POLL_MS) {
+		if (g_f54) {
+			pthread_mutex_lock(&g_f54->mutex);
+			if ((!g_f54->report_ready) && (!g_f54->stop)) {
+				ClockTime(CLOCK_MONOTONIC, NULL, &now);
+				synaptics_rmi4_f54_wait(now + (uint64_t)F54_REPORT_POLL_MS * 1000000);
+			}
+			stop = g_f54->stop;
+			pthread_mutex_unlock(&g_f54->mutex);
+
+			if (stop)
+				return -ECANCELED;
+		}
+		else {
+			usleep(F54_REPORT_POLL_MS * 1000);
+		}
+
+		retval = synaptics_rmi4_reg_read(rmi4_data,
+					f54->base_addr.cmd_base,
+					&command,
+					sizeof(command));
+		if (retval < 0) {
+			mtouch_error(MTOUCH_DEV, "%s: failed to read command register", __FUNCTION__);
+			return -EIO;
+		}
+
+		if (!(command & F54_GET_REPORT))
+			break;
+	}
+
+	if (elapsed >= F54_REPORT_TIMEOUT_MS) {
+		mtouch_warn(MTOUCH_DEV, "%s: timeout waiting for report type %d",
+					__FUNCTION__, report_type);
+		return -ETIMEDOUT;
+	}
+
+	// read the report data from the beginning
+	retval = synaptics_rmi4_reg_write(rmi4_data,
+				f54->base_addr.data_base + 1,
+				index,
+				sizeof(index));
+	if (retval < 0) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to write report index", __FUNCTION__);
+		return -EIO;
+	}
+
+	for (offset = 0; offset < size; offset += length) {
+		length = size - offset;
+		if (length > F54_READ_CHUNK)
+			length = F54_READ_CHUNK;
+
+		retval = synaptics_rmi4_reg_read(rmi4_data,
+					f54->base_addr.data_base + 3,
+					&report[offset],
+					length);
+		if (retval < 0) {
+			mtouch_error(MTOUCH_DEV, "%s: failed to read report data", __FUNCTION__);
+			return -EIO;
+		}
+
+		sched_yield();
+	}
+
+	return EOK;
+}
+
+/*
+ * publish a frame to the shared-memory ring
+ *
+ * const int16_t *frame: the frame to publish
+ * uint64_t timestamp: time of the capture, in nanoseconds
+ *
+ * return void
+ */
+static void synaptics_rmi4_f54_publish(const int16_t *frame, uint64_t timestamp)
+{
+	struct synaptics_rmi4_f54_shm_header *header = g_f54->shm;
+	struct synaptics_rmi4_f54_shm_slot *slot;
+	uint32_t head = header->head;
+
+	slot = (struct synaptics_rmi4_f54_shm_slot *)((unsigned char *)header + sizeof(*header) +
+				(head % header->depth) * header->slot_size);
+
+	// odd sequence, the slot is being written
+	slot->seq++;
+	__sync_synchronize();
+
+	slot->mode = g_f54->mode;
+	slot->frame = head + 1;
+	slot->timestamp = timestamp;
+	memcpy(slot->data, frame, g_f54->rx * g_f54->tx * sizeof(int16_t));
+
+	__sync_synchronize();
+	slot->seq++;
+
+	header->head = head + 1;
+}
+
+/*
+ * capture one frame in the selected mode and publish it
+ * in F54_CAPTURE_NOISE, the frame is published every F54_NOISE_FRAMES captures
+ *
+ * return EOK: success
+ * otherwise, fail
+ */
+static int synaptics_rmi4_f54_capture(void)
+{
+	int retval;
+	unsigned int ii;
+	unsigned int pixels = g_f54->rx * g_f54->tx;
+	unsigned char report_type;
+	int16_t value;
+	uint64_t timestamp;
+
+	if (F54_CAPTURE_RAW == g_f54->mode)
+		report_type = F54_RAW_16BIT_IMAGE;
+	else
+		report_type = F54_16BIT_IMAGE;
+
+	retval = synaptics_rmi4_f54_get_report(g_f54->rmi4_data, report_type,
+				g_f54->report, pixels * 2);
+
+	if (retval < 0)
+		return retval;
+
+	ClockTime(CLOCK_MONOTONIC, NULL, &timestamp);
+
+	// the report data is 16-bit little-endian
+	for (ii = 0; ii < pixels; ii++)
+		g_f54->frame[ii] = (int16_t)(g_f54->report[ii * 2] | (g_f54->report[ii * 2 + 1] << 8));
+
+	if (F54_CAPTURE_NOISE != g_f54->mode) {
+		synaptics_rmi4_f54_publish(g_f54->frame, timestamp);
+		return EOK;
+	}
+
+	for (ii = 0; ii < pixels; ii++) {
+		value = g_f54->frame[ii];
+		if ((0 == g_f54->noise_count) || (value < g_f54->noise_min[ii]))
+			g_f54->noise_min[ii] = value;
+		if ((0 == g_f54->noise_count) || (value > g_f54->noise_max[ii]))
+			g_f54->noise_max[ii] = value;
+	}
+
+	if (++g_f54->noise_count < F54_NOISE_FRAMES)
+		return EOK;
+
+	for (ii = 0; ii < pixels; ii++)
+		g_f54->frame[ii] = g_f54->noise_max[ii] - g_f54->noise_min[ii];
+
+	g_f54->noise_count = 0;
+
+	synaptics_rmi4_f54_publish(g_f54->frame, timestamp);
+
+	return EOK;
+}
+
+/*
+ * the capture thread
+ * capture a frame every interval_ms until the stop is requested
+ *
+ * the capture is skipped while the firmware update holds the rmi4_fwu_mutex
+ *
+ * void *arg: not used
+ */
+static void *synaptics_rmi4_f54_capture_thread(void *arg)
+{
+	int retval;
+	uint64_t start;
+	bool stop = false;
+	struct synaptics_rmi4_data *rmi4_data = g_f54->rmi4_data;
+
+	while (!stop) {
+		ClockTime(CLOCK_MONOTONIC, NULL, &start);
+
+		if (EOK == pthread_mutex_trylock(&rmi4_data->rmi4_fwu_mutex)) {
+			retval = synaptics_rmi4_f54_capture();
+			pthread_mutex_unlock(&rmi4_data->rmi4_fwu_mutex);
+
+			if ((retval < 0) && (-ECANCELED != retval)) {
+				mtouch_warn(MTOUCH_DEV, "%s: capture failed (error: %d)",
+							__FUNCTION__, retval);
+			}
+		}
+
+		// wait for the next capture, the stop request wakes it up
+		pthread_mutex_lock(&g_f54->mutex);
+		if (!g_f54->stop)
+			synaptics_rmi4_f54_wait(start + (uint64_t)g_f54->interval_ms * 1000000);
+		stop = g_f54->stop;
+		pthread_mutex_unlock(&g_f54->mutex);
+	}
+
+	return NULL;
+}
+
+/*
+ * read the number of the electrodes from the F$54 query
+ *
+ * struct synaptics_rmi4_data *rmi4_data: RMI4 device instance data
+ * unsigned char *rx: number of receiver electrodes
+ * unsigned char *tx: number of transmitter electrodes
+ *
+ * return EOK: success
+ * otherwise, fail
+ */
+int synaptics_rmi4_f54_get_electrodes(struct synaptics_rmi4_data *rmi4_data,
+			unsigned char *rx, unsigned char *tx)
+{
+	int retval;
+	unsigned char query[2];
+
+	_CHECK_POINTER(rmi4_data);
+	_CHECK_POINTER(rmi4_data->f54);
+
+	retval = synaptics_rmi4_reg_read(rmi4_data,
+				rmi4_data->f54->base_addr.query_base,
+				query,
+				sizeof(query));
+	if (retval < 0) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to read f54 query", __FUNCTION__);
+		return -EIO;
+	}
+
+	if ((0 == query[0]) || (0 == query[1])) {
+		mtouch_error(MTOUCH_DEV, "%s: invalid electrodes, rx = %d, tx = %d",
+					__FUNCTION__, query[0], query[1]);
+		return -EINVAL;
+	}
+
+	*rx = query[0];
+	*tx = query[1];
+
+	return EOK;
+}
+
+/*
+ * issue a command of F$54 and wait for its completion,
+ * the firmware clears the command bit once the command is done
+ *
+ * struct synaptics_rmi4_data *rmi4_data: RMI4 device instance data
+ * unsigned char command: F54_FORCE_CAL or F54_FORCE_UPDATE
+ *
+ * return EOK: success
+ * otherwise, fail
+ */
+static int synaptics_rmi4_f54_command(struct synaptics_rmi4_data *rmi4_data,
+			unsigned char command)
+{
+	int retval;
+	unsigned char value = command;
+	unsigned int elapsed;
+
+	retval = synaptics_rmi4_reg_write(rmi4_data,
+				rmi4_data->f54->base_addr.cmd_base,
+				&value,
+				sizeof(value));
+	if (retval < 0) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to write command 0x%x", __FUNCTION__, command);
+		return -EIO;
+	}
+
+	for (elapsed = 0; elapsed < F54_COMMAND_TIMEOUT_MS; elapsed += F54_REPORT_POLL_MS) {
+		usleep(F54_REPORT_POLL_MS * 1000);
+
+		retval = synaptics_rmi4_reg_read(rmi4_data,
+					rmi4_data->f54->base_addr.cmd_base,
+					&value,
+					sizeof(value));
+		if (retval < 0) {
+			mtouch_error(MTOUCH_DEV, "%s: failed to read command register", __FUNCTION__);
+			return -EIO;
+		}
+
+		if (!(value & command))
+			return EOK;
+	}
+
+	mtouch_warn(MTOUCH_DEV, "%s: timeout waiting for command 0x%x", __FUNCTION__, command);
+
+	return -ETIMEDOUT;
+}
+
+/*
+ * locate the control 7 of F$54, which carries the CBC on the touch controller
+ * family 1. the controls 0 - 6 in front of it are
+ *    - control 0, 1 byte
+ *    - control 1, 1 byte, family 0 and 1
+ *    - control 2, 2 bytes
+ *    - control 3, 1 byte, with the pixel touch threshold adjustment
+ *    - control 4 - 6, 3 bytes, family 0 and 1
+ * the other families keep the CBC in the controls located by the extended
+ * queries, which are not parsed by this driver
+ *
+ * struct synaptics_rmi4_data *rmi4_data: RMI4 device instance data
+ * unsigned short *addr: address of the control 7
+ *
+ * return EOK: success
+ * -ENOTSUP: the control 7 is not present
+ * otherwise, fail
+ */
+static int synaptics_rmi4_f54_locate_ctrl7(struct synaptics_rmi4_data *rmi4_data,
+			unsigned short *addr)
+{
+	int retval;
+	unsigned char query[F54_QUERY_SIZE];
+	unsigned short offset;
+
+	retval = synaptics_rmi4_reg_read(rmi4_data,
+				rmi4_data->f54->base_addr.query_base,
+				query,
+				sizeof(query));
+	if (retval < 0) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to read f54 query", __FUNCTION__);
+		return -EIO;
+	}
+
+	if (1 != query[F54_QUERY_FAMILY]) {
+		mtouch_info(MTOUCH_DEV, "%s: no control 7 on the touch controller family %d",
+					__FUNCTION__, query[F54_QUERY_FAMILY]);
+		return -ENOTSUP;
+	}
+
+	offset = 1 + 1 + 2 + 3;
+	if (query[F54_QUERY_PIXEL_THRESHOLD] & 0x01)
+		offset += 1;
+
+	*addr = rmi4_data->f54->base_addr.ctrl_base + offset;
+
+	return EOK;
+}
+
+/*
+ * restore the settings changed by synaptics_rmi4_f54_prepare()
+ * the CBC is re-applied and the baseline is calibrated again with it
+ *
+ * struct synaptics_rmi4_data *rmi4_data: RMI4 device instance data
+ * struct synaptics_rmi4_f54_prep *prep: the saved settings
+ *
+ * return EOK: success
+ * otherwise, fail
+ */
+static int synaptics_rmi4_f54_restore(struct synaptics_rmi4_data *rmi4_data,
+			struct synaptics_rmi4_f54_prep *prep)
+{
+	int retval = EOK;
+
+	if (prep->cbc) {
+		if (synaptics_rmi4_reg_write(rmi4_data, prep->ctrl7_addr,
+					&prep->ctrl7, sizeof(prep->ctrl7)) < 0) {
+			mtouch_error(MTOUCH_DEV, "%s: failed to restore the cbc", __FUNCTION__);
+			retval = -EIO;
+		}
+		else if ((synaptics_rmi4_f54_command(rmi4_data, F54_FORCE_UPDATE) < 0) ||
+				(synaptics_rmi4_f54_command(rmi4_data, F54_FORCE_CAL) < 0)) {
+			retval = -EIO;
+		}
+		prep->cbc = false;
+	}
+
+	if (prep->nosleep) {
+		if (synaptics_rmi4_reg_write(rmi4_data, rmi4_data->f01->base_addr.ctrl_base,
+					&prep->device_ctrl, sizeof(prep->device_ctrl)) < 0) {
+			mtouch_error(MTOUCH_DEV, "%s: failed to restore the device control", __FUNCTION__);
+			retval = -EIO;
+		}
+		prep->nosleep = false;
+	}
+
+	return retval;
+}
+
+/*
+ * prepare the controller for the full raw capacitance report
+ *    - no-sleep, the sensor keeps scanning
+ *    - CBC off, the capacitance is measured without the compensation
+ *    - force calibration, the baseline follows the settings above
+ * the CBC is left unchanged on the families without the control 7
+ *
+ * struct synaptics_rmi4_data *rmi4_data: RMI4 device instance data
+ * struct synaptics_rmi4_f54_prep *prep: the saved settings
+ *
+ * return EOK: success
+ * otherwise, fail, the changed settings are still recorded in the prep
+ */
+static int synaptics_rmi4_f54_prepare(struct synaptics_rmi4_data *rmi4_data,
+			struct synaptics_rmi4_f54_prep *prep)
+{
+	int retval;
+	unsigned char value;
+
+	memset(prep, 0x00, sizeof(struct synaptics_rmi4_f54_prep));
+
+	// no-sleep
+	retval = synaptics_rmi4_reg_read(rmi4_data,
+				rmi4_data->f01->base_addr.ctrl_base,
+				&prep->device_ctrl,
+				sizeof(prep->device_ctrl));
+	if (retval < 0) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to read f01 ctrl_base", __FUNCTION__);
+		return -EIO;
+	}
+
+	value = prep->device_ctrl | NO_SLEEP_ON;
+	retval = synaptics_rmi4_reg_write(rmi4_data,
+				rmi4_data->f01->base_addr.ctrl_base,
+				&value,
+				sizeof(value));
+	if (retval < 0) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to set no-sleep", __FUNCTION__);
+		return -EIO;
+	}
+	prep->nosleep = true;
+
+	// CBC off
+	retval = synaptics_rmi4_f54_locate_ctrl7(rmi4_data, &prep->ctrl7_addr);
+	if (EOK == retval) {
+		retval = synaptics_rmi4_reg_read(rmi4_data,
+					prep->ctrl7_addr,
+					&prep->ctrl7,
+					sizeof(prep->ctrl7));
+		if (retval < 0) {
+			mtouch_error(MTOUCH_DEV, "%s: failed to read f54 control 7", __FUNCTION__);
+			return -EIO;
+		}
+
+		value = prep->ctrl7 & ~F54_CTRL7_CBC_TX_CARRIER;
+		retval = synaptics_rmi4_reg_write(rmi4_data,
+					prep->ctrl7_addr,
+					&value,
+					sizeof(value));
+		if (retval < 0) {
+			mtouch_error(MTOUCH_DEV, "%s: failed to disable the cbc", __FUNCTION__);
+			return -EIO;
+		}
+		prep->cbc = true;
+
+		retval = synaptics_rmi4_f54_command(rmi4_data, F54_FORCE_UPDATE);
+		if (retval < 0)
+			return retval;
+	}
+	else if (-ENOTSUP == retval) {
+		mtouch_warn(MTOUCH_DEV, "%s: the cbc is not located, left unchanged", __FUNCTION__);
+	}
+	else {
+		return retval;
+	}
+
+	// force calibration
+	return synaptics_rmi4_f54_command(rmi4_data, F54_FORCE_CAL);
+}
+
+/*
+ * capture one image of 16-bit pixels, outside of the capture engine
+ * the caller should hold the rmi4_fwu_mutex, the capture engine is paused meanwhile
+ * F54_FULL_RAW_CAP_NO_RX_COUPLING is captured with synaptics_rmi4_f54_prepare()
+ * applied, the settings are restored afterwards
+ *
+ * struct synaptics_rmi4_data *rmi4_data: RMI4 device instance data
+ * unsigned char report_type: the F$54 report type
+ * uint16_t *image: buffer for the image
+ * unsigned int pixels: number of pixels in the image, rx * tx
+ *
+ * return EOK: success
+ * otherwise, fail
+ */
+int synaptics_rmi4_f54_read_image(struct synaptics_rmi4_data *rmi4_data,
+			unsigned char report_type, uint16_t *image, unsigned int pixels)
+{
+	int retval;
+	unsigned int ii;
+	unsigned char *report = (unsigned char *)image;
+	struct synaptics_rmi4_f54_prep prep;
+
+	_CHECK_POINTER(rmi4_data);
+	_CHECK_POINTER(rmi4_data->f54);
+	_CHECK_POINTER(image);
+
+	if (F54_FULL_RAW_CAP_NO_RX_COUPLING == report_type) {
+		retval = synaptics_rmi4_f54_prepare(rmi4_data, &prep);
+		if (retval < 0) {
+			mtouch_error(MTOUCH_DEV, "%s: failed to prepare report type %d",
+						__FUNCTION__, report_type);
+			synaptics_rmi4_f54_restore(rmi4_data, &prep);
+			return retval;
+		}
+	}
+
+	retval = synaptics_rmi4_f54_get_report(rmi4_data, report_type, report, pixels * 2);
+
+	if (F54_FULL_RAW_CAP_NO_RX_COUPLING == report_type) {
+		if (synaptics_rmi4_f54_restore(rmi4_data, &prep) < 0)
+			mtouch_warn(MTOUCH_DEV, "%s: failed to restore the settings", __FUNCTION__);
+	}
+
+	if (retval < 0)
+		return retval;
+
+	// the report data is 16-bit little-endian, convert in place
+	for (ii = 0; ii < pixels; ii++)
+		image[ii] = (uint16_t)(report[ii * 2] | (report[ii * 2 + 1] << 8));
+
+	return EOK;
+}
+
+/*
+ * create the shared-memory object and initialize the header of the ring
+ *
+ * unsigned int depth: number of slots in the ring
+ *
+ * return EOK: success
+ * otherwise, fail
+ */
+static int synaptics_rmi4_f54_create_shm(unsigned int depth)
+{
+	int retval;
+	size_t slot_size;
+
+	// keep the slots 8-byte aligned for the timestamp
+	slot_size = sizeof(struct synaptics_rmi4_f54_shm_slot) +
+				g_f54->rx * g_f54->tx * sizeof(int16_t);
+	slot_size = (slot_size + 7) & ~7;
+
+	g_f54->shm_size = sizeof(struct synaptics_rmi4_f54_shm_header) + depth * slot_size;
+
+	g_f54->shm_fd = shm_open(F54_SHM_NAME, O_RDWR | O_CREAT, 0644);
+	if (g_f54->shm_fd < 0) {
+		retval = -errno;
+		mtouch_error(MTOUCH_DEV, "%s: failed to open %s (error: %s)",
+					__FUNCTION__, F54_SHM_NAME, strerror(errno));
+		return retval;
+	}
+
+	if (ftruncate(g_f54->shm_fd, g_f54->shm_size) < 0) {
+		retval = -errno;
+		mtouch_error(MTOUCH_DEV, "%s: failed to set the size of %s (error: %s)",
+					__FUNCTION__, F54_SHM_NAME, strerror(errno));
+		return retval;
+	}
+
+	g_f54->shm = mmap(NULL, g_f54->shm_size, PROT_READ | PROT_WRITE, MAP_SHARED, g_f54->shm_fd, 0);
+	if (MAP_FAILED == g_f54->shm) {
+		retval = -errno;
+		mtouch_error(MTOUCH_DEV, "%s: failed to map %s (error: %s)",
+					__FUNCTION__, F54_SHM_NAME, strerror(errno));
+		g_f54->shm = NULL;
+		return retval;
+	}
+
+	memset(g_f54->shm, 0x00, g_f54->shm_size);
+
+	g_f54->shm->version = F54_SHM_VERSION;
+	g_f54->shm->rx = g_f54->rx;
+	g_f54->shm->tx = g_f54->tx;
+	g_f54->shm->depth = depth;
+	g_f54->shm->slot_size = slot_size;
+	g_f54->shm->head = 0;
+
+	// the magic is set last, the readers should check it before the other fields
+	__sync_synchronize();
+	g_f54->shm->magic = F54_SHM_MAGIC;
+
+	return EOK;
+}
+
+/*
+ * Function $54 initialization
+ * f54 implements the test reporting, the analog data of the sensor
+ *
+ * the capture engine is started when the mode is not F54_CAPTURE_OFF,
+ * the captured frames are exported through the shared-memory object F54_SHM_NAME
+ *
+ * struct synaptics_rmi4_data *rmi4_data: RMI4 device instance data
+ * unsigned int mode: the capture mode, enum f54_capture_mode
+ * unsigned int interval_ms: the interval between the captures, in ms
+ * unsigned int depth: number of frames kept in the ring
+ *
+ * return EOK: complete the initialization
+ * otherwise, fail
+ */
+int synaptics_rmi4_f54_init(struct synaptics_rmi4_data *rmi4_data, unsigned int mode,
+			unsigned int interval_ms, unsigned int depth)
+{
+	int retval;
+	unsigned int pixels;
+	pthread_attr_t attr;
+	struct sched_param param;
+	pthread_condattr_t condattr;
+
+	if (g_f54) {
+		mtouch_info(MTOUCH_DEV, "%s: handle already exists", __FUNCTION__);
+		return EOK;
+	}
+
+	_CHECK_POINTER(rmi4_data);
+	_CHECK_POINTER(rmi4_data->f54);
+
+	if (F54_CAPTURE_OFF == mode)
+		return EOK;
+
+	if (mode > F54_CAPTURE_NOISE) {
+		mtouch_error(MTOUCH_DEV, "%s: invalid capture mode %d", __FUNCTION__, mode);
+		return -EINVAL;
+	}
+
+	g_f54 = calloc(1, sizeof(struct synaptics_rmi4_f54_handle));
+	if (!g_f54) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to allocate memory for f54", __FUNCTION__);
+		return -ENOMEM;
+	}
+
+	g_f54->rmi4_data = rmi4_data;
+	g_f54->f54 = rmi4_data->f54;
+	g_f54->mode = mode;
+	g_f54->interval_ms = (interval_ms) ? interval_ms : F54_CAPTURE_INTERVAL_MS;
+	g_f54->shm_fd = -1;
+
+	pthread_mutex_init(&g_f54->mutex, NULL);
+	pthread_condattr_init(&condattr);
+	pthread_condattr_setclock(&condattr, CLOCK_MONOTONIC);
+	pthread_cond_init(&g_f54->cond, &condattr);
+	pthread_condattr_destroy(&condattr);
+
+	// number of the electrodes
+	retval = synaptics_rmi4_f54_get_electrodes(rmi4_data, &g_f54->rx, &g_f54->tx);
+	if (retval < 0)
+		goto exit;
+
+	pixels = g_f54->rx * g_f54->tx;
+
+	g_f54->report = calloc(pixels * 2, sizeof(unsigned char));
+	g_f54->frame = calloc(pixels, sizeof(int16_t));
+	g_f54->noise_min = calloc(pixels, sizeof(int16_t));
+	g_f54->noise_max = calloc(pixels, sizeof(int16_t));
+	if ((!g_f54->report) || (!g_f54->frame) || (!g_f54->noise_min) || (!g_f54->noise_max)) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to allocate memory for f54 frames", __FUNCTION__);
+		retval = -ENOMEM;
+		goto exit;
+	}
+
+	retval = synaptics_rmi4_f54_create_shm((depth) ? depth : F54_RING_DEPTH);
+	if (retval < 0)
+		goto exit;
+
+	// the report complete interrupt
+	rmi4_data->f54->attn_handle = synaptics_rmi4_f54_attn;
+
+	// the capture thread runs below the interrupt thread
+	pthread_attr_init(&attr);
+	pthread_attr_setschedpolicy(&attr, SCHED_RR);
+	param.sched_priority = F54_THREAD_PRIORITY;
+	pthread_attr_setschedparam(&attr, &param);
+	pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+
+	retval = pthread_create(&g_f54->thread, &attr, synaptics_rmi4_f54_capture_thread, NULL);
+	pthread_attr_destroy(&attr);
+	if (EOK != retval) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to create the capture thread (error: %s)",
+					__FUNCTION__, strerror(retval));
+		rmi4_data->f54->attn_handle = NULL;
+		retval = -retval;
+		goto exit;
+	}
+
+	g_f54->thread_running = true;
+
+	mtouch_info(MTOUCH_DEV, "%s: capture mode %d, rx = %d, tx = %d, every %d ms",
+				__FUNCTION__, mode, g_f54->rx, g_f54->tx, g_f54->interval_ms);
+
+	return EOK;
+
+exit:
+	synaptics_rmi4_f54_deinit();
+
+	return retval;
+}
+
+/*
+ * stop the capture thread and release the allocated resource
+ *
+ * return void
+ */
+void synaptics_rmi4_f54_deinit(void)
+{
+	struct synaptics_rmi4_f54_handle *f54_handle;
+
+	if (!g_f54)
+		return;
+
+	// no more attention is routed to the capture engine
+	pthread_mutex_lock(&f54_attn_mutex);
+	if (g_f54->f54)
+		g_f54->f54->attn_handle = NULL;
+	pthread_mutex_unlock(&f54_attn_mutex);
+
+	if (g_f54->thread_running) {
+		pthread_mutex_lock(&g_f54->mutex);
+		g_f54->stop = true;
+		pthread_cond_broadcast(&g_f54->cond);
+		pthread_mutex_unlock(&g_f54->mutex);
+
+		pthread_join(g_f54->thread, NULL);
+		g_f54->thread_running = false;
+	}
+
+	if (g_f54->shm) {
+		munmap(g_f54->shm, g_f54->shm_size);
+		g_f54->shm = NULL;
+	}
+	if (g_f54->shm_fd >= 0) {
+		close(g_f54->shm_fd);
+		shm_unlink(F54_SHM_NAME);
+		g_f54->shm_fd = -1;
+	}
+
+	free(g_f54->report);
+	free(g_f54->frame);
+	free(g_f54->noise_min);
+	free(g_f54->noise_max);
+
+	// wait for the interrupt thread to leave synaptics_rmi4_f54_attn()
+	pthread_mutex_lock(&f54_attn_mutex);
+	f54_handle = g_f54;
+	g_f54 = NULL;
+	pthread_mutex_unlock(&f54_attn_mutex);
+
+	pthread_cond_destroy(&f54_handle->cond);
+	pthread_mutex_destroy(&f54_handle->mutex);
+
+	free(f54_handle);
+}
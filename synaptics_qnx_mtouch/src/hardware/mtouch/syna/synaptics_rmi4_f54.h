@@ -0,0 +1,166 @@
+/*
+ * $QNXLicenseC:
+ * Copyright 2010, QNX Software Systems.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You
+ * may not reproduce, modify or distribute this software except in
+ * compliance with the License. You may obtain a copy of the License
+ * at: http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OF ANY KIND, either express or implied.
+ *
+ * This file may contain contributions from others, either as
+ * contributors under the License or as licensors under other terms.
+ * Please review this entire file for other proprietary rights or license
+ * notices, as well as the QNX Development Suite License Guide at
+ * http://licensing.qnx.com/license-guide/ for other information.
+ * $
+ */
+
+/*
+ * Synaptics Touchscreen driver
+ *
+ * Copyright (C) 2012-2018 Synaptics Incorporated. All rights reserved.
+ *
+ * The hardware access library is included from QNX software, and the
+ * mtouch framework is also included from install/usr/input/. Both of
+ * libraries are under Apache-2.0.
+ *
+ * Synaptics Touchscreen driver is interacted with QNX software system
+ * as a touchscreen controller, for its licensing rule and related notices,
+ * please scroll down the text to browse all of it.
+ *
+ * INFORMATION CONTAINED IN THIS DOCUMENT IS PROVIDED "AS-IS," AND SYNAPTICS
+ * EXPRESSLY DISCLAIMS ALL EXPRESS AND IMPLIED WARRANTIES, INCLUDING ANY
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE,
+ * AND ANY WARRANTIES OF NON-INFRINGEMENT OF ANY INTELLECTUAL PROPERTY RIGHTS.
+ * IN NO EVENT SHALL SYNAPTICS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, PUNITIVE, OR CONSEQUENTIAL DAMAGES ARISING OUT OF OR IN CONNECTION
+ * WITH THE USE OF THE INFORMATION CONTAINED IN THIS DOCUMENT, HOWEVER CAUSED
+ * AND BASED ON ANY THEORY OF LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, AND EVEN IF SYNAPTICS WAS ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE. IF A TRIBUNAL OF COMPETENT JURISDICTION DOES
+ * NOT PERMIT THE DISCLAIMER OF DIRECT DAMAGES OR ANY OTHER DAMAGES, SYNAPTICS'
+ * TOTAL CUMULATIVE LIABILITY TO ANY PARTY SHALL NOT EXCEED ONE HUNDRED U.S.
+ * DOLLARS.
+ *
+ */
+
+
+#ifndef _SYNAPTICS_RMI4_F54_H_
+#define _SYNAPTICS_RMI4_F54_H_
+
+#include <stdint.h>
+
+
+/*
+ * name of the shared-memory object where the captured frames are exported
+ */
+#define F54_SHM_NAME				"/synaptics_f54"
+#define F54_SHM_MAGIC				(0x52343546)	/* "F54R" */
+#define F54_SHM_VERSION				(1)
+
+/*
+ * default settings of the capture engine
+ */
+#define F54_CAPTURE_INTERVAL_MS		(100)
+#define F54_RING_DEPTH				(16)
+#define F54_NOISE_FRAMES			(16)
+
+/*
+ * bus access of the capture
+ * the report data is read in small chunks, so that a pending touch report
+ * waits for one chunk at most
+ */
+#define F54_READ_CHUNK				(64)
+#define F54_REPORT_TIMEOUT_MS		(100)
+#define F54_REPORT_POLL_MS			(5)
+#define F54_COMMAND_TIMEOUT_MS		(1000)
+
+/*
+ * report types of F$54
+ */
+enum f54_report_types {
+	F54_16BIT_IMAGE = 2,
+	F54_RAW_16BIT_IMAGE = 3,
+	F54_FULL_RAW_CAP_NO_RX_COUPLING = 20,
+};
+
+/*
+ * capture modes selected by the f54_capture option
+ *
+ * F54_CAPTURE_RAW: raw capacitance image
+ * F54_CAPTURE_DELTA: delta image, baseline-subtracted capacitance
+ * F54_CAPTURE_NOISE: per-pixel peak-to-peak of the delta image,
+ *                    accumulated over F54_NOISE_FRAMES captures
+ */
+enum f54_capture_mode {
+	F54_CAPTURE_OFF = 0,
+	F54_CAPTURE_RAW,
+	F54_CAPTURE_DELTA,
+	F54_CAPTURE_NOISE,
+};
+
+/*
+ * layout of the shared-memory object
+ *
+ * the object starts with the header, followed by "depth" slots of "slot_size"
+ * bytes each. one frame occupies one slot, and the frame n is written to the
+ * slot (n % depth). the writer never waits for the readers.
+ *
+ * every slot is protected by a sequence counter, which is odd while the slot is
+ * being written. a reader should
+ *    1. read the header->head, the number of frames published so far
+ *    2. read the slot->seq, retry if it is odd
+ *    3. copy the slot
+ *    4. read the slot->seq again, the copy is valid if it is unchanged
+ *
+ * magic: F54_SHM_MAGIC
+ * version: F54_SHM_VERSION
+ * rx: number of receiver electrodes
+ * tx: number of transmitter electrodes
+ * depth: number of slots in the ring
+ * slot_size: size of one slot, in bytes
+ * head: number of frames published
+ */
+struct synaptics_rmi4_f54_shm_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t rx;
+	uint32_t tx;
+	uint32_t depth;
+	uint32_t slot_size;
+	volatile uint32_t head;
+	uint32_t reserved;
+};
+
+/*
+ * seq: sequence counter of the slot
+ * mode: the capture mode of the frame, enum f54_capture_mode
+ * frame: frame number, same as the header->head after publishing
+ * timestamp: time of the capture, CLOCK_MONOTONIC in nanoseconds
+ * data: tx * rx pixels, the raw capacitance is unsigned
+ */
+struct synaptics_rmi4_f54_shm_slot {
+	volatile uint32_t seq;
+	uint32_t mode;
+	uint32_t frame;
+	uint32_t reserved;
+	uint64_t timestamp;
+	int16_t data[];
+};
+
+
+struct synaptics_rmi4_data;
+
+extern int synaptics_rmi4_f54_init(struct synaptics_rmi4_data *rmi4_data, unsigned int mode,
+			unsigned int interval_ms, unsigned int depth);
+extern void synaptics_rmi4_f54_deinit(void);
+extern int synaptics_rmi4_f54_get_electrodes(struct synaptics_rmi4_data *rmi4_data,
+			unsigned char *rx, unsigned char *tx);
+extern int synaptics_rmi4_f54_read_image(struct synaptics_rmi4_data *rmi4_data,
+			unsigned char report_type, uint16_t *image, unsigned int pixels);
+
+#endif /* _SYNAPTICS_RMI4_F54_H_ */
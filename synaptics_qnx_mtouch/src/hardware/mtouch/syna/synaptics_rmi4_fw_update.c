@@ -50,11 +50,13 @@
 
 #include "synaptics_mtouch.h"
 #include "synaptics_rmi4_fw_update.h"
+#include "synaptics_rmi4_lz4.h"
 
 enum flash_area {
 	NONE = 0,
 	UI_FIRMWARE,
 	UI_CONFIG,
+	UI_PARTITIONS,  // the partitions in g_fwu->diff_partitions, the ui firmware is unchanged
 };
 
 #define ENABLE_WAIT_MS (200)
@@ -66,10 +68,33 @@ enum flash_area {
 
 #define READ_CONFIG_WAIT_US (20*1000)
 
-#define MAX_WRITE_SIZE (64)
+/* payload of one i2c write, the register address takes one byte of the transfer */
+#define MAX_WRITE_SIZE (I2C_XFER_LIMIT - 1)
+
+/* the transfer length and the flash command ahead of the payload of boot-loader 7 */
+#define V7_TRANSFER_HEADER_SIZE (3)
+
+/* bytes of a partition decoded at once, while a compressed image is streamed into the flash */
+#define FWU_STREAM_CHUNK_SIZE (4096)
 
 static struct synaptics_rmi4_fwu_handle *g_fwu;
 
+static char fwu_journal_path[PATH_MAX];
+
+// called right before the bootloader mode is entered, see synaptics_rmi4_fwu_set_handoff()
+static void (*fwu_handoff)(void *arg);
+static void *fwu_handoff_arg;
+
+static struct synaptics_rmi4_fwu_progress fwu_progress = {
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static pthread_once_t fwu_attn_once = PTHREAD_ONCE_INIT;
+static struct synaptics_rmi4_fwu_attn fwu_attn = {
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+	.mode = ATTN_OFF,
+};
+
 /*
  * miscellaneous helper functions
  */
@@ -86,6 +111,30 @@ static unsigned int le_to_uint(const unsigned char *ptr)
 			(unsigned int)ptr[3] * 0x1000000;
 }
 
+/*
+ * helper function to compute the CRC-32 (IEEE 802.3) of the data
+ *
+ * unsigned int crc: the CRC of the preceding data, 0 to start
+ * const unsigned char *data: the data
+ * unsigned int size: number of bytes
+ *
+ * return the CRC
+ */
+static unsigned int synaptics_rmi4_fwu_crc32(unsigned int crc, const unsigned char *data,
+											unsigned int size)
+{
+	unsigned char ii;
+
+	crc = ~crc;
+	while (size--) {
+		crc ^= *data++;
+		for (ii = 0; ii < 8; ii++)
+			crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+	}
+
+	return ~crc;
+}
+
 /*
  * to get the size config buffer, and allocate the buffer
  *
@@ -267,19 +316,158 @@ static int synaptics_rmi4_fwu_parse_partition_table(const unsigned char *partiti
 
 
 /*
- * to parse the utility parameter part in the image file
+ * helper function to read a part of the image
+ * a compressed image is decoded up to the part
+ *
+ * unsigned int offset: offset in the image
+ * void *buf: buffer to store the data
+ * unsigned int size: number of bytes to read
+ *
+ * return EOK: complete
+ * otherwise, fail
+ */
+static int synaptics_rmi4_fwu_image_read(unsigned int offset, void *buf, unsigned int size)
+{
+	if ((offset > g_fwu->image_size) || (size > g_fwu->image_size - offset)) {
+		mtouch_error(MTOUCH_DEV, "%s: invalid offset 0x%x in the image", __FUNCTION__, offset);
+		return -EINVAL;
+	}
+
+	if (g_fwu->stream)
+		return synaptics_rmi4_lz4_stream_read(g_fwu->stream, offset, buf, size);
+
+	if (!g_fwu->image)
+		return -EINVAL;
+
+	memcpy(buf, g_fwu->image + offset, size);
+
+	return EOK;
+}
+
+/*
+ * helper function to check whether the image is loaded,
+ * either mapped or opened as a compressed stream
+ *
+ * return true: loaded
+ * otherwise, false
+ */
+static bool synaptics_rmi4_fwu_image_loaded(void)
+{
+	return (g_fwu->image != NULL) || (g_fwu->stream != NULL);
+}
+
+/*
+ * to release the content of a container read out of a compressed image
+ *
+ * struct block_data *part: the content
+ *
+ * return void
+ */
+static void synaptics_rmi4_fwu_image_part_free(struct block_data *part)
+{
+	free(part->copy);
+	part->copy = NULL;
+	part->data = NULL;
+}
+
+/*
+ * to release the contents of all the containers of the image
  *
  * return void
  */
-static void synaptics_rmi4_fwu_parse_image_header_10_utility(const unsigned char *image)
+static void synaptics_rmi4_fwu_image_parts_free(void)
+{
+	unsigned char ii;
+
+	synaptics_rmi4_fwu_image_part_free(&g_fwu->img.bootloader);
+	synaptics_rmi4_fwu_image_part_free(&g_fwu->img.utility);
+	synaptics_rmi4_fwu_image_part_free(&g_fwu->img.ui_firmware);
+	synaptics_rmi4_fwu_image_part_free(&g_fwu->img.ui_config);
+	synaptics_rmi4_fwu_image_part_free(&g_fwu->img.dp_config);
+	synaptics_rmi4_fwu_image_part_free(&g_fwu->img.pm_config);
+	synaptics_rmi4_fwu_image_part_free(&g_fwu->img.fl_config);
+	synaptics_rmi4_fwu_image_part_free(&g_fwu->img.bl_image);
+	synaptics_rmi4_fwu_image_part_free(&g_fwu->img.bl_config);
+	synaptics_rmi4_fwu_image_part_free(&g_fwu->img.lockdown);
+	synaptics_rmi4_fwu_image_part_free(&g_fwu->img.guest_code);
+
+	for (ii = 0; ii < MAX_UTILITY_PARAMS; ii++)
+		synaptics_rmi4_fwu_image_part_free(&g_fwu->img.utility_param[ii]);
+}
+
+/*
+ * to locate the content of a container in the image
+ * the content is referred in the mapped image. from a compressed image, the
+ * content is read out, unless it is streamed into the flash memory by
+ * synaptics_rmi4_fwu_write_f34_part()
+ *
+ * struct block_data *part: the content
+ * unsigned int offset: offset of the content in the image
+ * unsigned int size: size of the content
+ * bool streamed: the content is not kept in memory for a compressed image
+ *
+ * return EOK: complete
+ * otherwise, fail
+ */
+static int synaptics_rmi4_fwu_image_part(struct block_data *part, unsigned int offset,
+											unsigned int size, bool streamed)
+{
+	int retval;
+
+	synaptics_rmi4_fwu_image_part_free(part);
+
+	if ((offset > g_fwu->image_size) || (size > g_fwu->image_size - offset)) {
+		mtouch_error(MTOUCH_DEV, "%s: invalid content at 0x%x (%d bytes)",
+					__FUNCTION__, offset, size);
+		return -EINVAL;
+	}
+
+	part->offset = offset;
+	part->size = size;
+	part->crc_size = 0;
+
+	if (!g_fwu->stream) {
+		part->data = g_fwu->image + offset;
+		return EOK;
+	}
+
+	if (streamed)
+		return EOK;
+
+	// an empty content is still referred, as it is in the mapped image
+	part->copy = malloc((size) ? size : 1);
+	if (!part->copy) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to allocate %d bytes", __FUNCTION__, size);
+		return -ENOMEM;
+	}
+
+	retval = synaptics_rmi4_fwu_image_read(offset, part->copy, size);
+	if (retval < 0) {
+		synaptics_rmi4_fwu_image_part_free(part);
+		return retval;
+	}
+
+	part->data = part->copy;
+
+	return EOK;
+}
+
+/*
+ * to parse the utility parameter part in the image file
+ *
+ * return EOK: complete
+ * otherwise, fail
+ */
+static int synaptics_rmi4_fwu_parse_image_header_10_utility(void)
 {
+	int retval = EOK;
 	unsigned char ii;
 	unsigned char num_of_containers;
 	unsigned int addr;
 	unsigned int container_id;
 	unsigned int length;
-	const unsigned char *content;
-	struct container_descriptor *descriptor;
+	unsigned int content;
+	struct container_descriptor descriptor;
 
 	num_of_containers = g_fwu->img.utility.size / 4;
 
@@ -287,165 +475,192 @@ static void synaptics_rmi4_fwu_parse_image_header_10_utility(const unsigned char
 		if (ii >= MAX_UTILITY_PARAMS)
 			continue;
 		addr = le_to_uint(g_fwu->img.utility.data + (ii * 4));
-		descriptor = (struct container_descriptor *)(image + addr);
-		container_id = descriptor->container_id[0] |
-				descriptor->container_id[1] << 8;
-		content = image + le_to_uint(descriptor->content_address);
-		length = le_to_uint(descriptor->content_length);
+		retval = synaptics_rmi4_fwu_image_read(addr, &descriptor, sizeof(descriptor));
+		if (retval < 0)
+			return retval;
+		container_id = descriptor.container_id[0] |
+				descriptor.container_id[1] << 8;
+		content = le_to_uint(descriptor.content_address);
+		length = le_to_uint(descriptor.content_length);
 		switch (container_id) {
 		case UTILITY_PARAMETER_CONTAINER:
-			g_fwu->img.utility_param[ii].data = content;
-			g_fwu->img.utility_param[ii].size = length;
-			g_fwu->img.utility_param_id[ii] = content[0];
+			retval = synaptics_rmi4_fwu_image_part(&g_fwu->img.utility_param[ii],
+						content, length, false);
+			if ((retval == EOK) && (length > 0))
+				g_fwu->img.utility_param_id[ii] = g_fwu->img.utility_param[ii].data[0];
 			break;
 		default:
 			break;
 		};
+
+		if (retval < 0)
+			return retval;
 	}
 
-	return;
+	return EOK;
 }
 
 /*
  * to parse the bootloader part in the image file
  *
- * return void
+ * return EOK: complete
+ * otherwise, fail
  */
-static void synaptics_rmi4_fwu_parse_image_header_10_bootloader(const unsigned char *image)
+static int synaptics_rmi4_fwu_parse_image_header_10_bootloader(void)
 {
+	int retval = EOK;
 	unsigned char ii;
 	unsigned char num_of_containers;
 	unsigned int addr;
 	unsigned int container_id;
 	unsigned int length;
-	const unsigned char *content;
-	struct container_descriptor *descriptor;
+	unsigned int content;
+	struct container_descriptor descriptor;
+
+	if (g_fwu->img.bootloader.size < 4)
+		return EOK;
 
 	num_of_containers = (g_fwu->img.bootloader.size - 4) / 4;
 
 	for (ii = 1; ii <= num_of_containers; ii++) {
 		addr = le_to_uint(g_fwu->img.bootloader.data + (ii * 4));
-		descriptor = (struct container_descriptor *)(image + addr);
-		container_id = descriptor->container_id[0] |
-				descriptor->container_id[1] << 8;
-		content = image + le_to_uint(descriptor->content_address);
-		length = le_to_uint(descriptor->content_length);
+		retval = synaptics_rmi4_fwu_image_read(addr, &descriptor, sizeof(descriptor));
+		if (retval < 0)
+			return retval;
+		container_id = descriptor.container_id[0] |
+				descriptor.container_id[1] << 8;
+		content = le_to_uint(descriptor.content_address);
+		length = le_to_uint(descriptor.content_length);
 		switch (container_id) {
 		case BL_IMAGE_CONTAINER:
-			g_fwu->img.bl_image.data = content;
-			g_fwu->img.bl_image.size = length;
+			retval = synaptics_rmi4_fwu_image_part(&g_fwu->img.bl_image, content, length, true);
 			break;
 		case BL_CONFIG_CONTAINER:
 		case GLOBAL_PARAMETERS_CONTAINER:
-			g_fwu->img.bl_config.data = content;
-			g_fwu->img.bl_config.size = length;
+			retval = synaptics_rmi4_fwu_image_part(&g_fwu->img.bl_config, content, length, false);
 			break;
 		case BL_LOCKDOWN_INFO_CONTAINER:
 		case DEVICE_CONFIG_CONTAINER:
-			g_fwu->img.lockdown.data = content;
-			g_fwu->img.lockdown.size = length;
+			retval = synaptics_rmi4_fwu_image_part(&g_fwu->img.lockdown, content, length, false);
 			break;
 		default:
 			break;
 		};
+
+		if (retval < 0)
+			return retval;
 	}
 
-	return;
+	return EOK;
 }
 
 /*
  * to parse the image file contents
+ * the ui firmware and the guest code of a compressed image are streamed, the
+ * other containers are small and read out
  *
  * return EOK: complete the parsing
  * otherwise, fail
  */
 static int synaptics_rmi4_fwu_parse_image_header_10(void)
 {
+	int retval;
 	unsigned char ii;
 	unsigned char num_of_containers;
+	unsigned char data[4];
 	unsigned int addr;
 	unsigned int offset;
 	unsigned int container_id;
 	unsigned int length;
-	const unsigned char *image;
-	const unsigned char *content;
-	struct container_descriptor *descriptor;
-	struct image_header_10 *header;
+	unsigned int content;
+	struct container_descriptor descriptor;
+	struct image_header_10 header;
 
 	_CHECK_POINTER(g_fwu);
-	_CHECK_POINTER(g_fwu->image);
 
-	image = g_fwu->image;
-	header = (struct image_header_10 *)image;
+	retval = synaptics_rmi4_fwu_image_read(0, &header, sizeof(header));
+	if (retval < 0)
+		return retval;
 
-	g_fwu->img.checksum = le_to_uint(header->checksum);
+	g_fwu->img.checksum = le_to_uint(header.checksum);
 
 	/* address of top level container */
-	offset = le_to_uint(header->top_level_container_start_addr);
-	descriptor = (struct container_descriptor *)(image + offset);
+	offset = le_to_uint(header.top_level_container_start_addr);
+	retval = synaptics_rmi4_fwu_image_read(offset, &descriptor, sizeof(descriptor));
+	if (retval < 0)
+		return retval;
 
 	/* address of top level container content */
-	offset = le_to_uint(descriptor->content_address);
-	num_of_containers = le_to_uint(descriptor->content_length) / 4;
+	offset = le_to_uint(descriptor.content_address);
+	num_of_containers = le_to_uint(descriptor.content_length) / 4;
 
 	for (ii = 0; ii < num_of_containers; ii++) {
-		addr = le_to_uint(image + offset);
+		retval = synaptics_rmi4_fwu_image_read(offset, data, sizeof(data));
+		if (retval < 0)
+			return retval;
+		addr = le_to_uint(data);
 		offset += 4;
-		descriptor = (struct container_descriptor *)(image + addr);
-		container_id = descriptor->container_id[0] |
-				descriptor->container_id[1] << 8;
-		content = image + le_to_uint(descriptor->content_address);
-		length = le_to_uint(descriptor->content_length);
+		retval = synaptics_rmi4_fwu_image_read(addr, &descriptor, sizeof(descriptor));
+		if (retval < 0)
+			return retval;
+		container_id = descriptor.container_id[0] |
+				descriptor.container_id[1] << 8;
+		content = le_to_uint(descriptor.content_address);
+		length = le_to_uint(descriptor.content_length);
 		switch (container_id) {
 		case UI_CONTAINER:
 		case CORE_CODE_CONTAINER:
-			g_fwu->img.ui_firmware.data = content;
-			g_fwu->img.ui_firmware.size = length;
+			retval = synaptics_rmi4_fwu_image_part(&g_fwu->img.ui_firmware, content, length, true);
 			break;
 		case UI_CONFIG_CONTAINER:
 		case CORE_CONFIG_CONTAINER:
-			g_fwu->img.ui_config.data = content;
-			g_fwu->img.ui_config.size = length;
+			retval = synaptics_rmi4_fwu_image_part(&g_fwu->img.ui_config, content, length, false);
 			break;
 		case BL_CONTAINER:
-			g_fwu->img.bl_version = *content;
-			g_fwu->img.bootloader.data = content;
-			g_fwu->img.bootloader.size = length;
-			synaptics_rmi4_fwu_parse_image_header_10_bootloader(image);
+			retval = synaptics_rmi4_fwu_image_read(content, &g_fwu->img.bl_version, 1);
+			if (retval < 0)
+				break;
+			retval = synaptics_rmi4_fwu_image_part(&g_fwu->img.bootloader, content, length, false);
+			if (retval < 0)
+				break;
+			retval = synaptics_rmi4_fwu_parse_image_header_10_bootloader();
 			break;
 		case UTILITY_CONTAINER:
-			g_fwu->img.utility.data = content;
-			g_fwu->img.utility.size = length;
-			synaptics_rmi4_fwu_parse_image_header_10_utility(image);
+			retval = synaptics_rmi4_fwu_image_part(&g_fwu->img.utility, content, length, false);
+			if (retval < 0)
+				break;
+			retval = synaptics_rmi4_fwu_parse_image_header_10_utility();
 			break;
 		case GUEST_CODE_CONTAINER:
 			g_fwu->img.contains_guest_code = true;
-			g_fwu->img.guest_code.data = content;
-			g_fwu->img.guest_code.size = length;
+			retval = synaptics_rmi4_fwu_image_part(&g_fwu->img.guest_code, content, length, true);
 			break;
 		case DISPLAY_CONFIG_CONTAINER:
 			g_fwu->img.contains_disp_config = true;
-			g_fwu->img.dp_config.data = content;
-			g_fwu->img.dp_config.size = length;
+			retval = synaptics_rmi4_fwu_image_part(&g_fwu->img.dp_config, content, length, false);
 			break;
 		case PERMANENT_CONFIG_CONTAINER:
 		case GUEST_SERIALIZATION_CONTAINER:
 			g_fwu->img.contains_perm_config = true;
-			g_fwu->img.pm_config.data = content;
-			g_fwu->img.pm_config.size = length;
+			retval = synaptics_rmi4_fwu_image_part(&g_fwu->img.pm_config, content, length, false);
 			break;
 		case FLASH_CONFIG_CONTAINER:
 			g_fwu->img.contains_flash_config = true;
-			g_fwu->img.fl_config.data = content;
-			g_fwu->img.fl_config.size = length;
+			retval = synaptics_rmi4_fwu_image_part(&g_fwu->img.fl_config, content, length, false);
 			break;
 		case GENERAL_INFORMATION_CONTAINER:
+			retval = synaptics_rmi4_fwu_image_read(content + 4, data, sizeof(data));
+			if (retval < 0)
+				break;
 			g_fwu->img.contains_firmware_id = true;
-			g_fwu->img.firmware_id = le_to_uint(content + 4);
+			g_fwu->img.firmware_id = le_to_uint(data);
 			break;
 		default:
 			break;
 		}
+
+		if (retval < 0)
+			return retval;
 	}
 
 	return EOK;
@@ -459,73 +674,82 @@ static int synaptics_rmi4_fwu_parse_image_header_10(void)
  */
 static int synaptics_rmi4_fwu_parse_image_header_05_06(void)
 {
-	const unsigned char * image;
-	struct image_header_05_06 *header;
+	int retval;
+	unsigned int offset;
+	struct image_header_05_06 header;
 
 	_CHECK_POINTER(g_fwu);
-	_CHECK_POINTER(g_fwu->image);
 
-	image = g_fwu->image;
-	header = (struct image_header_05_06 *)g_fwu->image;
+	retval = synaptics_rmi4_fwu_image_read(0, &header, sizeof(header));
+	if (retval < 0)
+		return retval;
 
-	g_fwu->img.checksum = le_to_uint(header->checksum);
+	g_fwu->img.checksum = le_to_uint(header.checksum);
 
-	g_fwu->img.bl_version = header->header_version;
+	g_fwu->img.bl_version = header.header_version;
 
-	g_fwu->img.contains_bootloader = header->options_bootloader;
+	g_fwu->img.contains_bootloader = header.options_bootloader;
 
 	if (g_fwu->img.contains_bootloader)
-		g_fwu->img.bootloader_size = le_to_uint(header->bootloader_size);
+		g_fwu->img.bootloader_size = le_to_uint(header.bootloader_size);
 
-	g_fwu->img.ui_firmware.size = le_to_uint(header->firmware_size);
-	if (g_fwu->img.ui_firmware.size) {
-		g_fwu->img.ui_firmware.data = image + IMAGE_AREA_OFFSET;
-		if (g_fwu->img.contains_bootloader)
-			g_fwu->img.ui_firmware.data += g_fwu->img.bootloader_size;
-	}
+	offset = IMAGE_AREA_OFFSET;
+	if (g_fwu->img.contains_bootloader)
+		offset += g_fwu->img.bootloader_size;
 
-	if ((g_fwu->img.bl_version == BL_V6) && header->options_tddi)
-		g_fwu->img.ui_firmware.data = image + IMAGE_AREA_OFFSET;
+	if ((g_fwu->img.bl_version == BL_V6) && header.options_tddi)
+		offset = IMAGE_AREA_OFFSET;
 
-	g_fwu->img.ui_config.size = le_to_uint(header->config_size);
-	if (g_fwu->img.ui_config.size) {
-		g_fwu->img.ui_config.data = g_fwu->img.ui_firmware.data + g_fwu->img.ui_firmware.size;
-	}
+	retval = synaptics_rmi4_fwu_image_part(&g_fwu->img.ui_firmware, offset,
+				le_to_uint(header.firmware_size), true);
+	if (retval < 0)
+		return retval;
+
+	retval = synaptics_rmi4_fwu_image_part(&g_fwu->img.ui_config,
+				offset + g_fwu->img.ui_firmware.size,
+				le_to_uint(header.config_size), false);
+	if (retval < 0)
+		return retval;
 
-	if (g_fwu->img.contains_bootloader || header->options_tddi)
+	if (g_fwu->img.contains_bootloader || header.options_tddi)
 		g_fwu->img.contains_disp_config = true;
 	else
 		g_fwu->img.contains_disp_config = false;
 
 	if (g_fwu->img.contains_disp_config) {
-		g_fwu->img.disp_config_offset = le_to_uint(header->dsp_cfg_addr);
-		g_fwu->img.dp_config.size = le_to_uint(header->dsp_cfg_size);
-		g_fwu->img.dp_config.data = image + g_fwu->img.disp_config_offset;
+		g_fwu->img.disp_config_offset = le_to_uint(header.dsp_cfg_addr);
+		retval = synaptics_rmi4_fwu_image_part(&g_fwu->img.dp_config,
+					g_fwu->img.disp_config_offset,
+					le_to_uint(header.dsp_cfg_size), false);
+		if (retval < 0)
+			return retval;
 	}
 	else {
 		if ((PRODUCT_ID_SIZE > sizeof(g_fwu->img.cstmr_product_id)) ||
-			(PRODUCT_ID_SIZE > sizeof(header->cstmr_product_id))) {
+			(PRODUCT_ID_SIZE > sizeof(header.cstmr_product_id))) {
 			mtouch_error(MTOUCH_DEV, "%s: invalid size of customer product id", __FUNCTION__);
 			return -EINVAL;
 		}
-		memcpy(g_fwu->img.cstmr_product_id, header->cstmr_product_id, PRODUCT_ID_SIZE);
+		memcpy(g_fwu->img.cstmr_product_id, header.cstmr_product_id, PRODUCT_ID_SIZE);
 		g_fwu->img.cstmr_product_id[PRODUCT_ID_SIZE] = 0;
 	}
 
-	g_fwu->img.contains_firmware_id = header->options_firmware_id;
+	g_fwu->img.contains_firmware_id = header.options_firmware_id;
 	if (g_fwu->img.contains_firmware_id)
-		g_fwu->img.firmware_id = le_to_uint(header->firmware_id);
+		g_fwu->img.firmware_id = le_to_uint(header.firmware_id);
 
 	if ((PRODUCT_ID_SIZE > sizeof(g_fwu->img.product_id)) ||
-		(PRODUCT_ID_SIZE > sizeof(header->product_id))) {
+		(PRODUCT_ID_SIZE > sizeof(header.product_id))) {
 		mtouch_error(MTOUCH_DEV, "%s: invalid size of product id", __FUNCTION__);
 		return -EINVAL;
 	}
-	memcpy(g_fwu->img.product_id, header->product_id, PRODUCT_ID_SIZE);
+	memcpy(g_fwu->img.product_id, header.product_id, PRODUCT_ID_SIZE);
 	g_fwu->img.product_id[PRODUCT_ID_SIZE] = 0;
 
-	g_fwu->img.lockdown.size = LOCKDOWN_SIZE;
-	g_fwu->img.lockdown.data = image + IMAGE_AREA_OFFSET - LOCKDOWN_SIZE;
+	retval = synaptics_rmi4_fwu_image_part(&g_fwu->img.lockdown,
+				IMAGE_AREA_OFFSET - LOCKDOWN_SIZE, LOCKDOWN_SIZE, false);
+	if (retval < 0)
+		return retval;
 
 	return EOK;
 }
@@ -540,16 +764,21 @@ static int synaptics_rmi4_fwu_parse_image_header_05_06(void)
 static int synaptics_rmi4_fwu_parse_image_info(void)
 {
 	int retval;
-	struct image_header_10 *header;
+	struct image_header_10 header;
 
 	_CHECK_POINTER(g_fwu);
-	_CHECK_POINTER(g_fwu->image);
 
-	header = (struct image_header_10 *)g_fwu->image;
+	if (!synaptics_rmi4_fwu_image_loaded())
+		return -EINVAL;
+
+	retval = synaptics_rmi4_fwu_image_read(0, &header, sizeof(header));
+	if (retval < 0)
+		return retval;
 
+	synaptics_rmi4_fwu_image_parts_free();
 	memset(&g_fwu->img, 0x00, sizeof(g_fwu->img));
 
-	switch (header->major_header_version) {
+	switch (header.major_header_version) {
 	case IMAGE_HEADER_VERSION_05:
 	case IMAGE_HEADER_VERSION_06:
 		retval = synaptics_rmi4_fwu_parse_image_header_05_06();
@@ -559,7 +788,7 @@ static int synaptics_rmi4_fwu_parse_image_info(void)
 		break;
 	default:
 		mtouch_error(MTOUCH_DEV, "%s: unsupported image file format (0x%02x)",
-					__FUNCTION__, header->major_header_version);
+					__FUNCTION__, header.major_header_version);
 		retval = -ENODEV;
 		break;
 	}
@@ -656,21 +885,185 @@ static int synaptics_rmi4_fwu_read_flash_status(void)
 	return EOK;
 }
 
+/*
+ * initialize the condition of the attention with the monotonic clock
+ * called once by pthread_once()
+ *
+ * return void
+ */
+static void synaptics_rmi4_fwu_attn_init(void)
+{
+	pthread_condattr_t attr;
+
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&fwu_attn.cond, &attr);
+	pthread_condattr_destroy(&attr);
+}
+
+/*
+ * switch the servicing of the attention
+ * the address of the interrupt status is taken from the current F$01
+ *
+ * enum fwu_attn_mode mode: the new mode
+ *
+ * return void
+ */
+static void synaptics_rmi4_fwu_attn_set(enum fwu_attn_mode mode)
+{
+	struct synaptics_rmi4_data *rmi4_data = g_fwu->rmi4_data;
+
+	pthread_once(&fwu_attn_once, synaptics_rmi4_fwu_attn_init);
+
+	pthread_mutex_lock(&fwu_attn.mutex);
+
+	switch (mode) {
+	case ATTN_DISCARD:
+		fwu_attn.addr = rmi4_data->f01->base_addr.data_base + 1;
+		fwu_attn.regs = rmi4_data->num_of_intr_regs;
+		fwu_attn.mask = 0;
+		break;
+
+	case ATTN_FLASH:
+		// only F$01 and F$34 exist in the bootloader mode
+		fwu_attn.addr = rmi4_data->f01->base_addr.data_base + 1;
+		fwu_attn.regs = 1;
+		fwu_attn.mask = g_fwu->intr_mask;
+		fwu_attn.seen = fwu_attn.count;
+		break;
+
+	default:
+		break;
+	}
+
+	fwu_attn.mode = mode;
+
+	pthread_mutex_unlock(&fwu_attn.mutex);
+}
+
+/*
+ * check whether the attention is routed to the firmware update
+ *
+ * return true: routed by synaptics_rmi4_fwu_attn_enable()
+ */
+static bool synaptics_rmi4_fwu_attn_enabled(void)
+{
+	bool enabled;
+
+	pthread_mutex_lock(&fwu_attn.mutex);
+	enabled = (ATTN_OFF != fwu_attn.mode);
+	pthread_mutex_unlock(&fwu_attn.mutex);
+
+	return enabled;
+}
+
+/*
+ * start counting the programmed blocks of a new reflash
+ *
+ * unsigned int total: the blocks expected to be programmed
+ *
+ * return void
+ */
+static void synaptics_rmi4_fwu_progress_reset(unsigned int total)
+{
+	pthread_mutex_lock(&fwu_progress.mutex);
+	fwu_progress.total = total;
+	fwu_progress.written = 0;
+	pthread_mutex_unlock(&fwu_progress.mutex);
+}
+
+/*
+ * count the blocks programmed by synaptics_rmi4_fwu_write_f34_blocks()
+ * the count does not go beyond the total, which leaves out the partition table
+ *
+ * unsigned int blocks: the blocks programmed
+ *
+ * return void
+ */
+static void synaptics_rmi4_fwu_progress_add(unsigned int blocks)
+{
+	pthread_mutex_lock(&fwu_progress.mutex);
+	if (blocks > fwu_progress.total - fwu_progress.written)
+		fwu_progress.written = fwu_progress.total;
+	else
+		fwu_progress.written += blocks;
+	pthread_mutex_unlock(&fwu_progress.mutex);
+}
+
+/*
+ * wait for the flash interrupt signalled by synaptics_rmi4_fwu_attn()
+ *
+ * uint64_t deadline: the monotonic time in nanoseconds to give up
+ *
+ * return EOK: the flash interrupt is asserted
+ * return -ETIMEDOUT: the deadline is passed
+ * return -ENOTSUP: the attention is not available, the caller polls the status
+ */
+static int synaptics_rmi4_fwu_wait_for_attn(uint64_t deadline)
+{
+	int retval = EOK;
+	struct timespec ts;
+
+	nsec2timespec(&ts, deadline);
+
+	pthread_mutex_lock(&fwu_attn.mutex);
+
+	if (ATTN_FLASH != fwu_attn.mode) {
+		pthread_mutex_unlock(&fwu_attn.mutex);
+		return -ENOTSUP;
+	}
+
+	while ((fwu_attn.count == fwu_attn.seen) && (EOK == retval))
+		retval = pthread_cond_timedwait(&fwu_attn.cond, &fwu_attn.mutex, &ts);
+
+	fwu_attn.seen = fwu_attn.count;
+
+	pthread_mutex_unlock(&fwu_attn.mutex);
+
+	return (EOK == retval) ? EOK : -ETIMEDOUT;
+}
+
 /*
  * a routine to wait for the completion of rmi operation
  * and also check the flash status
  *
+ * the completion is signalled by the F$34 attention while the update owns it,
+ * the flash status is polled in 1 ms steps otherwise
+ *
  * return EOK: complete
  * otherwise, fail
  */
 static int synaptics_rmi4_fwu_wait_for_idle(int timeout_ms, bool poll)
 {
+	int retval;
 	int count = 0;
 	int timeout_count = timeout_ms + 1;
+	uint64_t deadline;
 
 	_CHECK_POINTER(g_fwu);
 	_CHECK_POINTER(g_fwu->rmi4_data);
 
+	ClockTime(CLOCK_MONOTONIC, NULL, &deadline);
+	deadline += (uint64_t)timeout_count * WAIT_FOR_IDLE_US * 1000;
+
+	do {
+		retval = synaptics_rmi4_fwu_wait_for_attn(deadline);
+		if (-ENOTSUP == retval)
+			break;
+
+		// the status is read once more at the timeout, as the polling does
+		synaptics_rmi4_fwu_read_flash_status();
+
+		if ((g_fwu->command == CMD_IDLE) && (g_fwu->flash_status == 0x00))
+			return EOK;
+	} while (-ETIMEDOUT != retval);
+
+	if (-ETIMEDOUT == retval) {
+		mtouch_error(MTOUCH_DEV, "%s: timed out waiting for idle status"
+				, __FUNCTION__);
+		return -ETIMEDOUT;
+	}
+
 	do {
 		usleep(WAIT_FOR_IDLE_US); // 1 ms
 
@@ -995,6 +1388,8 @@ static int synaptics_rmi4_fwu_write_f34_v7_partition_id(unsigned char cmd)
 			partition = FLASH_CONFIG_PARTITION;
 		else if (g_fwu->config_area == UPP_AREA)
 			partition = UTILITY_PARAMETER_PARTITION;
+		else if (g_fwu->config_area == GUEST_CODE_AREA)
+			partition = GUEST_CODE_PARTITION;
 		break;
 	case CMD_WRITE_LOCKDOWN:
 		partition = DEVICE_CONFIG_PARTITION;
@@ -1433,88 +1828,160 @@ static int synaptics_rmi4_fwu_read_f34_queries(void)
 }
 
 /*
- * for boot-loader 7, to write assigned data blocks into the flash memory
+ * for boot-loader 7, to start a transfer of the data blocks
+ * the transfer length and the flash command are written in one transaction,
+ * the registers of f34_data_03 and f34_data_04 are adjacent
  *
- * return EOK: complete the process
+ * unsigned short transfer: number of blocks in the transfer
+ * unsigned char cmd: CMD_WRITE_* or CMD_READ_CONFIG
+ *
+ * return EOK: complete
  * otherwise, fail
  */
-static int synaptics_rmi4_fwu_write_f34_v7_blocks(unsigned char *block_ptr,
-		unsigned short block_cnt, unsigned char command)
+static int synaptics_rmi4_fwu_start_f34_v7_transfer(unsigned short transfer, unsigned char cmd)
 {
 	int retval;
 	unsigned char data_base;
-	unsigned char length[2];
-	unsigned short transfer;
-	unsigned short remaining = block_cnt;
-	unsigned short block_number = 0;
-	unsigned short left_bytes;
-	unsigned short write_size;
-	unsigned short max_write_size;
-	struct synaptics_rmi4_data *rmi4_data;
+	unsigned char data[3];
 
 	_CHECK_POINTER(g_fwu);
 	_CHECK_POINTER(g_fwu->rmi4_data);
 
-	rmi4_data = g_fwu->rmi4_data;
-	data_base = g_fwu->f34->base_addr.data_base;;
+	data_base = g_fwu->f34->base_addr.data_base;
 
-	retval = synaptics_rmi4_fwu_write_f34_partition_id(command);
-	if (retval < 0)
-		return retval;
+	data[0] = (unsigned char)(transfer & MASK_8BIT);
+	data[1] = (unsigned char)(transfer >> 8);
+	data[2] = (CMD_READ_CONFIG == cmd) ? CMD_V7_READ : CMD_V7_WRITE;
 
-	retval = synaptics_rmi4_reg_write(rmi4_data,
-				data_base + g_fwu->off.block_number,
-				(unsigned char *)&block_number,
-				sizeof(block_number));
+	g_fwu->command = data[2];
+
+	retval = synaptics_rmi4_reg_write(g_fwu->rmi4_data,
+				data_base + g_fwu->off.transfer_length,
+				data,
+				sizeof(data));
 	if (retval < 0) {
-		mtouch_error(MTOUCH_DEV, "%s: failed to write block number",
+		mtouch_error(MTOUCH_DEV, "%s: failed to write transfer length and command",
 					__FUNCTION__);
 		return retval;
 	}
 
-	mtouch_debug(MTOUCH_DEV, "%s: block_cnt = %d, g_fwu->block_size = %d, payload_length = %d",
-				__FUNCTION__, block_cnt, g_fwu->block_size, g_fwu->payload_length);
-
-	do {
-		if (remaining / g_fwu->payload_length)
-			transfer = g_fwu->payload_length;
-		else
-			transfer = remaining;
+	return EOK;
+}
+
+/*
+ * for boot-loader 7, to stage the start of a write transfer
+ * the transfer length, the flash command and the leading payload are built in
+ * one buffer, the registers of f34_data_03, f34_data_04 and f34_data_05 are
+ * adjacent, so they are written in one transaction
+ *
+ * unsigned char *stage: the buffer of MAX_WRITE_SIZE bytes
+ * const unsigned char *block_ptr: the blocks of the transfer
+ * unsigned short transfer: number of blocks in the transfer
+ *
+ * return the bytes of the payload staged, in whole blocks
+ */
+static unsigned int synaptics_rmi4_fwu_stage_f34_v7_transfer(unsigned char *stage,
+		const unsigned char *block_ptr, unsigned short transfer)
+{
+	unsigned int size = transfer * g_fwu->block_size;
+	unsigned int max_size = MAX_WRITE_SIZE - V7_TRANSFER_HEADER_SIZE;
+
+	if (size > max_size)
+		size = max_size - (max_size % g_fwu->block_size);
+
+	stage[0] = (unsigned char)(transfer & MASK_8BIT);
+	stage[1] = (unsigned char)(transfer >> 8);
+	stage[2] = CMD_V7_WRITE;
+
+	memcpy(&stage[V7_TRANSFER_HEADER_SIZE], block_ptr, size);
+
+	return size;
+}
+
+/*
+ * for boot-loader 7, to write assigned data blocks into the flash memory
+ * the next transfer is staged while the device is programming the current one
+ *
+ * unsigned char *block_ptr: the data blocks
+ * unsigned short block_start: the first block number in the partition
+ * unsigned short block_cnt: number of blocks
+ * unsigned char command: the flash command
+ *
+ * return EOK: complete the process
+ * otherwise, fail
+ */
+static int synaptics_rmi4_fwu_write_f34_v7_blocks(unsigned char *block_ptr,
+		unsigned short block_start, unsigned short block_cnt, unsigned char command)
+{
+	int retval;
+	unsigned char data_base;
+	unsigned char stage[MAX_WRITE_SIZE];
+	unsigned short transfer;
+	unsigned short remaining = block_cnt;
+	unsigned short block_number = block_start;
+	unsigned int staged;
+	unsigned int left_bytes;
+	unsigned int write_size;
+	unsigned int max_write_size;
+	struct synaptics_rmi4_data *rmi4_data;
+
+	_CHECK_POINTER(g_fwu);
+	_CHECK_POINTER(g_fwu->rmi4_data);
+
+	rmi4_data = g_fwu->rmi4_data;
+	data_base = g_fwu->f34->base_addr.data_base;;
+
+	if (0 == block_cnt)
+		return EOK;
+
+	retval = synaptics_rmi4_fwu_write_f34_partition_id(command);
+	if (retval < 0)
+		return retval;
+
+	retval = synaptics_rmi4_reg_write(rmi4_data,
+				data_base + g_fwu->off.block_number,
+				(unsigned char *)&block_number,
+				sizeof(block_number));
+	if (retval < 0) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to write block number",
+					__FUNCTION__);
+		return retval;
+	}
+
+	mtouch_debug(MTOUCH_DEV, "%s: block_cnt = %d, g_fwu->block_size = %d, payload_length = %d",
+				__FUNCTION__, block_cnt, g_fwu->block_size, g_fwu->payload_length);
 
+	// the payload is split at the bus limit, in whole blocks
+	max_write_size = MAX_WRITE_SIZE;
+	if (max_write_size > g_fwu->block_size)
+		max_write_size -= max_write_size % g_fwu->block_size;
+	else
+		max_write_size = g_fwu->block_size;
+
+	transfer = (remaining > g_fwu->payload_length) ? g_fwu->payload_length : remaining;
+	staged = synaptics_rmi4_fwu_stage_f34_v7_transfer(stage, block_ptr, transfer);
+
+	do {
 		mtouch_debug(MTOUCH_DEV, "%s: transfer = %d, remaining = %d",
 					__FUNCTION__, transfer, remaining);
 
-		length[0] = (unsigned char)(transfer & MASK_8BIT);
-		length[1] = (unsigned char)(transfer >> 8);
+		// the transfer length, the command and the leading payload
+		g_fwu->command = CMD_V7_WRITE;
 
 		retval = synaptics_rmi4_reg_write(rmi4_data,
 					data_base + g_fwu->off.transfer_length,
-					length,
-					sizeof(length));
-		if (retval < 0) {
-			mtouch_error(MTOUCH_DEV, "%s: failed to write transfer length (remaining = %d)",
-						__FUNCTION__, remaining);
-			return retval;
-		}
-
-		retval = synaptics_rmi4_fwu_write_f34_command(command);
+					stage,
+					V7_TRANSFER_HEADER_SIZE + staged);
 		if (retval < 0) {
-			mtouch_error(MTOUCH_DEV, "%s: failed to write command (remaining = %d)",
+			mtouch_error(MTOUCH_DEV, "%s: failed to start the transfer (remaining = %d)",
 						__FUNCTION__, remaining);
 			return retval;
 		}
 
-		max_write_size = MAX_WRITE_SIZE;
-		if (max_write_size >= transfer * g_fwu->block_size)
-			max_write_size = transfer * g_fwu->block_size;
-		else if (max_write_size > g_fwu->block_size)
-			max_write_size -= max_write_size % g_fwu->block_size;
-		else
-			max_write_size = g_fwu->block_size;
-
-		left_bytes = transfer * g_fwu->block_size;
+		block_ptr += staged;
+		left_bytes = transfer * g_fwu->block_size - staged;
 
-		do {
+		while (left_bytes) {
 			if (left_bytes / max_write_size)
 				write_size = max_write_size;
 			else
@@ -1532,7 +1999,15 @@ static int synaptics_rmi4_fwu_write_f34_v7_blocks(unsigned char *block_ptr,
 
 			block_ptr += write_size;
 			left_bytes -= write_size;
-		} while (left_bytes);
+		}
+
+		remaining -= transfer;
+
+		// stage the next transfer while the device is programming this one
+		if (remaining) {
+			transfer = (remaining > g_fwu->payload_length) ? g_fwu->payload_length : remaining;
+			staged = synaptics_rmi4_fwu_stage_f34_v7_transfer(stage, block_ptr, transfer);
+		}
 
 		retval = synaptics_rmi4_fwu_wait_for_idle(WRITE_WAIT_MS*10, true);
 		if (retval < 0) {
@@ -1540,8 +2015,6 @@ static int synaptics_rmi4_fwu_write_f34_v7_blocks(unsigned char *block_ptr,
 						__FUNCTION__, remaining);
 			return retval;
 		}
-
-		remaining -= transfer;
 	} while (remaining);
 
 	return EOK;
@@ -1550,11 +2023,16 @@ static int synaptics_rmi4_fwu_write_f34_v7_blocks(unsigned char *block_ptr,
 /*
  * for boot-loader 5/6, to write assigned data blocks into the flash memory
  *
+ * unsigned char *block_ptr: the data blocks
+ * unsigned short block_start: the first block number in the area
+ * unsigned short block_cnt: number of blocks
+ * unsigned char command: the flash command
+ *
  * return EOK: complete the process
  * otherwise, fail
  */
 static int synaptics_rmi4_fwu_write_f34_v5v6_blocks(unsigned char *block_ptr,
-		unsigned short block_cnt, unsigned char command)
+		unsigned short block_start, unsigned short block_cnt, unsigned char command)
 {
 	int retval;
 	unsigned char data_base;
@@ -1568,6 +2046,8 @@ static int synaptics_rmi4_fwu_write_f34_v5v6_blocks(unsigned char *block_ptr,
 	rmi4_data = g_fwu->rmi4_data;
 	data_base = g_fwu->f34->base_addr.data_base;;
 
+	block_number[0] = (unsigned char)(block_start & MASK_8BIT);
+	block_number[1] = (unsigned char)(block_start >> 8);
 	block_number[1] |= (g_fwu->config_area << 5);
 
 	retval = synaptics_rmi4_reg_write(rmi4_data,
@@ -1611,6 +2091,61 @@ static int synaptics_rmi4_fwu_write_f34_v5v6_blocks(unsigned char *block_ptr,
 	return EOK;
 }
 
+/*
+ * to dispatch the proper function to program the data blocks
+ *
+ * unsigned char *block_ptr: the data blocks
+ * unsigned short block_start: the first block number
+ * unsigned short block_cnt: number of blocks
+ * unsigned char cmd: the flash command
+ *
+ * return EOK: complete
+ * otherwise, fail
+ */
+static int synaptics_rmi4_fwu_program_f34_blocks(unsigned char *block_ptr,
+			unsigned short block_start, unsigned short block_cnt, unsigned char cmd)
+{
+	int retval;
+
+	if (g_fwu->bl_version == BL_V7 || g_fwu->bl_version == BL_V8) {
+		retval = synaptics_rmi4_fwu_write_f34_v7_blocks(block_ptr, block_start, block_cnt, cmd);
+	}
+	else
+		retval = synaptics_rmi4_fwu_write_f34_v5v6_blocks(block_ptr, block_start, block_cnt, cmd);
+
+	if (retval < 0)
+		return retval;
+
+	synaptics_rmi4_fwu_progress_add(block_cnt);
+
+	return EOK;
+}
+
+/*
+ * to log the throughput of a write phase
+ *
+ * unsigned char cmd: the flash command
+ * unsigned short block_cnt: number of blocks written
+ * uint64_t start: the time when the phase started
+ *
+ * return void
+ */
+static void synaptics_rmi4_fwu_write_f34_throughput(unsigned char cmd,
+			unsigned short block_cnt, uint64_t start)
+{
+	uint64_t end;
+	unsigned int bytes;
+	unsigned int elapsed_us;
+
+	ClockTime(CLOCK_MONOTONIC, NULL, &end);
+	bytes = block_cnt * g_fwu->block_size;
+	elapsed_us = (unsigned int)((end - start) / 1000);
+
+	mtouch_info(MTOUCH_DEV, "%s: command %d, %d bytes in %d ms (%d KB/s)",
+				__FUNCTION__, cmd, bytes, elapsed_us / 1000,
+				(elapsed_us) ? (unsigned int)((uint64_t)bytes * 1000000 / 1024 / elapsed_us) : 0);
+}
+
 /*
  * to dispatch the proper function to write the data block
  *
@@ -1621,14 +2156,96 @@ static int synaptics_rmi4_fwu_write_f34_blocks(unsigned char *block_ptr,
 			unsigned short block_cnt, unsigned char cmd)
 {
 	int retval;
+	uint64_t start;
 
 	_CHECK_POINTER(g_fwu);
 
-	if (g_fwu->bl_version == BL_V7 || g_fwu->bl_version == BL_V8) {
-		retval = synaptics_rmi4_fwu_write_f34_v7_blocks(block_ptr, block_cnt, cmd);
+	ClockTime(CLOCK_MONOTONIC, NULL, &start);
+
+	retval = synaptics_rmi4_fwu_program_f34_blocks(block_ptr, 0, block_cnt, cmd);
+	if (retval < 0)
+		return retval;
+
+	// throughput of this phase
+	synaptics_rmi4_fwu_write_f34_throughput(cmd, block_cnt, start);
+
+	return retval;
+}
+
+/*
+ * to write a partition of the image into the flash memory
+ * the content of a compressed image is decoded and written in chunks of
+ * FWU_STREAM_CHUNK_SIZE, and the CRC-32 of the content is computed on the
+ * way for the verification
+ *
+ * struct block_data *part: the content of the partition
+ * unsigned short block_cnt: number of blocks
+ * unsigned char cmd: the flash command
+ *
+ * return EOK: complete
+ * otherwise, fail
+ */
+static int synaptics_rmi4_fwu_write_f34_part(struct block_data *part,
+			unsigned short block_cnt, unsigned char cmd)
+{
+	int retval = EOK;
+	uint64_t start;
+	unsigned char *chunk;
+	unsigned short chunk_cnt;
+	unsigned short blk;
+	unsigned short cnt;
+	unsigned int crc = 0;
+
+	_CHECK_POINTER(g_fwu);
+
+	if (part->data)
+		return synaptics_rmi4_fwu_write_f34_blocks((unsigned char *)part->data, block_cnt, cmd);
+
+	if (0 == g_fwu->block_size)
+		return -EINVAL;
+
+	// the chunk is made of whole transfers of boot-loader 7
+	chunk_cnt = FWU_STREAM_CHUNK_SIZE / g_fwu->block_size;
+	if ((g_fwu->bl_version == BL_V7 || g_fwu->bl_version == BL_V8) &&
+		(g_fwu->payload_length) && (chunk_cnt > g_fwu->payload_length))
+		chunk_cnt -= chunk_cnt % g_fwu->payload_length;
+	if (0 == chunk_cnt)
+		chunk_cnt = 1;
+
+	chunk = malloc(chunk_cnt * g_fwu->block_size);
+	if (!chunk) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to allocate the chunk buffer", __FUNCTION__);
+		return -ENOMEM;
+	}
+
+	ClockTime(CLOCK_MONOTONIC, NULL, &start);
+
+	for (blk = 0; blk < block_cnt; blk += cnt) {
+		cnt = (block_cnt - blk > chunk_cnt) ? chunk_cnt : block_cnt - blk;
+
+		retval = synaptics_rmi4_fwu_image_read(part->offset + blk * g_fwu->block_size,
+					chunk, cnt * g_fwu->block_size);
+		if (retval < 0) {
+			mtouch_error(MTOUCH_DEV, "%s: failed to read block %d of the image",
+						__FUNCTION__, blk);
+			goto exit;
+		}
+
+		crc = synaptics_rmi4_fwu_crc32(crc, chunk, cnt * g_fwu->block_size);
+
+		retval = synaptics_rmi4_fwu_program_f34_blocks(chunk, blk, cnt, cmd);
+		if (retval < 0)
+			goto exit;
 	}
-	else
-		retval = synaptics_rmi4_fwu_write_f34_v5v6_blocks(block_ptr, block_cnt, cmd);
+
+	part->crc = crc;
+	part->crc_size = block_cnt * g_fwu->block_size;
+
+	// throughput of this phase
+	synaptics_rmi4_fwu_write_f34_throughput(cmd, block_cnt, start);
+
+exit:
+	free(chunk);
 
 	return retval;
 }
@@ -1644,17 +2261,24 @@ static int synaptics_rmi4_fwu_read_f34_v7_blocks(unsigned short block_cnt,
 {
 	int retval;
 	unsigned char data_base;
-	unsigned char length[2];
 	unsigned short transfer;
+	unsigned short max_transfer;
 	unsigned short remaining = block_cnt;
 	unsigned short block_number = 0;
-	unsigned short index = 0;
+	unsigned int index = 0;
 
 	_CHECK_POINTER(g_fwu);
 	_CHECK_POINTER(g_fwu->rmi4_data);
 
 	data_base = g_fwu->f34->base_addr.data_base;
 
+	// each transfer is read out in one i2c read, as many blocks as the bus allows
+	max_transfer = I2C_XFER_LIMIT / g_fwu->block_size;
+	if (max_transfer > g_fwu->payload_length)
+		max_transfer = g_fwu->payload_length;
+	if (0 == max_transfer)
+		max_transfer = 1;
+
 	retval = synaptics_rmi4_fwu_write_f34_partition_id(command);
 	if (retval < 0)
 		return retval;
@@ -1670,27 +2294,20 @@ static int synaptics_rmi4_fwu_read_f34_v7_blocks(unsigned short block_cnt,
 	}
 
 	do {
-		if (remaining / g_fwu->payload_length)
-			transfer = g_fwu->payload_length;
+		if (remaining / max_transfer)
+			transfer = max_transfer;
 		else
 			transfer = remaining;
 
-		length[0] = (unsigned char)(transfer & MASK_8BIT);
-		length[1] = (unsigned char)(transfer >> 8);
-
-		retval = synaptics_rmi4_reg_write(g_fwu->rmi4_data,
-					data_base + g_fwu->off.transfer_length,
-					length,
-					sizeof(length));
-		if (retval < 0) {
-			mtouch_error(MTOUCH_DEV, "%s: failed to write transfer length (remaining = %d)",
+		if (index + transfer * g_fwu->block_size > g_fwu->read_config_buf_size) {
+			mtouch_error(MTOUCH_DEV, "%s: read buffer overflow (remaining = %d)",
 						__FUNCTION__, remaining);
-			return retval;
+			return -EINVAL;
 		}
 
-		retval = synaptics_rmi4_fwu_write_f34_command(command);
+		retval = synaptics_rmi4_fwu_start_f34_v7_transfer(transfer, command);
 		if (retval < 0) {
-			mtouch_error(MTOUCH_DEV, "%s: failed to write command (remaining = %d)",
+			mtouch_error(MTOUCH_DEV, "%s: failed to start the transfer (remaining = %d)",
 						__FUNCTION__, remaining);
 			return retval;
 		}
@@ -1732,7 +2349,7 @@ static int synaptics_rmi4_fwu_read_f34_v5v6_blocks(unsigned short block_cnt,
 	unsigned char data_base;
 	unsigned char block_number[] = {0, 0};
 	unsigned short blk;
-	unsigned short index = 0;
+	unsigned int index = 0;
 
 	_CHECK_POINTER(g_fwu);
 	_CHECK_POINTER(g_fwu->rmi4_data);
@@ -1753,6 +2370,12 @@ static int synaptics_rmi4_fwu_read_f34_v5v6_blocks(unsigned short block_cnt,
 	}
 
 	for (blk = 0; blk < block_cnt; blk++) {
+		if (index + g_fwu->block_size > g_fwu->read_config_buf_size) {
+			mtouch_error(MTOUCH_DEV, "%s: read buffer overflow (block %d)",
+						__FUNCTION__, blk);
+			return -EINVAL;
+		}
+
 		retval = synaptics_rmi4_fwu_write_f34_command(command);
 		if (retval < 0) {
 			mtouch_error(MTOUCH_DEV, "%s: failed to write read config command",
@@ -1792,17 +2415,48 @@ static int synaptics_rmi4_fwu_read_f34_v5v6_blocks(unsigned short block_cnt,
 static int synaptics_rmi4_fwu_read_f34_blocks(unsigned short block_cnt, unsigned char cmd)
 {
 	int retval;
+	uint64_t start;
+	uint64_t end;
+	unsigned int bytes;
+	unsigned int elapsed_us;
 
 	_CHECK_POINTER(g_fwu);
 
+	ClockTime(CLOCK_MONOTONIC, NULL, &start);
+
 	if (g_fwu->bl_version == BL_V7 || g_fwu->bl_version == BL_V8)
 		retval = synaptics_rmi4_fwu_read_f34_v7_blocks(block_cnt, cmd);
 	else
 		retval = synaptics_rmi4_fwu_read_f34_v5v6_blocks(block_cnt, cmd);
 
+	if (retval < 0)
+		return retval;
+
+	// throughput of this phase
+	ClockTime(CLOCK_MONOTONIC, NULL, &end);
+	bytes = block_cnt * g_fwu->block_size;
+	elapsed_us = (unsigned int)((end - start) / 1000);
+
+	mtouch_info(MTOUCH_DEV, "%s: command %d, %d bytes in %d ms (%d KB/s)",
+				__FUNCTION__, cmd, bytes, elapsed_us / 1000,
+				(elapsed_us) ? (unsigned int)((uint64_t)bytes * 1000000 / 1024 / elapsed_us) : 0);
+
 	return retval;
 }
 
+/*
+ * to get the size of the configuration id of the bootloader
+ *
+ * return the size in bytes
+ */
+static unsigned char synaptics_rmi4_fwu_config_id_size(void)
+{
+	if (g_fwu->bl_version == BL_V7 || g_fwu->bl_version == BL_V8)
+		return V7_CONFIG_ID_SIZE;
+	else
+		return V5V6_CONFIG_ID_SIZE;
+}
+
 /*
  * to read the configuration id
  *
@@ -1817,10 +2471,7 @@ static int synaptics_rmi4_fwu_get_device_config_id(void)
 	_CHECK_POINTER(g_fwu);
 	_CHECK_POINTER(g_fwu->rmi4_data);
 
-	if (g_fwu->bl_version == BL_V7 || g_fwu->bl_version == BL_V8)
-		config_id_size = V7_CONFIG_ID_SIZE;
-	else
-		config_id_size = V5V6_CONFIG_ID_SIZE;
+	config_id_size = synaptics_rmi4_fwu_config_id_size();
 
 	retval = synaptics_rmi4_reg_read(g_fwu->rmi4_data,
 				g_fwu->f34->base_addr.ctrl_base,
@@ -1833,92 +2484,27 @@ static int synaptics_rmi4_fwu_get_device_config_id(void)
 }
 
 /*
- * to determine the flash area
+ * to compare a configuration id with the one read from the device
+ * the ids are compared byte by byte, the first byte is the most significant
  *
- * return EOK: complete
- * otherwise, fail
+ * const unsigned char *config_id: the configuration id of the image
+ * unsigned char size: size of the configuration id
+ *
+ * return true if the configuration id is newer than the device
  */
-static enum flash_area synaptics_rmi4_fwu_go_nogo(const unsigned int image_fw_id)
+static bool synaptics_rmi4_fwu_is_config_id_newer(const unsigned char *config_id,
+											unsigned char size)
 {
-	int retval;
-	enum flash_area flash_area = NONE;
 	unsigned char ii;
-	unsigned char config_id_size;
-	unsigned int device_fw_id;
-	struct synaptics_rmi4_data *rmi4_data;
-
-	_CHECK_POINTER(g_fwu);
-	_CHECK_POINTER(g_fwu->rmi4_data);
-
-	rmi4_data = g_fwu->rmi4_data;
 
-	if (g_fwu->force_update) {
-		flash_area = UI_FIRMWARE;
-		goto exit;
-	}
-
-	// update both UI and config if device is in bootloader mode
-	if (g_fwu->bl_mode_device) {
-		flash_area = UI_FIRMWARE;
-		goto exit;
-	}
-
-	// get device firmware ID
-	device_fw_id = rmi4_data->firmware_id;
-	mtouch_info(MTOUCH_DEV, "%s: device firmware ID = %d",
-			__FUNCTION__, device_fw_id);
-
-	// get image firmware ID
-	mtouch_info(MTOUCH_DEV, "%s: image firmware ID = %d",
-			__FUNCTION__, image_fw_id);
-
-	if (image_fw_id != device_fw_id) {
-		flash_area = UI_FIRMWARE;
-		goto exit;
-	}
-	else {
-		flash_area = NONE;
-		goto exit;
-	}
-
-	// get device config ID
-	retval = synaptics_rmi4_fwu_get_device_config_id();
-	if (retval < 0) {
-		mtouch_error(MTOUCH_DEV, "%s: fail to read device config ID", __FUNCTION__);
-		flash_area = NONE;
-		goto exit;
-	}
-
-	if (g_fwu->bl_version == BL_V7 || g_fwu->bl_version == BL_V8)
-		config_id_size = V7_CONFIG_ID_SIZE;
-	else
-		config_id_size = V5V6_CONFIG_ID_SIZE;
-
-	for (ii = 0; ii < config_id_size; ii++) {
-		if (g_fwu->img.ui_config.data[ii] > g_fwu->config_id[ii]) {
-			flash_area = UI_CONFIG;
-			goto exit;
-		}
-		else if (g_fwu->img.ui_config.data[ii] < g_fwu->config_id[ii]) {
-			flash_area = NONE;
-			goto exit;
-		}
-	}
-
-	flash_area = NONE;
-
-exit:
-	if (flash_area == NONE) {
-		mtouch_info(MTOUCH_DEV, "%s: no need to do reflash",
-				__FUNCTION__);
-	}
-	else {
-		mtouch_info(MTOUCH_DEV, "%s: updating %s",
-				__FUNCTION__,
-				flash_area == UI_FIRMWARE ? "UI firmware and Config":"UI Config only");
+	for (ii = 0; ii < size; ii++) {
+		if (config_id[ii] > g_fwu->config_id[ii])
+			return true;
+		else if (config_id[ii] < g_fwu->config_id[ii])
+			return false;
 	}
 
-	return flash_area;
+	return false;
 }
 
 /*
@@ -1936,7 +2522,7 @@ static int synaptics_rmi4_fwu_scan_pdt(void)
 	unsigned char intr_off;
 	unsigned char intr_src;
 	unsigned short addr;
-	unsigned char zero = 0x00;
+	unsigned char intr_enable = 0x00;
 	bool is_f01found = false;
 	bool is_f34found = false;
 	struct synaptics_rmi4_fn_desc rmi_fd;
@@ -2014,12 +2600,18 @@ static int synaptics_rmi4_fwu_scan_pdt(void)
         return -ENODEV;
     }
 
+	// only the flash interrupt is enabled, if the attention is routed to the update
+	if (synaptics_rmi4_fwu_attn_enabled()) {
+		synaptics_rmi4_fwu_attn_set(ATTN_FLASH);
+		intr_enable = g_fwu->intr_mask;
+	}
+
 	addr = rmi4_data->f01->base_addr.ctrl_base + 1;
 	retval = synaptics_rmi4_reg_write(rmi4_data,
 				addr,
-				&zero, 1);
+				&intr_enable, 1);
 	if (retval < 0) {
-		mtouch_error(MTOUCH_DEV, "%s: failed to disable interrupt enable bit",
+		mtouch_error(MTOUCH_DEV, "%s: failed to write interrupt enable bit",
 					__FUNCTION__);
 		return retval;
 	}
@@ -2376,7 +2968,7 @@ static int synaptics_rmi4_fwu_write_firmware(void)
 
 	firmware_block_count = g_fwu->img.ui_firmware.size / g_fwu->block_size;
 
-	return synaptics_rmi4_fwu_write_f34_blocks((unsigned char *)g_fwu->img.ui_firmware.data,
+	return synaptics_rmi4_fwu_write_f34_part(&g_fwu->img.ui_firmware,
 											firmware_block_count,
 											CMD_WRITE_FW);
 }
@@ -2562,7 +3154,7 @@ static int synaptics_rmi4_fwu_write_guest_code(void)
 
 	guest_code_block_count = g_fwu->img.guest_code.size / g_fwu->block_size;
 
-	retval = synaptics_rmi4_fwu_write_f34_blocks((unsigned char *)g_fwu->img.guest_code.data,
+	retval = synaptics_rmi4_fwu_write_f34_part(&g_fwu->img.guest_code,
 											guest_code_block_count,
 											CMD_WRITE_GUEST_CODE);
 	if (retval < 0)
@@ -2570,89 +3162,1497 @@ static int synaptics_rmi4_fwu_write_guest_code(void)
 
 	return EOK;
 }
+
 /*
- * to erase and re-program the flash memory
+ * to compute the CRC-32 of the leading bytes of a partition in the image
+ * the CRC computed while the partition was streamed is reused, otherwise the
+ * content of a compressed image is decoded in chunks of FWU_STREAM_CHUNK_SIZE
  *
- * return EOK: complete the process
+ * struct block_data *part: the content of the partition
+ * unsigned int size: number of bytes
+ * unsigned int *crc: the CRC
+ *
+ * return EOK: complete
  * otherwise, fail
  */
-static int synaptics_rmi4_fwu_do_reflash(void)
+static int synaptics_rmi4_fwu_image_part_crc(struct block_data *part, unsigned int size,
+											unsigned int *crc)
+{
+	int retval = EOK;
+	unsigned char *chunk;
+	unsigned int done;
+	unsigned int length;
+
+	if (size > part->size)
+		return -EINVAL;
+
+	if (part->data) {
+		*crc = synaptics_rmi4_fwu_crc32(0, part->data, size);
+		return EOK;
+	}
+
+	if (part->crc_size == size) {
+		*crc = part->crc;
+		return EOK;
+	}
+
+	chunk = malloc(FWU_STREAM_CHUNK_SIZE);
+	if (!chunk) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to allocate the chunk buffer", __FUNCTION__);
+		return -ENOMEM;
+	}
+
+	*crc = 0;
+	for (done = 0; done < size; done += length) {
+		length = (size - done > FWU_STREAM_CHUNK_SIZE) ? FWU_STREAM_CHUNK_SIZE : size - done;
+
+		retval = synaptics_rmi4_fwu_image_read(part->offset + done, chunk, length);
+		if (retval < 0)
+			goto exit;
+
+		*crc = synaptics_rmi4_fwu_crc32(*crc, chunk, length);
+	}
+
+	part->crc = *crc;
+	part->crc_size = size;
+
+exit:
+	free(chunk);
+
+	return retval;
+}
+
+/*
+ * to compare a configuration area of the device with the image
+ * the area is read back and compared by the CRC-32
+ *
+ * unsigned short config_area: the configuration area
+ * struct block_data *config: the configuration in the image
+ * bool *differs: true if the area differs from the image
+ *
+ * return EOK: complete
+ * otherwise, fail
+ */
+static int synaptics_rmi4_fwu_compare_configuration(unsigned short config_area,
+											struct block_data *config, bool *differs)
 {
 	int retval;
+	unsigned short block_count;
+	unsigned int size;
+	unsigned int crc_device;
+	unsigned int crc_image;
 
 	_CHECK_POINTER(g_fwu);
 
-	if (!g_fwu->new_partition_table) {
-		retval = synaptics_rmi4_fwu_check_ui_firmware_size();
+	block_count = config->size / g_fwu->block_size;
+	size = block_count * g_fwu->block_size;
+
+	g_fwu->config_area = config_area;
+
+	retval = synaptics_rmi4_fwu_allocate_read_config_buf(size);
+	if (retval < 0)
+		return retval;
+
+	retval = synaptics_rmi4_fwu_read_f34_blocks(block_count, CMD_READ_CONFIG);
+	if (retval < 0) {
+		mtouch_error(MTOUCH_DEV, "%s: fail to read config area %d", __FUNCTION__, config_area);
+		return retval;
+	}
+
+	crc_device = synaptics_rmi4_fwu_crc32(0, g_fwu->read_config_buf, size);
+
+	retval = synaptics_rmi4_fwu_image_part_crc(config, size, &crc_image);
+	if (retval < 0)
+		return retval;
+
+	mtouch_info(MTOUCH_DEV, "%s: config area %d, device crc = 0x%08x, image crc = 0x%08x",
+				__FUNCTION__, config_area, crc_device, crc_image);
+
+	*differs = (crc_device != crc_image);
+
+	return EOK;
+}
+
+/*
+ * to check whether the partitions are compared in the differential mode
+ * the partitions can be read back by the v7 and v8 bootloaders only
+ *
+ * return true if the differential reflash is available
+ */
+static bool synaptics_rmi4_fwu_is_differential(void)
+{
+	if (!g_fwu->differential)
+		return false;
+
+	return (g_fwu->bl_version == BL_V7 || g_fwu->bl_version == BL_V8);
+}
+
+/*
+ * to compare the partitions of the device with the image
+ * it is called when the ui firmware is not changed, the partitions differing
+ * from the image are recorded in g_fwu->diff_partitions
+ *
+ *    - ui config, compared by the config id first, then by the read-back crc
+ *    - display config, compared by the read-back crc
+ *    - guest code, compared by the read-back crc
+ *
+ * the caller must read the config id of the device before
+ *
+ * return EOK: complete
+ * otherwise, fail
+ */
+static int synaptics_rmi4_fwu_compare_partitions(void)
+{
+	int retval;
+	bool differs;
+	unsigned char config_id_size;
+
+	_CHECK_POINTER(g_fwu);
+
+	g_fwu->diff_partitions = 0;
+
+	retval = synaptics_rmi4_fwu_check_ui_configuration_size();
+	if (retval < 0)
+		return retval;
+
+	// ui config
+	// an older configuration id is never programmed, as in the non-differential mode
+	config_id_size = synaptics_rmi4_fwu_config_id_size();
+
+	if (g_fwu->img.ui_config.size < config_id_size) {
+		mtouch_error(MTOUCH_DEV, "%s: no config ID in the image", __FUNCTION__);
+		differs = false;
+	}
+	else if (memcmp(g_fwu->img.ui_config.data, g_fwu->config_id, config_id_size)) {
+		differs = synaptics_rmi4_fwu_is_config_id_newer(g_fwu->img.ui_config.data,
+											config_id_size);
+		if (!differs)
+			mtouch_info(MTOUCH_DEV, "%s: older ui configuration in the image, not programmed",
+						__FUNCTION__);
+	}
+	else {
+		retval = synaptics_rmi4_fwu_compare_configuration(UI_CONFIG_AREA,
+					&g_fwu->img.ui_config, &differs);
 		if (retval < 0)
 			return retval;
+	}
 
-		retval = synaptics_rmi4_fwu_check_ui_configuration_size();
+	if (differs)
+		g_fwu->diff_partitions |= (1 << JOURNAL_UI_CONFIG);
+
+	// display config
+	if (g_fwu->flash_properties.has_disp_config && g_fwu->img.contains_disp_config) {
+		retval = synaptics_rmi4_fwu_check_dp_configuration_size();
 		if (retval < 0)
 			return retval;
 
-		if (g_fwu->flash_properties.has_disp_config && g_fwu->img.contains_disp_config) {
-			retval = synaptics_rmi4_fwu_check_dp_configuration_size();
-			if (retval < 0)
-				return retval;
+		retval = synaptics_rmi4_fwu_compare_configuration(DP_CONFIG_AREA,
+					&g_fwu->img.dp_config, &differs);
+		if (retval < 0)
+			return retval;
+
+		if (differs)
+			g_fwu->diff_partitions |= (1 << JOURNAL_DP_CONFIG);
+	}
+
+	// guest code
+	if (g_fwu->has_guest_code && g_fwu->img.contains_guest_code) {
+		retval = synaptics_rmi4_fwu_check_guest_code_size();
+		if (retval < 0)
+			return retval;
+
+		retval = synaptics_rmi4_fwu_compare_configuration(GUEST_CODE_AREA,
+					&g_fwu->img.guest_code, &differs);
+		if (retval < 0)
+			return retval;
+
+		if (differs)
+			g_fwu->diff_partitions |= (1 << JOURNAL_GUEST_CODE);
+	}
+
+	mtouch_info(MTOUCH_DEV, "%s: differing partitions = 0x%02x",
+				__FUNCTION__, g_fwu->diff_partitions);
+
+	return EOK;
+}
+
+/*
+ * to re-program only the partitions differing from the image
+ * the partitions are selected by synaptics_rmi4_fwu_compare_partitions()
+ *
+ * return EOK: complete the process
+ * otherwise, fail
+ */
+static int synaptics_rmi4_fwu_do_differential_reflash(void)
+{
+	int retval;
+
+	_CHECK_POINTER(g_fwu);
+
+	// ui config
+	if (g_fwu->diff_partitions & (1 << JOURNAL_UI_CONFIG)) {
+		g_fwu->config_area = UI_CONFIG_AREA;
+		retval = synaptics_rmi4_fwu_erase_configuration();
+		if (retval < 0)
+			return retval;
+
+		retval = synaptics_rmi4_fwu_write_ui_configuration();
+		if (retval < 0)
+			return retval;
+		mtouch_info(MTOUCH_DEV, "%s: configuration programmed", __FUNCTION__);
+	}
+
+	// display config
+	if (g_fwu->diff_partitions & (1 << JOURNAL_DP_CONFIG)) {
+		g_fwu->config_area = DP_CONFIG_AREA;
+		retval = synaptics_rmi4_fwu_erase_configuration();
+		if (retval < 0)
+			return retval;
+
+		retval = synaptics_rmi4_fwu_write_dp_configuration();
+		if (retval < 0)
+			return retval;
+		mtouch_info(MTOUCH_DEV, "%s: display configuration programmed", __FUNCTION__);
+	}
+
+	// guest code
+	if (g_fwu->diff_partitions & (1 << JOURNAL_GUEST_CODE)) {
+		retval = synaptics_rmi4_fwu_erase_guest_code();
+		if (retval < 0)
+			return retval;
+
+		retval = synaptics_rmi4_fwu_write_guest_code();
+		if (retval < 0)
+			return retval;
+		mtouch_info(MTOUCH_DEV, "%s: guest code programmed", __FUNCTION__);
+	}
+
+	return EOK;
+}
+
+/*
+ * to determine the flash area
+ *
+ * in the differential mode, the partitions are compared with the device while
+ * the ui firmware is not changed, and only the differing ones are programmed
+ *
+ * return the flash area
+ */
+static enum flash_area synaptics_rmi4_fwu_go_nogo(const unsigned int image_fw_id)
+{
+	int retval;
+	enum flash_area flash_area = NONE;
+	unsigned char config_id_size;
+	unsigned int device_fw_id;
+	struct synaptics_rmi4_data *rmi4_data;
+
+	_CHECK_POINTER(g_fwu);
+	_CHECK_POINTER(g_fwu->rmi4_data);
+
+	rmi4_data = g_fwu->rmi4_data;
+
+	g_fwu->diff_partitions = 0;
+
+	if (g_fwu->force_update) {
+		flash_area = UI_FIRMWARE;
+		goto exit;
+	}
+
+	// update both UI and config if device is in bootloader mode
+	if (g_fwu->bl_mode_device) {
+		flash_area = UI_FIRMWARE;
+		goto exit;
+	}
+
+	// get device firmware ID
+	device_fw_id = rmi4_data->firmware_id;
+	mtouch_info(MTOUCH_DEV, "%s: device firmware ID = %d",
+			__FUNCTION__, device_fw_id);
+
+	// get image firmware ID
+	mtouch_info(MTOUCH_DEV, "%s: image firmware ID = %d",
+			__FUNCTION__, image_fw_id);
+
+	if (image_fw_id != device_fw_id) {
+		flash_area = UI_FIRMWARE;
+		goto exit;
+	}
+
+	// the firmware matches, only the configuration may be updated
+	// get device config ID
+	retval = synaptics_rmi4_fwu_get_device_config_id();
+	if (retval < 0) {
+		mtouch_error(MTOUCH_DEV, "%s: fail to read device config ID", __FUNCTION__);
+		flash_area = NONE;
+		goto exit;
+	}
+
+	if (synaptics_rmi4_fwu_is_differential() && !g_fwu->new_partition_table) {
+		retval = synaptics_rmi4_fwu_compare_partitions();
+		if (retval < 0) {
+			mtouch_error(MTOUCH_DEV, "%s: fail to compare the partitions", __FUNCTION__);
+			flash_area = NONE;
+			goto exit;
 		}
 
-		if (g_fwu->has_guest_code && g_fwu->img.contains_guest_code) {
-			retval = synaptics_rmi4_fwu_check_guest_code_size();
-			if (retval < 0)
-				return retval;
-		}
-	} else if (g_fwu->bl_version == BL_V7) {
-		retval = synaptics_rmi4_fwu_check_bl_configuration_size();
-		if (retval < 0)
-			return retval;
+		flash_area = (g_fwu->diff_partitions) ? UI_PARTITIONS : NONE;
+		goto exit;
+	}
+
+	config_id_size = synaptics_rmi4_fwu_config_id_size();
+	if (g_fwu->img.ui_config.size < config_id_size) {
+		mtouch_error(MTOUCH_DEV, "%s: no config ID in the image", __FUNCTION__);
+		flash_area = NONE;
+		goto exit;
+	}
+
+	if (synaptics_rmi4_fwu_is_config_id_newer(g_fwu->img.ui_config.data, config_id_size))
+		flash_area = UI_CONFIG;
+	else
+		flash_area = NONE;
+
+exit:
+	if (flash_area == NONE) {
+		mtouch_info(MTOUCH_DEV, "%s: no need to do reflash",
+				__FUNCTION__);
+	}
+	else {
+		mtouch_info(MTOUCH_DEV, "%s: updating %s",
+				__FUNCTION__,
+				flash_area == UI_FIRMWARE ? "UI firmware and Config" :
+				flash_area == UI_CONFIG ? "UI Config only" : "differing partitions only");
+	}
+
+	return flash_area;
+}
+
+/*
+ * helper function to compute the checksum of the journal
+ *
+ * const struct synaptics_rmi4_fwu_journal *journal: the journal
+ *
+ * return the checksum
+ */
+static unsigned int synaptics_rmi4_fwu_journal_checksum(const struct synaptics_rmi4_fwu_journal *journal)
+{
+	return synaptics_rmi4_fwu_crc32(0, (const unsigned char *)journal,
+				offsetof(struct synaptics_rmi4_fwu_journal, checksum));
+}
+
+/*
+ * to sync the directory of the journal
+ * the rename and the removal of the journal are durable only once the
+ * directory entry is written
+ *
+ * return void
+ */
+static void synaptics_rmi4_fwu_journal_sync_dir(void)
+{
+	int fd;
+	char *slash;
+	char dir_path[PATH_MAX];
+
+	snprintf(dir_path, sizeof(dir_path), "%s", fwu_journal_path);
+
+	slash = strrchr(dir_path, '/');
+	if (!slash)
+		snprintf(dir_path, sizeof(dir_path), ".");
+	else if (slash == dir_path)
+		slash[1] = '\0';
+	else
+		slash[0] = '\0';
+
+	fd = open(dir_path, O_RDONLY);
+	if (fd < 0) {
+		mtouch_warn(MTOUCH_DEV, "%s: failed to open %s", __FUNCTION__, dir_path);
+		return;
+	}
+
+	if (fsync(fd) != 0)
+		mtouch_warn(MTOUCH_DEV, "%s: failed to sync %s", __FUNCTION__, dir_path);
+
+	close(fd);
+}
+
+/*
+ * save the journal to the file
+ * the file is synced before it replaces the previous one, and the directory
+ * after, so a power loss leaves either the previous or the new journal
+ *
+ * return void
+ */
+static void synaptics_rmi4_fwu_journal_save(void)
+{
+	FILE *fp;
+	size_t size;
+	int retval;
+	char tmp_path[PATH_MAX];
+
+	if ('\0' == fwu_journal_path[0])
+		return;
+
+	g_fwu->journal.checksum = synaptics_rmi4_fwu_journal_checksum(&g_fwu->journal);
+
+	snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", fwu_journal_path);
+
+	fp = fopen(tmp_path, "wb");
+	if (!fp) {
+		mtouch_warn(MTOUCH_DEV, "%s: failed to create %s", __FUNCTION__, tmp_path);
+		return;
+	}
+
+	size = fwrite(&g_fwu->journal, 1, sizeof(struct synaptics_rmi4_fwu_journal), fp);
+	fflush(fp);
+	retval = fsync(fileno(fp));
+	fclose(fp);
+
+	if ((size != sizeof(struct synaptics_rmi4_fwu_journal)) || (retval != 0) ||
+		(rename(tmp_path, fwu_journal_path) != 0)) {
+		mtouch_warn(MTOUCH_DEV, "%s: failed to save %s", __FUNCTION__, fwu_journal_path);
+		unlink(tmp_path);
+		return;
+	}
+
+	synaptics_rmi4_fwu_journal_sync_dir();
+}
+
+/*
+ * to compute the CRC-32 of the image file, which identifies the image in the journal
+ * a compressed file is read in chunks of FWU_STREAM_CHUNK_SIZE, it is not decoded
+ *
+ * return the CRC
+ */
+static unsigned int synaptics_rmi4_fwu_image_file_crc(void)
+{
+	unsigned char *chunk;
+	unsigned int crc = 0;
+	int done;
+	ssize_t length;
+
+	if (!g_fwu->stream)
+		return synaptics_rmi4_fwu_crc32(0, g_fwu->image, g_fwu->image_file_size);
+
+	chunk = malloc(FWU_STREAM_CHUNK_SIZE);
+	if (!chunk) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to allocate the chunk buffer", __FUNCTION__);
+		return 0;
+	}
+
+	for (done = 0; done < g_fwu->image_file_size; done += length) {
+		length = pread(g_fwu->stream->fd, chunk, FWU_STREAM_CHUNK_SIZE, done);
+		if (length <= 0) {
+			mtouch_error(MTOUCH_DEV, "%s: failed to read the image file", __FUNCTION__);
+			crc = 0;
+			break;
+		}
+
+		crc = synaptics_rmi4_fwu_crc32(crc, chunk, (unsigned int)length);
+	}
+
+	free(chunk);
+
+	return crc;
+}
+
+/*
+ * start the journal of a full reflash, nothing is completed yet
+ *
+ * return void
+ */
+static void synaptics_rmi4_fwu_journal_begin(void)
+{
+	if ('\0' == fwu_journal_path[0])
+		return;
+
+	memset(&g_fwu->journal, 0x00, sizeof(g_fwu->journal));
+
+	g_fwu->journal.magic = FWU_JOURNAL_MAGIC;
+	g_fwu->journal.version = FWU_JOURNAL_VERSION;
+	g_fwu->journal.image_size = g_fwu->image_file_size;
+	g_fwu->journal.image_crc = synaptics_rmi4_fwu_image_file_crc();
+	g_fwu->journal.bl_version = g_fwu->bl_version;
+
+	synaptics_rmi4_fwu_journal_save();
+}
+
+/*
+ * record a completed phase of the reflash
+ *
+ * enum fwu_journal_phase phase: the completed phase
+ *
+ * return void
+ */
+static void synaptics_rmi4_fwu_journal_mark(enum fwu_journal_phase phase)
+{
+	if ('\0' == fwu_journal_path[0])
+		return;
+
+	g_fwu->journal.completed |= (1 << phase);
+
+	synaptics_rmi4_fwu_journal_save();
+}
+
+/*
+ * check whether a phase is completed in the journal
+ *
+ * enum fwu_journal_phase phase: the phase
+ *
+ * return true if the phase is completed
+ */
+static bool synaptics_rmi4_fwu_journal_done(enum fwu_journal_phase phase)
+{
+	return (g_fwu->journal.completed & (1 << phase)) != 0;
+}
+
+/*
+ * to drop the phases checked by the verify from the journal
+ * it is called when the verify fails, so the resumed reflash programs them again
+ *
+ * return void
+ */
+static void synaptics_rmi4_fwu_journal_reopen(void)
+{
+	if ('\0' == fwu_journal_path[0])
+		return;
+
+	// no journal for the configuration only or the differential reflash
+	if (g_fwu->journal.magic != FWU_JOURNAL_MAGIC)
+		return;
+
+	g_fwu->journal.completed &= ~((1 << JOURNAL_DP_CONFIG) |
+								(1 << JOURNAL_UI_CONFIG) |
+								(1 << JOURNAL_GUEST_CODE));
+
+	synaptics_rmi4_fwu_journal_save();
+}
+
+/*
+ * remove the journal once the reflash is complete
+ *
+ * return void
+ */
+static void synaptics_rmi4_fwu_journal_clear(void)
+{
+	if ('\0' == fwu_journal_path[0])
+		return;
+
+	memset(&g_fwu->journal, 0x00, sizeof(g_fwu->journal));
+
+	if (unlink(fwu_journal_path) != 0) {
+		if (errno != ENOENT)
+			mtouch_warn(MTOUCH_DEV, "%s: failed to remove %s", __FUNCTION__, fwu_journal_path);
+		return;
+	}
+
+	synaptics_rmi4_fwu_journal_sync_dir();
+}
+
+/*
+ * load the journal and check whether the interrupted reflash can be resumed
+ *
+ *    - the journal belongs to the same image
+ *    - the device stays in the bootloader mode
+ *    - the bootloader erases the partitions one by one, bootloader 7 and 8
+ *    - the flash was erased, and the partition table was programmed if required
+ *
+ * return true if the reflash is resumed from the journal
+ */
+static bool synaptics_rmi4_fwu_journal_resumable(void)
+{
+	FILE *fp;
+	size_t size;
+	struct synaptics_rmi4_fwu_journal journal;
+
+	if ('\0' == fwu_journal_path[0])
+		return false;
+
+	if (!g_fwu->bl_mode_device)
+		return false;
+
+	if ((g_fwu->bl_version != BL_V7) && (g_fwu->bl_version != BL_V8))
+		return false;
+
+	fp = fopen(fwu_journal_path, "rb");
+	if (!fp)
+		return false;
+
+	size = fread(&journal, 1, sizeof(journal), fp);
+	fclose(fp);
+
+	if ((size != sizeof(journal)) ||
+		(journal.magic != FWU_JOURNAL_MAGIC) ||
+		(journal.version != FWU_JOURNAL_VERSION) ||
+		(journal.checksum != synaptics_rmi4_fwu_journal_checksum(&journal))) {
+		mtouch_warn(MTOUCH_DEV, "%s: invalid journal in %s", __FUNCTION__, fwu_journal_path);
+		return false;
+	}
+
+	if ((journal.image_size != (unsigned int)g_fwu->image_file_size) ||
+		(journal.bl_version != g_fwu->bl_version) ||
+		(journal.image_crc != synaptics_rmi4_fwu_image_file_crc())) {
+		mtouch_info(MTOUCH_DEV, "%s: the journal belongs to another image", __FUNCTION__);
+		return false;
+	}
+
+	if (!(journal.completed & (1 << JOURNAL_ERASE)))
+		return false;
+
+	if (((g_fwu->bl_version == BL_V8) || (g_fwu->new_partition_table)) &&
+		(!(journal.completed & (1 << JOURNAL_PARTITION_TABLE))))
+		return false;
+
+	g_fwu->journal = journal;
+
+	return true;
+}
+
+/*
+ * to resume the reflash interrupted after the erase
+ * the partitions completed in the journal are skipped, the others are erased
+ * one by one since they may be partially programmed, and programmed again
+ *
+ * return EOK: complete the process
+ * otherwise, fail
+ */
+static int synaptics_rmi4_fwu_do_resumed_reflash(void)
+{
+	int retval;
+
+	_CHECK_POINTER(g_fwu);
+
+	mtouch_info(MTOUCH_DEV, "%s: resume the reflash, completed phases 0x%x",
+				__FUNCTION__, g_fwu->journal.completed);
+
+	retval = synaptics_rmi4_fwu_check_ui_firmware_size();
+	if (retval < 0)
+		return retval;
+
+	retval = synaptics_rmi4_fwu_check_ui_configuration_size();
+	if (retval < 0)
+		return retval;
+
+	// ui firmware
+	if (!synaptics_rmi4_fwu_journal_done(JOURNAL_UI_FIRMWARE)) {
+		retval = synaptics_rmi4_fwu_write_f34_command(CMD_ERASE_UI_FIRMWARE);
+		if (retval < 0)
+			return retval;
+
+		retval = synaptics_rmi4_fwu_wait_for_idle(ERASE_WAIT_MS, false);
+		if (retval < 0)
+			return retval;
+
+		retval = synaptics_rmi4_fwu_write_firmware();
+		if (retval < 0)
+			return retval;
+		mtouch_info(MTOUCH_DEV, "%s: firmware programmed", __FUNCTION__);
+
+		synaptics_rmi4_fwu_journal_mark(JOURNAL_UI_FIRMWARE);
+	}
+
+	// display config
+	if (g_fwu->flash_properties.has_disp_config && g_fwu->img.contains_disp_config &&
+		!synaptics_rmi4_fwu_journal_done(JOURNAL_DP_CONFIG)) {
+		retval = synaptics_rmi4_fwu_check_dp_configuration_size();
+		if (retval < 0)
+			return retval;
+
+		g_fwu->config_area = DP_CONFIG_AREA;
+		retval = synaptics_rmi4_fwu_erase_configuration();
+		if (retval < 0)
+			return retval;
+
+		retval = synaptics_rmi4_fwu_write_dp_configuration();
+		if (retval < 0)
+			return retval;
+		mtouch_info(MTOUCH_DEV, "%s: display configuration programmed", __FUNCTION__);
+
+		synaptics_rmi4_fwu_journal_mark(JOURNAL_DP_CONFIG);
+	}
+
+	// ui config
+	if (!synaptics_rmi4_fwu_journal_done(JOURNAL_UI_CONFIG)) {
+		g_fwu->config_area = UI_CONFIG_AREA;
+		retval = synaptics_rmi4_fwu_erase_configuration();
+		if (retval < 0)
+			return retval;
+
+		retval = synaptics_rmi4_fwu_write_ui_configuration();
+		if (retval < 0)
+			return retval;
+		mtouch_info(MTOUCH_DEV, "%s: configuration programmed", __FUNCTION__);
+
+		synaptics_rmi4_fwu_journal_mark(JOURNAL_UI_CONFIG);
+	}
+
+	// guest code
+	if (g_fwu->has_guest_code && g_fwu->img.contains_guest_code &&
+		!synaptics_rmi4_fwu_journal_done(JOURNAL_GUEST_CODE)) {
+		retval = synaptics_rmi4_fwu_check_guest_code_size();
+		if (retval < 0)
+			return retval;
+
+		retval = synaptics_rmi4_fwu_erase_guest_code();
+		if (retval < 0)
+			return retval;
+
+		retval = synaptics_rmi4_fwu_write_guest_code();
+		if (retval < 0)
+			return retval;
+		mtouch_info(MTOUCH_DEV, "%s: guest code programmed", __FUNCTION__);
+
+		synaptics_rmi4_fwu_journal_mark(JOURNAL_GUEST_CODE);
+	}
+
+	return EOK;
+}
+
+/*
+ * to erase and re-program the flash memory
+ *
+ * return EOK: complete the process
+ * otherwise, fail
+ */
+static int synaptics_rmi4_fwu_do_reflash(void)
+{
+	int retval;
+
+	_CHECK_POINTER(g_fwu);
+
+	if (synaptics_rmi4_fwu_journal_resumable())
+		return synaptics_rmi4_fwu_do_resumed_reflash();
+
+	if (!g_fwu->new_partition_table) {
+		retval = synaptics_rmi4_fwu_check_ui_firmware_size();
+		if (retval < 0)
+			return retval;
+
+		retval = synaptics_rmi4_fwu_check_ui_configuration_size();
+		if (retval < 0)
+			return retval;
+
+		if (g_fwu->flash_properties.has_disp_config && g_fwu->img.contains_disp_config) {
+			retval = synaptics_rmi4_fwu_check_dp_configuration_size();
+			if (retval < 0)
+				return retval;
+		}
+
+		if (g_fwu->has_guest_code && g_fwu->img.contains_guest_code) {
+			retval = synaptics_rmi4_fwu_check_guest_code_size();
+			if (retval < 0)
+				return retval;
+		}
+	} else if (g_fwu->bl_version == BL_V7) {
+		retval = synaptics_rmi4_fwu_check_bl_configuration_size();
+		if (retval < 0)
+			return retval;
+	}
+
+	synaptics_rmi4_fwu_journal_begin();
+
+	retval = synaptics_rmi4_fwu_erase_all();
+	if (retval < 0) {
+		mtouch_error(MTOUCH_DEV, "%s: fail to do erase command", __FUNCTION__);
+		return retval;
+	}
+	mtouch_info(MTOUCH_DEV, "%s: erase completed", __FUNCTION__);
+
+	synaptics_rmi4_fwu_journal_mark(JOURNAL_ERASE);
+
+	if (g_fwu->bl_version == BL_V7 && g_fwu->new_partition_table) {
+		retval = synaptics_rmi4_fwu_write_partition_table_v7();
+		if (retval < 0)
+			return retval;
+		mtouch_info(MTOUCH_DEV, "%s: partition table programmed", __FUNCTION__);
+
+		synaptics_rmi4_fwu_journal_mark(JOURNAL_PARTITION_TABLE);
+	} else if (g_fwu->bl_version == BL_V8) {
+		retval = synaptics_rmi4_fwu_write_partition_table_v8();
+		if (retval < 0)
+			return retval;
+		mtouch_info(MTOUCH_DEV, "%s: partition table programmed", __FUNCTION__);
+
+		synaptics_rmi4_fwu_journal_mark(JOURNAL_PARTITION_TABLE);
+	}
+
+	retval = synaptics_rmi4_fwu_write_firmware();
+	if (retval < 0)
+		return retval;
+	mtouch_info(MTOUCH_DEV, "%s: firmware programmed", __FUNCTION__);
+
+	synaptics_rmi4_fwu_journal_mark(JOURNAL_UI_FIRMWARE);
+
+	g_fwu->config_area = UI_CONFIG_AREA;
+	if (g_fwu->flash_properties.has_disp_config && g_fwu->img.contains_disp_config) {
+		retval = synaptics_rmi4_fwu_write_dp_configuration();
+		if (retval < 0)
+			return retval;
+		mtouch_info(MTOUCH_DEV, "%s: display configuration programmed", __FUNCTION__);
+
+		synaptics_rmi4_fwu_journal_mark(JOURNAL_DP_CONFIG);
+	}
+
+	retval = synaptics_rmi4_fwu_write_ui_configuration();
+	if (retval < 0)
+		return retval;
+	mtouch_info(MTOUCH_DEV, "%s: configuration programmed", __FUNCTION__);
+
+	synaptics_rmi4_fwu_journal_mark(JOURNAL_UI_CONFIG);
+
+	if (g_fwu->has_guest_code && g_fwu->img.contains_guest_code) {
+		retval = synaptics_rmi4_fwu_write_guest_code();
+		if (retval < 0)
+			return retval;
+		mtouch_info(MTOUCH_DEV, "%s: guest code programmed", __FUNCTION__);
+
+		synaptics_rmi4_fwu_journal_mark(JOURNAL_GUEST_CODE);
+	}
+
+	return retval;
+}
+
+/*
+ * to verify the programmed partitions by reading them back
+ * the configuration areas and the guest code are compared with the image by
+ * the CRC-32, the ui firmware can not be read back, and is checked by the
+ * bootloader with its own CRC at the reset
+ *
+ * return EOK: the partitions match the image
+ * otherwise, fail
+ */
+static int synaptics_rmi4_fwu_verify_reflash(void)
+{
+	int retval;
+	bool differs;
+	unsigned int bytes = 0;
+	uint64_t start;
+	uint64_t end;
+
+	_CHECK_POINTER(g_fwu);
+
+	ClockTime(CLOCK_MONOTONIC, NULL, &start);
+
+	retval = synaptics_rmi4_fwu_compare_configuration(UI_CONFIG_AREA,
+				&g_fwu->img.ui_config, &differs);
+	if (retval < 0)
+		return retval;
+	if (differs) {
+		mtouch_error(MTOUCH_DEV, "%s: ui configuration mismatch", __FUNCTION__);
+		return -EIO;
+	}
+	bytes += g_fwu->img.ui_config.size;
+
+	if (g_fwu->flash_properties.has_disp_config && g_fwu->img.contains_disp_config) {
+		retval = synaptics_rmi4_fwu_compare_configuration(DP_CONFIG_AREA,
+					&g_fwu->img.dp_config, &differs);
+		if (retval < 0)
+			return retval;
+		if (differs) {
+			mtouch_error(MTOUCH_DEV, "%s: display configuration mismatch", __FUNCTION__);
+			return -EIO;
+		}
+		bytes += g_fwu->img.dp_config.size;
+	}
+
+	if ((g_fwu->bl_version == BL_V7 || g_fwu->bl_version == BL_V8) &&
+		g_fwu->has_guest_code && g_fwu->img.contains_guest_code) {
+		retval = synaptics_rmi4_fwu_compare_configuration(GUEST_CODE_AREA,
+					&g_fwu->img.guest_code, &differs);
+		if (retval < 0)
+			return retval;
+		if (differs) {
+			mtouch_error(MTOUCH_DEV, "%s: guest code mismatch", __FUNCTION__);
+			return -EIO;
+		}
+		bytes += g_fwu->img.guest_code.size;
+	}
+
+	ClockTime(CLOCK_MONOTONIC, NULL, &end);
+
+	mtouch_info(MTOUCH_DEV, "%s: %d bytes verified in %d ms", __FUNCTION__,
+				bytes, (unsigned int)((end - start) / 1000000));
+
+	return EOK;
+}
+
+/*
+ * open the compressed image file as a stream
+ * nothing is decoded here, the containers are decoded when they are read, and
+ * only the window of the matches and one block of the frame are kept in memory
+ *
+ * int fd: the image file, it is owned by the stream once opened
+ * const struct synaptics_rmi4_lz4_frame *frame: the frame descriptor
+ *
+ * return EOK: complete the process
+ * otherwise, fail
+ */
+static int synaptics_rmi4_fwu_open_compressed_image(int fd,
+											const struct synaptics_rmi4_lz4_frame *frame)
+{
+	if ((frame->content_size < sizeof(struct image_header_10)) ||
+		(frame->content_size > INT_MAX)) {
+		mtouch_error(MTOUCH_DEV, "%s: invalid content size %llu", __FUNCTION__,
+					(unsigned long long)frame->content_size);
+		return -EINVAL;
+	}
+
+	g_fwu->stream = synaptics_rmi4_lz4_stream_create(fd, frame);
+	if (!g_fwu->stream) {
+		mtouch_error(MTOUCH_DEV, "%s: fail to open the stream of %s", __FUNCTION__, g_fwu->image_name);
+		return -ENOMEM;
+	}
+
+	g_fwu->image_size = (unsigned int)frame->content_size;
+
+	mtouch_info(MTOUCH_DEV, "%s: %u bytes compressed, block maximum size %zu",
+				__FUNCTION__, g_fwu->image_size, frame->block_max);
+
+	return EOK;
+}
+
+/*
+ * map the target image file read-only and store in g_fwu->image
+ * the parsers work directly on the mapping, there is no copy of the image
+ * a LZ4 frame is opened as a stream in g_fwu->stream instead
+ *
+ * const char *path_fw_image: the path of the image file
+ *
+ * return EOK: complete the process
+ * otherwise, fail
+ */
+static int synaptics_rmi4_fwu_load_image(const char *path_fw_image)
+{
+	int retval = EOK;
+	int fd;
+	struct stat st;
+	struct synaptics_rmi4_lz4_frame frame;
+	void *image;
+
+	_CHECK_POINTER(g_fwu);
+
+	sprintf(g_fwu->image_name, "%s", path_fw_image);
+
+	mtouch_info(MTOUCH_DEV, "%s: fw image file: %s", __FUNCTION__, g_fwu->image_name);
+
+	if (strlen(g_fwu->image_name) <= 0) {
+		mtouch_error(MTOUCH_DEV, "%s: invalid path of image file", __FUNCTION__);
+		return -EINVAL;
+	}
+
+	fd = open(g_fwu->image_name, O_RDONLY);
+	if (fd == -1) {
+		mtouch_error(MTOUCH_DEV, "%s: image file %s not found", __FUNCTION__, g_fwu->image_name);
+		return -EINVAL;
+	}
+
+	if ((fstat(fd, &st) == -1) || (st.st_size <= 0) || (st.st_size > INT_MAX)) {
+		mtouch_error(MTOUCH_DEV, "%s: fail to determine size of %s", __FUNCTION__, g_fwu->image_name);
+		retval = -EIO;
+		goto exit;
+	}
+
+	retval = synaptics_rmi4_lz4_read_frame(fd, &frame);
+	if (retval < 0) {
+		mtouch_error(MTOUCH_DEV, "%s: unsupported compressed image %s", __FUNCTION__, g_fwu->image_name);
+		goto exit;
+	}
+	if (retval > 0) {
+		retval = synaptics_rmi4_fwu_open_compressed_image(fd, &frame);
+		if (retval < 0)
+			goto exit;
+
+		// the stream keeps the file open until the image is released
+		g_fwu->image_file_size = st.st_size;
+		return EOK;
+	}
+
+	if (st.st_size < (off_t)sizeof(struct image_header_10)) {
+		mtouch_error(MTOUCH_DEV, "%s: image file %s is truncated", __FUNCTION__, g_fwu->image_name);
+		retval = -EINVAL;
+		goto exit;
+	}
+
+	image = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (image == MAP_FAILED) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to map %s (error: %s)",
+					__FUNCTION__, g_fwu->image_name, strerror(errno));
+		retval = -ENOMEM;
+		goto exit;
+	}
+
+	g_fwu->image = image;
+	g_fwu->image_file_size = st.st_size;
+	g_fwu->image_size = st.st_size;
+
+exit:
+	// the mapping stays valid after the file is closed
+	close(fd);
+
+	return retval;
+}
+
+/*
+ * unmap the target image file, or close the stream of a compressed one
+ * the memory goes back to the system as soon as the update ends
+ *
+ * return void
+ */
+static void synaptics_rmi4_fwu_release_image(void)
+{
+	synaptics_rmi4_fwu_image_parts_free();
+
+	if (g_fwu->image) {
+		munmap((void *)g_fwu->image, g_fwu->image_file_size);
+		g_fwu->image = NULL;
+	}
+
+	if (g_fwu->stream) {
+		close(g_fwu->stream->fd);
+		synaptics_rmi4_lz4_stream_destroy(g_fwu->stream);
+		g_fwu->stream = NULL;
+	}
+
+	g_fwu->image_file_size = 0;
+	g_fwu->image_size = 0;
+}
+
+/*
+ * helper function to read a part of the image file
+ * a compressed image is decoded up to the part
+ *
+ * int fd: the image file
+ * struct synaptics_rmi4_lz4_stream *stream: the stream of a compressed image, or NULL
+ * unsigned int offset: offset in the image
+ * void *buf: buffer to store the data
+ * size_t size: number of bytes to read
+ *
+ * return EOK: complete
+ * otherwise, fail
+ */
+static int synaptics_rmi4_fwu_probe_read(int fd, struct synaptics_rmi4_lz4_stream *stream,
+											unsigned int offset, void *buf, size_t size)
+{
+	if (stream)
+		return synaptics_rmi4_lz4_stream_read(stream, offset, buf, size);
+
+	if (pread(fd, buf, size, offset) != (ssize_t)size)
+		return -EIO;
+
+	return EOK;
+}
+
+/*
+ * to probe the image file with the header format 10
+ * walk the container directory and read only the containers with the versions
+ *
+ * int fd: the image file
+ * struct synaptics_rmi4_lz4_stream *stream: the stream of a compressed image, or NULL
+ * const unsigned char *header: the header read from the image file
+ * struct image_probe *probe: the versions of the image
+ *
+ * return EOK: complete
+ * otherwise, fail
+ */
+static int synaptics_rmi4_fwu_probe_image_10(int fd, struct synaptics_rmi4_lz4_stream *stream,
+											const unsigned char *header, struct image_probe *probe)
+{
+	unsigned int ii;
+	unsigned int num_of_containers;
+	unsigned int directory;
+	unsigned int content;
+	unsigned int container_id;
+	unsigned char addr[4];
+	unsigned char data[4];
+	struct container_descriptor descriptor;
+
+	// top level container
+	if (synaptics_rmi4_fwu_probe_read(fd, stream,
+			le_to_uint(((struct image_header_10 *)header)->top_level_container_start_addr),
+			&descriptor, sizeof(descriptor)) < 0)
+		return -EIO;
+
+	directory = le_to_uint(descriptor.content_address);
+	num_of_containers = (le_to_uint(descriptor.content_length) / 4) & MASK_8BIT;
+
+	for (ii = 0; ii < num_of_containers; ii++) {
+		if (synaptics_rmi4_fwu_probe_read(fd, stream, directory + ii * 4, addr, sizeof(addr)) < 0)
+			return -EIO;
+
+		if (synaptics_rmi4_fwu_probe_read(fd, stream, le_to_uint(addr), &descriptor, sizeof(descriptor)) < 0)
+			return -EIO;
+
+		container_id = descriptor.container_id[0] | descriptor.container_id[1] << 8;
+		content = le_to_uint(descriptor.content_address);
+
+		switch (container_id) {
+		case BL_CONTAINER:
+			if (synaptics_rmi4_fwu_probe_read(fd, stream, content, &probe->bl_version, 1) < 0)
+				return -EIO;
+			break;
+		case GENERAL_INFORMATION_CONTAINER:
+			if (synaptics_rmi4_fwu_probe_read(fd, stream, content + 4, data, sizeof(data)) < 0)
+				return -EIO;
+			probe->firmware_id = le_to_uint(data);
+			probe->contains_firmware_id = true;
+			break;
+		case UI_CONFIG_CONTAINER:
+		case CORE_CONFIG_CONTAINER:
+			if (synaptics_rmi4_fwu_probe_read(fd, stream, content, probe->config_id, V7_CONFIG_ID_SIZE) < 0)
+				return -EIO;
+			probe->config_id_size = V7_CONFIG_ID_SIZE;
+			probe->contains_config_id = true;
+			break;
+		default:
+			break;
+		}
+	}
+
+	return EOK;
+}
+
+/*
+ * to probe the image file with the header format 05 and 06
+ * the config ID is at the beginning of the ui config, following the ui firmware
+ *
+ * int fd: the image file
+ * struct synaptics_rmi4_lz4_stream *stream: the stream of a compressed image, or NULL
+ * const unsigned char *header: the header read from the image file
+ * struct image_probe *probe: the versions of the image
+ *
+ * return EOK: complete
+ * otherwise, fail
+ */
+static int synaptics_rmi4_fwu_probe_image_05_06(int fd, struct synaptics_rmi4_lz4_stream *stream,
+											const unsigned char *header, struct image_probe *probe)
+{
+	unsigned int offset;
+	const struct image_header_05_06 *header_05_06 = (const struct image_header_05_06 *)header;
+
+	probe->bl_version = header_05_06->header_version;
+
+	probe->contains_firmware_id = header_05_06->options_firmware_id;
+	if (probe->contains_firmware_id)
+		probe->firmware_id = le_to_uint(header_05_06->firmware_id);
+
+	if (0 == le_to_uint(header_05_06->config_size))
+		return EOK;
+
+	offset = IMAGE_AREA_OFFSET;
+	if (header_05_06->options_bootloader)
+		offset += le_to_uint(header_05_06->bootloader_size);
+	if ((probe->bl_version == BL_V6) && header_05_06->options_tddi)
+		offset = IMAGE_AREA_OFFSET;
+	offset += le_to_uint(header_05_06->firmware_size);
+
+	if (synaptics_rmi4_fwu_probe_read(fd, stream, offset, probe->config_id, V5V6_CONFIG_ID_SIZE) < 0)
+		return -EIO;
+	probe->config_id_size = V5V6_CONFIG_ID_SIZE;
+	probe->contains_config_id = true;
+
+	return EOK;
+}
+
+/*
+ * to read the versions of the image file without loading it
+ * only the header and the container directory are read, a compressed image is
+ * decoded only up to the parts read
+ *
+ * const char *path_fw_image: the path of the image file
+ * struct image_probe *probe: the versions of the image
+ *
+ * return EOK: complete
+ * otherwise, fail
+ */
+static int synaptics_rmi4_fwu_probe_image(const char *path_fw_image, struct image_probe *probe)
+{
+	int retval;
+	int fd;
+	size_t size;
+	unsigned char header[sizeof(struct image_header_05_06)];
+	struct synaptics_rmi4_lz4_frame frame;
+	struct synaptics_rmi4_lz4_stream *stream = NULL;
+
+	memset(probe, 0x00, sizeof(struct image_probe));
+
+	if ((!path_fw_image) || (strlen(path_fw_image) <= 0)) {
+		mtouch_error(MTOUCH_DEV, "%s: invalid path of image file", __FUNCTION__);
+		return -EINVAL;
+	}
+
+	fd = open(path_fw_image, O_RDONLY);
+	if (fd == -1) {
+		mtouch_error(MTOUCH_DEV, "%s: image file %s not found", __FUNCTION__, path_fw_image);
+		return -EINVAL;
+	}
+
+	memset(header, 0x00, sizeof(header));
+
+	// only the leading blocks of a compressed image are decoded for the header and the containers
+	if (synaptics_rmi4_lz4_read_frame(fd, &frame) > 0) {
+		probe->compressed = true;
+
+		if (frame.content_size < sizeof(struct image_header_10)) {
+			mtouch_error(MTOUCH_DEV, "%s: invalid content size of %s", __FUNCTION__, path_fw_image);
+			retval = -EINVAL;
+			goto exit;
+		}
+
+		stream = synaptics_rmi4_lz4_stream_create(fd, &frame);
+		if (!stream) {
+			retval = -ENOMEM;
+			goto exit;
+		}
+
+		size = (frame.content_size < sizeof(header)) ? (size_t)frame.content_size : sizeof(header);
+		retval = synaptics_rmi4_lz4_stream_read(stream, 0, header, size);
+	}
+	else if (pread(fd, header, sizeof(header), 0) < (ssize_t)sizeof(struct image_header_10)) {
+		retval = -EIO;
+	}
+	else
+		retval = EOK;
+
+	if (retval < 0) {
+		mtouch_error(MTOUCH_DEV, "%s: fail to read the header of %s", __FUNCTION__, path_fw_image);
+		goto exit;
+	}
+
+	switch (((struct image_header_10 *)header)->major_header_version) {
+	case IMAGE_HEADER_VERSION_05:
+	case IMAGE_HEADER_VERSION_06:
+		retval = synaptics_rmi4_fwu_probe_image_05_06(fd, stream, header, probe);
+		break;
+	case IMAGE_HEADER_VERSION_10:
+		retval = synaptics_rmi4_fwu_probe_image_10(fd, stream, header, probe);
+		break;
+	default:
+		mtouch_error(MTOUCH_DEV, "%s: unsupported image file format (0x%02x)",
+					__FUNCTION__, ((struct image_header_10 *)header)->major_header_version);
+		retval = -ENODEV;
+		break;
+	}
+
+	if (retval < 0)
+		mtouch_error(MTOUCH_DEV, "%s: fail to probe %s", __FUNCTION__, path_fw_image);
+
+exit:
+	if (stream)
+		synaptics_rmi4_lz4_stream_destroy(stream);
+
+	close(fd);
+
+	return retval;
+}
+
+/*
+ * parse the image loaded and compare it with the device
+ * the caller must hold the rmi4_fwu_mutex
+ *
+ * const unsigned int image_fw_id: the firmware id of the image
+ * enum flash_area *flash_area: the area to program, NONE if no update is required
+ *
+ * return EOK: complete the process
+ * otherwise, fail
+ */
+static int synaptics_rmi4_fwu_check_image(unsigned int image_fw_id,
+											enum flash_area *flash_area)
+{
+	int retval;
+
+	*flash_area = NONE;
+
+	// parse the target image file
+	retval = synaptics_rmi4_fwu_parse_image_info();
+	if (retval < 0) {
+		mtouch_error(MTOUCH_DEV, "%s: fail to parse the image file contents", __FUNCTION__);
+		return retval;
+	}
+
+	// use the firmware id of the image, if it is not specified
+	if ((0 == image_fw_id) && (g_fwu->img.contains_firmware_id))
+		image_fw_id = g_fwu->img.firmware_id;
+
+	if (g_fwu->blkcount.total_count != g_fwu->img.blkcount.total_count) {
+		mtouch_error(MTOUCH_DEV, "%s: flash size mismatch", __FUNCTION__);
+		return EOK;
+	}
+
+	if (g_fwu->bl_version != g_fwu->img.bl_version) {
+		mtouch_error(MTOUCH_DEV, "%s: bootloader version mismatch", __FUNCTION__);
+		return EOK;
+	}
+
+	// check the flash status
+	retval = synaptics_rmi4_fwu_read_flash_status();
+	if (retval < 0) {
+		mtouch_error(MTOUCH_DEV, "%s: fail to read flash status", __FUNCTION__);
+		return retval;
+	}
+
+	if (g_fwu->in_bl_mode) {
+		g_fwu->bl_mode_device = true;
+		mtouch_info(MTOUCH_DEV, "%s: device in bootloader mode", __FUNCTION__);
+	}
+	else {
+		g_fwu->bl_mode_device = false;
+	}
+
+	// determine the flash area
+	*flash_area = synaptics_rmi4_fwu_go_nogo(image_fw_id);
+
+	return EOK;
+}
+
+/*
+ * to check whether the firmware update is required
+ *
+ * the versions are probed from the header of the image file first, and the
+ * image is loaded and compared with the device only if they differ from the
+ * device, or if the partitions are compared in the differential mode.
+ * nothing is programmed.
+ *
+ * the image is kept for synaptics_rmi4_fwu_updater() if the update is required,
+ * so it is not loaded again
+ *
+ * const char *path_fw_image: the path of the image file
+ * const unsigned int image_fw_id: the firmware id of the image, 0 = use the id in the image
+ *
+ * return 0: no update is required
+ * return >0: the update is required
+ * otherwise, fail
+ */
+int synaptics_rmi4_fwu_check_update(const char *path_fw_image,
+							const unsigned int image_fw_id)
+{
+	int retval;
+	unsigned int fw_id = image_fw_id;
+	enum flash_area flash_area = NONE;
+	struct synaptics_rmi4_data *rmi4_data;
+
+	_CHECK_POINTER(g_fwu);
+	_CHECK_POINTER(g_fwu->rmi4_data);
+
+	if (!g_fwu->initialized)
+		return -ENODEV;
+
+	rmi4_data = g_fwu->rmi4_data;
+
+	// read the versions from the header only
+	retval = synaptics_rmi4_fwu_probe_image(path_fw_image, &g_fwu->probe);
+	if (retval < 0)
+		return retval;
+
+	if ((0 == fw_id) && (g_fwu->probe.contains_firmware_id))
+		fw_id = g_fwu->probe.firmware_id;
+
+	mtouch_info(MTOUCH_DEV, "%s: image firmware ID = %d, bootloader version = %d%s",
+				__FUNCTION__, fw_id, g_fwu->probe.bl_version,
+				(g_fwu->probe.compressed) ? ", compressed" : "");
+
+	if (g_fwu->bl_version != g_fwu->probe.bl_version) {
+		mtouch_error(MTOUCH_DEV, "%s: bootloader version mismatch", __FUNCTION__);
+		return 0;
 	}
 
-	retval = synaptics_rmi4_fwu_erase_all();
+	pthread_mutex_lock(&rmi4_data->rmi4_fwu_mutex);
+	retval = synaptics_rmi4_fwu_read_flash_status();
+	pthread_mutex_unlock(&rmi4_data->rmi4_fwu_mutex);
 	if (retval < 0) {
-		mtouch_error(MTOUCH_DEV, "%s: fail to do erase command", __FUNCTION__);
+		mtouch_error(MTOUCH_DEV, "%s: fail to read flash status", __FUNCTION__);
 		return retval;
 	}
-	mtouch_info(MTOUCH_DEV, "%s: erase completed", __FUNCTION__);
 
-	if (g_fwu->bl_version == BL_V7 && g_fwu->new_partition_table) {
-		retval = synaptics_rmi4_fwu_write_partition_table_v7();
-		if (retval < 0)
-			return retval;
-		mtouch_info(MTOUCH_DEV, "%s: partition table programmed", __FUNCTION__);
-	} else if (g_fwu->bl_version == BL_V8) {
-		retval = synaptics_rmi4_fwu_write_partition_table_v8();
+	// the image is not loaded, unless the probe finds a difference
+	// the configuration id is compared if the firmware matches
+	// in the differential mode, the partitions are read back and compared with the
+	// loaded image only if the configuration id differs from the device
+	if ((!g_fwu->force_update) && (!g_fwu->in_bl_mode) &&
+		(fw_id == rmi4_data->firmware_id)) {
+		if ((!g_fwu->probe.contains_config_id) ||
+			(g_fwu->probe.config_id_size != synaptics_rmi4_fwu_config_id_size())) {
+			mtouch_info(MTOUCH_DEV, "%s: no need to do reflash", __FUNCTION__);
+			return 0;
+		}
+
+		if (synaptics_rmi4_fwu_is_differential()) {
+			if (0 == memcmp(g_fwu->probe.config_id, g_fwu->config_id,
+							g_fwu->probe.config_id_size)) {
+				mtouch_info(MTOUCH_DEV, "%s: no need to do reflash, same configuration id",
+							__FUNCTION__);
+				return 0;
+			}
+
+			mtouch_info(MTOUCH_DEV, "%s: different configuration in the image", __FUNCTION__);
+		}
+		else {
+			if (!synaptics_rmi4_fwu_is_config_id_newer(g_fwu->probe.config_id,
+											g_fwu->probe.config_id_size)) {
+				mtouch_info(MTOUCH_DEV, "%s: no need to do reflash", __FUNCTION__);
+				return 0;
+			}
+
+			mtouch_info(MTOUCH_DEV, "%s: newer configuration in the image", __FUNCTION__);
+		}
+	}
+
+	if (!synaptics_rmi4_fwu_image_loaded()) {
+		retval = synaptics_rmi4_fwu_load_image(path_fw_image);
 		if (retval < 0)
-			return retval;
-		mtouch_info(MTOUCH_DEV, "%s: partition table programmed", __FUNCTION__);
+			goto exit;
 	}
 
-	retval = synaptics_rmi4_fwu_write_firmware();
-	if (retval < 0)
-		return retval;
-	mtouch_info(MTOUCH_DEV, "%s: firmware programmed", __FUNCTION__);
+	pthread_mutex_lock(&rmi4_data->rmi4_fwu_mutex);
+	retval = synaptics_rmi4_fwu_check_image(fw_id, &flash_area);
+	pthread_mutex_unlock(&rmi4_data->rmi4_fwu_mutex);
 
-	g_fwu->config_area = UI_CONFIG_AREA;
-	if (g_fwu->flash_properties.has_disp_config && g_fwu->img.contains_disp_config) {
-		retval = synaptics_rmi4_fwu_write_dp_configuration();
-		if (retval < 0)
-			return retval;
-		mtouch_info(MTOUCH_DEV, "%s: display configuration programmed", __FUNCTION__);
+exit:
+	if ((retval < 0) || (NONE == flash_area))
+		synaptics_rmi4_fwu_release_image();
+
+	return (retval < 0) ? retval : (int)flash_area;
+}
+
+/*
+ * to count the blocks programmed for the flash area
+ * the partitions skipped by the resumed reflash are counted as well, the
+ * progress jumps to the end once the reflash is complete
+ *
+ * enum flash_area flash_area: the area to be programmed
+ *
+ * return the number of blocks
+ */
+static unsigned int synaptics_rmi4_fwu_count_blocks(enum flash_area flash_area)
+{
+	unsigned int size;
+
+	if (0 == g_fwu->block_size)
+		return 0;
+
+	if (UI_PARTITIONS == flash_area) {
+		size = 0;
+
+		if (g_fwu->diff_partitions & (1 << JOURNAL_UI_CONFIG))
+			size += g_fwu->img.ui_config.size;
+		if (g_fwu->diff_partitions & (1 << JOURNAL_DP_CONFIG))
+			size += g_fwu->img.dp_config.size;
+		if (g_fwu->diff_partitions & (1 << JOURNAL_GUEST_CODE))
+			size += g_fwu->img.guest_code.size;
+
+		return size / g_fwu->block_size;
 	}
 
-	retval = synaptics_rmi4_fwu_write_ui_configuration();
-	if (retval < 0)
-		return retval;
-	mtouch_info(MTOUCH_DEV, "%s: configuration programmed", __FUNCTION__);
+	size = g_fwu->img.ui_config.size;
 
-	if (g_fwu->has_guest_code && g_fwu->img.contains_guest_code) {
-		retval = synaptics_rmi4_fwu_write_guest_code();
-		if (retval < 0)
-			return retval;
-		mtouch_info(MTOUCH_DEV, "%s: guest code programmed", __FUNCTION__);
+	if (UI_FIRMWARE == flash_area) {
+		size += g_fwu->img.ui_firmware.size;
+
+		if (g_fwu->flash_properties.has_disp_config && g_fwu->img.contains_disp_config)
+			size += g_fwu->img.dp_config.size;
+
+		if (g_fwu->has_guest_code && g_fwu->img.contains_guest_code)
+			size += g_fwu->img.guest_code.size;
 	}
 
-	return retval;
+	return size / g_fwu->block_size;
 }
 
 /*
@@ -2672,107 +4672,45 @@ static int synaptics_rmi4_fwu_start_reflash(const char *path_fw_image,
 	int retval;
 	enum flash_area flash_area;
 	struct synaptics_rmi4_data *rmi4_data;
-	int numBytesRead;
-	FILE *fp;
 
 	_CHECK_POINTER(g_fwu);
 	_CHECK_POINTER(g_fwu->rmi4_data);
 
 	rmi4_data = g_fwu->rmi4_data;
 
-	sprintf(g_fwu->image_name, "%s", path_fw_image);
-
 	mtouch_info(MTOUCH_DEV, "%s: start of reflash process",
 				__FUNCTION__);
 
-	// open the target image file and store in g_fwu->image
-	if (NULL == g_fwu->image) {
-		mtouch_info(MTOUCH_DEV, "%s: fw image file: %s", __FUNCTION__, g_fwu->image_name);
-
-		if (strlen(g_fwu->image_name) <= 0) {
-			mtouch_error(MTOUCH_DEV, "%s: invalid path of image file", __FUNCTION__);
-			retval = -EINVAL;
-			goto exit;
-		}
-
-		fp = fopen(g_fwu->image_name, "r");
-		if (!fp) {
-			mtouch_error(MTOUCH_DEV, "%s: image file %s not found", __FUNCTION__, g_fwu->image_name);
-			retval = -EINVAL;
-			goto exit;
-		}
-
-		fseek(fp, 0L, SEEK_END);
-		g_fwu->image_file_size = ftell(fp);
-		if (g_fwu->image_file_size == -1) {
-			mtouch_error(MTOUCH_DEV, "%s: fail to determine size of %s", __FUNCTION__, g_fwu->image_name);
-			retval = -EIO;
-			fclose(fp);
-			goto exit;
-		}
-
-		fseek(fp, 0L, SEEK_SET);
-		g_fwu->image = calloc(g_fwu->image_file_size + 1, sizeof(unsigned char));
-		if (!g_fwu->image) {
-			mtouch_error(MTOUCH_DEV, "%s: failed to allocate memory for g_fwu->image (size = %d)",
-						__FUNCTION__, g_fwu->image_file_size + 1);
-			retval = -ENOMEM;
-			fclose(fp);
-			goto exit;
-		}
-		else {
-			numBytesRead = fread(g_fwu->image, sizeof(unsigned char), g_fwu->image_file_size, fp);
-			if (numBytesRead != g_fwu->image_file_size) {
-				mtouch_error(MTOUCH_DEV, "%s: failed to read entire content of image file (bytes_read = %d)(size = %d)",
-							__FUNCTION__, numBytesRead, g_fwu->image_file_size);
-				retval = -EIO;
-				fclose(fp);
-				goto exit;
-			}
-		}
-
-		fclose(fp);
+	// map the target image file and store in g_fwu->image, or open the stream of a compressed one
+	if (!synaptics_rmi4_fwu_image_loaded()) {
+		retval = synaptics_rmi4_fwu_load_image(path_fw_image);
+		if (retval < 0)
+			return retval;
 	}
 
 	pthread_mutex_lock(&rmi4_data->rmi4_fwu_mutex);
 
-	// parse the target image file
-	retval = synaptics_rmi4_fwu_parse_image_info();
-	if (retval < 0) {
-		mtouch_error(MTOUCH_DEV, "%s: fail to parse the image file contents", __FUNCTION__);
-		goto exit;
-	}
-
-	if (g_fwu->blkcount.total_count != g_fwu->img.blkcount.total_count) {
-		mtouch_error(MTOUCH_DEV, "%s: flash size mismatch", __FUNCTION__);
-		goto exit;
-	}
-
-	if (g_fwu->bl_version != g_fwu->img.bl_version) {
-		mtouch_error(MTOUCH_DEV, "%s: bootloader version mismatch", __FUNCTION__);
+	retval = synaptics_rmi4_fwu_check_image(image_fw_id, &flash_area);
+	if (retval < 0)
 		goto exit;
-	}
 
-	// check the flash status
-	retval = synaptics_rmi4_fwu_read_flash_status();
-	if (retval < 0) {
-		mtouch_error(MTOUCH_DEV, "%s: fail to read flash status", __FUNCTION__);
-		goto exit;
-	}
+	// if the flash area != NONE, enter the bootloader mode
+	// the device is handed over right before, the touch is available until here
+	if (flash_area != NONE) {
+		// a compressed image is checked in full before anything is erased
+		if (g_fwu->stream) {
+			retval = synaptics_rmi4_lz4_stream_check(g_fwu->stream);
+			if (retval < 0) {
+				mtouch_error(MTOUCH_DEV, "%s: corrupted image %s", __FUNCTION__, g_fwu->image_name);
+				goto exit;
+			}
+		}
 
-	if (g_fwu->in_bl_mode) {
-		g_fwu->bl_mode_device = true;
-		mtouch_info(MTOUCH_DEV, "%s: device in bootloader mode", __FUNCTION__);
-	}
-	else {
-		g_fwu->bl_mode_device = false;
-	}
+		synaptics_rmi4_fwu_progress_reset(synaptics_rmi4_fwu_count_blocks(flash_area));
 
-	// determine the flash area
-	// if the flash area != NONE, enter the bootloader mode
-	flash_area = synaptics_rmi4_fwu_go_nogo(image_fw_id);
+		if (fwu_handoff)
+			fwu_handoff(fwu_handoff_arg);
 
-	if (flash_area != NONE) {
 		retval = synaptics_rmi4_fwu_enter_flash_prog();
 		if (retval < 0) {
 			synaptics_rmi4_sw_reset(rmi4_data);
@@ -2807,13 +4745,25 @@ static int synaptics_rmi4_fwu_start_reflash(const char *path_fw_image,
 		}
 
 		retval = synaptics_rmi4_fwu_write_ui_configuration();
-		if (retval < 0)
-			return retval;
+		if (retval < 0) {
+			mtouch_error(MTOUCH_DEV, "%s: fail to write config area", __FUNCTION__);
+			goto exit;
+		}
 		mtouch_info(MTOUCH_DEV, "%s: configuration programmed", __FUNCTION__);
 
 		g_fwu->updated = true;
 		break;
 
+	case UI_PARTITIONS:
+		retval = synaptics_rmi4_fwu_do_differential_reflash();
+		if (retval < 0) {
+			mtouch_error(MTOUCH_DEV, "%s: fail to do differential reflash", __FUNCTION__);
+			goto exit;
+		}
+
+		g_fwu->updated = true;
+		break;
+
 	case NONE:
 		g_fwu->updated = false;
 		break;
@@ -2823,10 +4773,29 @@ static int synaptics_rmi4_fwu_start_reflash(const char *path_fw_image,
 		break;
 	}
 
+	// read back the programmed partitions before leaving the bootloader mode
+	if (g_fwu->updated && g_fwu->verify) {
+		retval = synaptics_rmi4_fwu_verify_reflash();
+		if (retval < 0) {
+			mtouch_error(MTOUCH_DEV, "%s: fail to verify the reflash", __FUNCTION__);
+			synaptics_rmi4_fwu_journal_reopen();
+			goto exit;
+		}
+	}
+
+	// the reflash is complete and verified, the journal is no longer required
+	if (g_fwu->updated) {
+		synaptics_rmi4_fwu_progress_add(UINT_MAX);
+		synaptics_rmi4_fwu_journal_clear();
+	}
 
 exit:
 	mtouch_info(MTOUCH_DEV, "%s: end of reflash process", __FUNCTION__);
 
+	// the device leaves the bootloader mode in the reinit
+	if (synaptics_rmi4_fwu_attn_enabled())
+		synaptics_rmi4_fwu_attn_set(ATTN_HOLD);
+
 	pthread_mutex_unlock(&rmi4_data->rmi4_fwu_mutex);
 
 	return retval;
@@ -2835,6 +4804,7 @@ exit:
 /*
  * the entry point of firmware update
  * call synaptics_rmi4_fwu_start_reflash() to perform the firmware upgrade
+ * it may be called again at runtime, the fwu handle is re-created by the reinit
  *
  * return EOK: complete
  * otherwise, fail
@@ -2843,10 +4813,7 @@ int synaptics_rmi4_fwu_updater(const char *path_fw_image,
 							const unsigned int image_fw_id)
 {
 	int retval;
-	static unsigned char do_once = 1;
-
-	if (!do_once)
-		return EOK;
+	int reinit_retval;
 
 	_CHECK_POINTER(g_fwu);
 
@@ -2856,25 +4823,23 @@ int synaptics_rmi4_fwu_updater(const char *path_fw_image,
 	if (!g_fwu->initialized)
 		return -ENODEV;
 
-	g_fwu->image = NULL;
-
+	// the image may be loaded already by synaptics_rmi4_fwu_check_update()
 	retval = synaptics_rmi4_fwu_start_reflash(path_fw_image, image_fw_id);
 
+	// release the image before the reinit, which re-creates the fwu handle
+	synaptics_rmi4_fwu_release_image();
+
 	if (g_fwu->updated) {
 		// re-build the RMI4 device instance
-		retval = synaptics_rmi4_reinit();
-		if (retval < 0) {
+		// the error of the reflash, e.g. the verify, is kept over the reinit
+		reinit_retval = synaptics_rmi4_reinit();
+		if (reinit_retval < 0) {
 			mtouch_error(MTOUCH_DEV, "%s: fail to do reinit the device", __FUNCTION__);
+			if (EOK == retval)
+				retval = reinit_retval;
 		}
 	}
 
-	do_once = 0;
-
-	if (g_fwu->image) {
-		free(g_fwu->image);
-		g_fwu->image = NULL;
-	}
-
 	return retval;
 }
 
@@ -2944,6 +4909,8 @@ int synaptics_rmi4_fwu_init(struct synaptics_rmi4_data *rmi4_data,
 
 	g_fwu->force_update = FORCE_UPDATE;
 	g_fwu->do_lockdown = DO_LOCKDOWN;
+	g_fwu->differential = DIFFERENTIAL_UPDATE;
+	g_fwu->verify = VERIFY_UPDATE;
 	g_fwu->initialized = true;
 
 	return EOK;
@@ -2966,6 +4933,11 @@ exit:
  */
 void synaptics_rmi4_fwu_deinit(void)
 {
+	if (!g_fwu)
+		return;
+
+	synaptics_rmi4_fwu_release_image();
+
 	if (g_fwu->image_name) {
 		free(g_fwu->image_name);
 		g_fwu->image_name = NULL;
@@ -2980,3 +4952,153 @@ void synaptics_rmi4_fwu_deinit(void)
 	}
 }
 
+/*
+ * get the configuration ID read from the device in the initialization
+ *
+ * unsigned char *config_id: buffer to store the configuration ID
+ * unsigned int size: size of the buffer
+ *
+ * return EOK: success
+ * otherwise, fail
+ */
+int synaptics_rmi4_fwu_get_config_id(unsigned char *config_id, unsigned int size)
+{
+	_CHECK_POINTER(config_id);
+	_CHECK_POINTER(g_fwu);
+
+	if (size > sizeof(g_fwu->config_id))
+		size = sizeof(g_fwu->config_id);
+
+	memcpy(config_id, g_fwu->config_id, size);
+
+	return EOK;
+}
+
+/*
+ * route the attention to the firmware update, or back to the interrupt handling
+ * while routed, the interrupt handling thread calls synaptics_rmi4_fwu_attn()
+ *
+ * bool enable: true to route the attention to the update
+ *
+ * return EOK: success
+ * otherwise, fail
+ */
+int synaptics_rmi4_fwu_attn_enable(bool enable)
+{
+	if (!enable) {
+		pthread_once(&fwu_attn_once, synaptics_rmi4_fwu_attn_init);
+
+		pthread_mutex_lock(&fwu_attn.mutex);
+		fwu_attn.mode = ATTN_OFF;
+		pthread_mutex_unlock(&fwu_attn.mutex);
+
+		return EOK;
+	}
+
+	_CHECK_POINTER(g_fwu);
+	_CHECK_POINTER(g_fwu->rmi4_data);
+	_CHECK_POINTER(g_fwu->rmi4_data->f01);
+
+	synaptics_rmi4_fwu_attn_set(ATTN_DISCARD);
+
+	return EOK;
+}
+
+/*
+ * service the attention while it is routed to the firmware update
+ * the interrupt status is read to release the attention, and the flash
+ * interrupt wakes up synaptics_rmi4_fwu_wait_for_idle()
+ *
+ * struct synaptics_rmi4_data *rmi4_data: RMI4 device instance data
+ *
+ * return >0: serviced, the interrupt can be unmasked
+ * return 0: the interrupt must stay masked until the update is finished
+ * otherwise, fail
+ */
+int synaptics_rmi4_fwu_attn(struct synaptics_rmi4_data *rmi4_data)
+{
+	int retval;
+	unsigned char status[MAX_INTR_REGISTERS];
+
+	_CHECK_POINTER(rmi4_data);
+
+	pthread_mutex_lock(&fwu_attn.mutex);
+
+	if ((ATTN_OFF == fwu_attn.mode) || (ATTN_HOLD == fwu_attn.mode)) {
+		retval = 0;
+		goto exit;
+	}
+
+	retval = synaptics_rmi4_reg_read(rmi4_data,
+				fwu_attn.addr,
+				status,
+				fwu_attn.regs);
+	if (retval < 0) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to read interrupt status", __FUNCTION__);
+		goto exit;
+	}
+
+	if ((ATTN_FLASH == fwu_attn.mode) && (status[0] & fwu_attn.mask)) {
+		fwu_attn.count++;
+		pthread_cond_broadcast(&fwu_attn.cond);
+	}
+
+	retval = 1;
+
+exit:
+	pthread_mutex_unlock(&fwu_attn.mutex);
+
+	return retval;
+}
+
+/*
+ * set the path of the journal recording the progress of the reflash
+ * the path outlives the fwu handle, which is re-created by the reinit
+ *
+ * const char *path: the path of the journal, NULL or empty = disabled
+ *
+ * return void
+ */
+void synaptics_rmi4_fwu_set_journal(const char *path)
+{
+	if (!path) {
+		fwu_journal_path[0] = '\0';
+		return;
+	}
+
+	snprintf(fwu_journal_path, sizeof(fwu_journal_path), "%s", path);
+}
+
+/*
+ * set the routine handing the device over to the firmware update
+ * it is called from the reflash right before the bootloader mode is entered,
+ * the interrupt handling must stop reporting the touch from then on
+ *
+ * void (*handoff)(void *arg): the routine, NULL = none
+ * void *arg: the argument passed to the routine
+ *
+ * return void
+ */
+void synaptics_rmi4_fwu_set_handoff(void (*handoff)(void *arg), void *arg)
+{
+	fwu_handoff = handoff;
+	fwu_handoff_arg = arg;
+}
+
+/*
+ * get the progress of the running reflash
+ *
+ * return the programmed blocks in percent, 0 if nothing is being programmed
+ */
+unsigned int synaptics_rmi4_fwu_get_progress(void)
+{
+	unsigned int percent = 0;
+
+	pthread_mutex_lock(&fwu_progress.mutex);
+	if (fwu_progress.total)
+		percent = (unsigned int)((uint64_t)fwu_progress.written * 100 / fwu_progress.total);
+	pthread_mutex_unlock(&fwu_progress.mutex);
+
+	return percent;
+}
+
@@ -58,6 +58,11 @@
 
 #define FORCE_UPDATE false
 #define DO_LOCKDOWN false
+#define DIFFERENTIAL_UPDATE true
+#define VERIFY_UPDATE true
+
+#define FWU_JOURNAL_MAGIC (0x4E4A5746) // "FWJN"
+#define FWU_JOURNAL_VERSION (1)
 
 #define MAX_IMAGE_NAME_LEN 256
 #define MAX_FIRMWARE_ID_LEN 10
@@ -123,6 +128,7 @@ enum config_area {
 	DP_CONFIG_AREA,
 	FLASH_CONFIG_AREA,
 	UPP_AREA,
+	GUEST_CODE_AREA,
 };
 
 enum v7_status {
@@ -201,6 +207,21 @@ enum flash_command {
 	CMD_ENABLE_FLASH_PROG,
 };
 
+/*
+ * enum fwu_attn_mode - the servicing of the attention while the update owns the device
+ *
+ * ATTN_OFF: the attention is serviced by the interrupt handling thread
+ * ATTN_DISCARD: the interrupt status is read to release the attention, and discarded
+ * ATTN_FLASH: the completion of the flash command is signalled to the waiting routine
+ * ATTN_HOLD: the device is re-initialized, the interrupt stays masked until the end
+ */
+enum fwu_attn_mode {
+	ATTN_OFF = 0,
+	ATTN_DISCARD,
+	ATTN_FLASH,
+	ATTN_HOLD,
+};
+
 enum container_id {
 	TOP_LEVEL_CONTAINER = 0,
 	UI_CONTAINER,
@@ -496,6 +517,10 @@ struct image_header_05_06 {
 struct block_data {
 	unsigned int size;
 	const unsigned char *data;
+	unsigned int offset;   // offset of the content in the image
+	unsigned char *copy;   // the content read out of a compressed image
+	unsigned int crc;      // CRC-32 of the first crc_size bytes, computed while streamed
+	unsigned int crc_size;
 };
 
 struct image_metadata {
@@ -530,6 +555,80 @@ struct image_metadata {
 	struct physical_address phyaddr;
 };
 
+/*
+ * struct image_probe - the versions read from the header of the image file
+ * only the header and the container directory are read, the image is not loaded
+ * a compressed image is decoded only up to the containers read
+ *
+ */
+struct image_probe {
+	bool compressed;
+	bool contains_firmware_id;
+	bool contains_config_id;
+	unsigned int firmware_id;
+	unsigned char bl_version;
+	unsigned char config_id_size;
+	unsigned char config_id[V7_CONFIG_ID_SIZE];
+};
+
+
+/*
+ * enum fwu_journal_phase - the phases of the full reflash recorded in the journal
+ *
+ */
+enum fwu_journal_phase {
+	JOURNAL_ERASE = 0,
+	JOURNAL_PARTITION_TABLE,
+	JOURNAL_UI_FIRMWARE,
+	JOURNAL_DP_CONFIG,
+	JOURNAL_UI_CONFIG,
+	JOURNAL_GUEST_CODE,
+	JOURNAL_PHASES,
+};
+
+/*
+ * struct synaptics_rmi4_fwu_journal - the progress of the reflash saved across the boots
+ *
+ * the journal belongs to the image with the same size and CRC-32,
+ * completed is a bitmask of enum fwu_journal_phase
+ *
+ */
+struct synaptics_rmi4_fwu_journal {
+	unsigned int magic;
+	unsigned int version;
+	unsigned int image_size;
+	unsigned int image_crc;
+	unsigned int bl_version;
+	unsigned int completed;
+	unsigned int checksum;
+};
+
+/*
+ * struct synaptics_rmi4_fwu_attn - the attention routed to the firmware update
+ * it outlives the fwu handle, which is re-created by the reinit
+ *
+ */
+struct synaptics_rmi4_fwu_attn {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	enum fwu_attn_mode mode;
+	unsigned short addr;   // address of the interrupt status
+	unsigned char regs;    // number of the interrupt status registers
+	unsigned char mask;    // the F34 interrupt source
+	unsigned int count;    // the flash interrupts signalled
+	unsigned int seen;     // the flash interrupts consumed by the waiting routine
+};
+
+/*
+ * struct synaptics_rmi4_fwu_progress - the blocks programmed by the running reflash
+ * it outlives the fwu handle, which is re-created by the reinit
+ *
+ */
+struct synaptics_rmi4_fwu_progress {
+	pthread_mutex_t mutex;
+	unsigned int total;    // the blocks expected to be programmed
+	unsigned int written;  // the blocks programmed so far
+};
 
 /*
  * struct synaptics_rmi4_fwu_handle - meta information related to flash memory
@@ -545,6 +644,8 @@ struct synaptics_rmi4_fwu_handle {
 	bool bl_mode_device;
 	bool force_update;
 	bool do_lockdown;
+	bool differential;
+	bool verify;
 	bool has_guest_code;
 	bool has_utility_param;
 	bool new_partition_table;
@@ -565,12 +666,17 @@ struct synaptics_rmi4_fwu_handle {
 	unsigned short flash_config_length;
 	unsigned short payload_length;
 	unsigned short partition_table_bytes;
-	unsigned short read_config_buf_size;
+	unsigned int read_config_buf_size;
+	unsigned int diff_partitions;  // partitions differing from the image, a bitmask of enum fwu_journal_phase
 	const unsigned char *config_data;
-	unsigned char *image;
+	const unsigned char *image;
 	char *image_name;
 	int image_file_size;
+	unsigned int image_size;  // size of the image, decoded if compressed
+	struct synaptics_rmi4_lz4_stream *stream;
 	struct image_metadata img;
+	struct image_probe probe;
+	struct synaptics_rmi4_fwu_journal journal;
 	struct register_offset off;
 	struct block_count blkcount;
 	struct physical_address phyaddr;
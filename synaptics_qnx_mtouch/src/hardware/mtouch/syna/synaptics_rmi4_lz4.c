@@ -0,0 +1,771 @@
+/*
+ * $QNXLicenseC:
+ * Copyright 2010, QNX Software Systems.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You
+ * may not reproduce, modify or distribute this software except in
+ * compliance with the License. You may obtain a copy of the License
+ * at: http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OF ANY KIND, either express or implied.
+ *
+ * This file may contain contributions from others, either as
+ * contributors under the License or as licensors under other terms.
+ * Please review this entire file for other proprietary rights or license
+ * notices, as well as the QNX Development Suite License Guide at
+ * http://licensing.qnx.com/license-guide/ for other information.
+ * $
+ */
+
+/*
+ * Synaptics Touchscreen driver
+ *
+ * Copyright (C) 2012-2018 Synaptics Incorporated. All rights reserved.
+ *
+ * The hardware access library is included from QNX software, and the
+ * mtouch framework is also included from install/usr/input/. Both of
+ * libraries are under Apache-2.0.
+ *
+ * Synaptics Touchscreen driver is interacted with QNX software system
+ * as a touchscreen controller, for its licensing rule and related notices,
+ * please scroll down the text to browse all of it.
+ *
+ * INFORMATION CONTAINED IN THIS DOCUMENT IS PROVIDED "AS-IS," AND SYNAPTICS
+ * EXPRESSLY DISCLAIMS ALL EXPRESS AND IMPLIED WARRANTIES, INCLUDING ANY
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE,
+ * AND ANY WARRANTIES OF NON-INFRINGEMENT OF ANY INTELLECTUAL PROPERTY RIGHTS.
+ * IN NO EVENT SHALL SYNAPTICS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, PUNITIVE, OR CONSEQUENTIAL DAMAGES ARISING OUT OF OR IN CONNECTION
+ * WITH THE USE OF THE INFORMATION CONTAINED IN THIS DOCUMENT, HOWEVER CAUSED
+ * AND BASED ON ANY THEORY OF LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, AND EVEN IF SYNAPTICS WAS ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE. IF A TRIBUNAL OF COMPETENT JURISDICTION DOES
+ * NOT PERMIT THE DISCLAIMER OF DIRECT DAMAGES OR ANY OTHER DAMAGES, SYNAPTICS'
+ * TOTAL CUMULATIVE LIABILITY TO ANY PARTY SHALL NOT EXCEED ONE HUNDRED U.S.
+ * DOLLARS.
+ *
+ */
+
+#include "synaptics_mtouch.h"
+#include "synaptics_rmi4_lz4.h"
+
+/* the version of the frame format in FLG */
+#define LZ4_FLG_VERSION				(0x01)
+
+/* the minimum length of a match */
+#define LZ4_MIN_MATCH				(4)
+
+/* the block is stored as it is, bit 31 of the block size */
+#define LZ4_BLOCK_UNCOMPRESSED		(0x80000000U)
+
+/* the bytes of a match copied at once */
+#define LZ4_MATCH_CHUNK				(256)
+
+/* the primes of xxHash-32 */
+#define XXH_PRIME32_1				(2654435761U)
+#define XXH_PRIME32_2				(2246822519U)
+#define XXH_PRIME32_3				(3266489917U)
+#define XXH_PRIME32_4				(668265263U)
+#define XXH_PRIME32_5				(374761393U)
+
+
+/*
+ * helper function to read a little-endian 32-bit value
+ */
+static inline uint32_t synaptics_rmi4_lz4_le32(const unsigned char *ptr)
+{
+	return (uint32_t)ptr[0] | ((uint32_t)ptr[1] << 8) |
+			((uint32_t)ptr[2] << 16) | ((uint32_t)ptr[3] << 24);
+}
+
+static inline uint32_t synaptics_rmi4_lz4_rotl(uint32_t value, unsigned int bits)
+{
+	return (value << bits) | (value >> (32 - bits));
+}
+
+static inline uint32_t synaptics_rmi4_lz4_xxh32_round(uint32_t acc, uint32_t input)
+{
+	acc += input * XXH_PRIME32_2;
+	acc = synaptics_rmi4_lz4_rotl(acc, 13);
+
+	return acc * XXH_PRIME32_1;
+}
+
+/*
+ * to start the xxHash-32 used by the checksums of the LZ4 frame
+ *
+ * struct synaptics_rmi4_lz4_xxh32 *state: the state of the hash
+ * uint32_t seed: the seed, 0 in the LZ4 frame
+ *
+ * return void
+ */
+static void synaptics_rmi4_lz4_xxh32_reset(struct synaptics_rmi4_lz4_xxh32 *state, uint32_t seed)
+{
+	memset(state, 0x00, sizeof(struct synaptics_rmi4_lz4_xxh32));
+
+	state->v[0] = seed + XXH_PRIME32_1 + XXH_PRIME32_2;
+	state->v[1] = seed + XXH_PRIME32_2;
+	state->v[2] = seed;
+	state->v[3] = seed - XXH_PRIME32_1;
+}
+
+/*
+ * to add the data to the xxHash-32
+ * the data is consumed in stripes of 16 bytes, the rest is kept for the next call
+ *
+ * struct synaptics_rmi4_lz4_xxh32 *state: the state of the hash
+ * const unsigned char *data: the data
+ * size_t size: number of bytes
+ *
+ * return void
+ */
+static void synaptics_rmi4_lz4_xxh32_update(struct synaptics_rmi4_lz4_xxh32 *state,
+			const unsigned char *data, size_t size)
+{
+	size_t fill;
+	const unsigned char *stripe;
+
+	state->total += size;
+
+	while (size) {
+		if ((0 == state->mem_size) && (size >= sizeof(state->mem))) {
+			stripe = data;
+			fill = sizeof(state->mem);
+		}
+		else {
+			fill = sizeof(state->mem) - state->mem_size;
+			if (fill > size)
+				fill = size;
+
+			memcpy(&state->mem[state->mem_size], data, fill);
+			state->mem_size += fill;
+			if (state->mem_size < sizeof(state->mem)) {
+				data += fill;
+				size -= fill;
+				continue;
+			}
+
+			stripe = state->mem;
+			state->mem_size = 0;
+		}
+
+		state->v[0] = synaptics_rmi4_lz4_xxh32_round(state->v[0], synaptics_rmi4_lz4_le32(stripe));
+		state->v[1] = synaptics_rmi4_lz4_xxh32_round(state->v[1], synaptics_rmi4_lz4_le32(stripe + 4));
+		state->v[2] = synaptics_rmi4_lz4_xxh32_round(state->v[2], synaptics_rmi4_lz4_le32(stripe + 8));
+		state->v[3] = synaptics_rmi4_lz4_xxh32_round(state->v[3], synaptics_rmi4_lz4_le32(stripe + 12));
+
+		data += fill;
+		size -= fill;
+	}
+}
+
+/*
+ * to finish the xxHash-32
+ *
+ * const struct synaptics_rmi4_lz4_xxh32 *state: the state of the hash
+ *
+ * return the hash
+ */
+static uint32_t synaptics_rmi4_lz4_xxh32_digest(const struct synaptics_rmi4_lz4_xxh32 *state)
+{
+	const unsigned char *data = state->mem;
+	const unsigned char *end = state->mem + state->mem_size;
+	uint32_t hash;
+
+	if (state->total >= sizeof(state->mem)) {
+		hash = synaptics_rmi4_lz4_rotl(state->v[0], 1) + synaptics_rmi4_lz4_rotl(state->v[1], 7) +
+				synaptics_rmi4_lz4_rotl(state->v[2], 12) + synaptics_rmi4_lz4_rotl(state->v[3], 18);
+	}
+	else {
+		// v[2] holds the seed
+		hash = state->v[2] + XXH_PRIME32_5;
+	}
+
+	hash += (uint32_t)state->total;
+
+	while (end - data >= 4) {
+		hash += synaptics_rmi4_lz4_le32(data) * XXH_PRIME32_3;
+		hash = synaptics_rmi4_lz4_rotl(hash, 17) * XXH_PRIME32_4;
+		data += 4;
+	}
+
+	while (data < end) {
+		hash += (*data) * XXH_PRIME32_5;
+		hash = synaptics_rmi4_lz4_rotl(hash, 11) * XXH_PRIME32_1;
+		data++;
+	}
+
+	hash ^= hash >> 15;
+	hash *= XXH_PRIME32_2;
+	hash ^= hash >> 13;
+	hash *= XXH_PRIME32_3;
+	hash ^= hash >> 16;
+
+	return hash;
+}
+
+/*
+ * compute the xxHash-32 of the data at once
+ *
+ * const unsigned char *data: the data
+ * size_t size: number of bytes
+ * uint32_t seed: the seed, 0 in the LZ4 frame
+ *
+ * return the hash
+ */
+static uint32_t synaptics_rmi4_lz4_xxh32(const unsigned char *data, size_t size, uint32_t seed)
+{
+	struct synaptics_rmi4_lz4_xxh32 state;
+
+	synaptics_rmi4_lz4_xxh32_reset(&state, seed);
+	synaptics_rmi4_lz4_xxh32_update(&state, data, size);
+
+	return synaptics_rmi4_lz4_xxh32_digest(&state);
+}
+
+/*
+ * helper function to read the exact number of bytes at the offset of the file
+ *
+ * return EOK: complete
+ * otherwise, fail
+ */
+static int synaptics_rmi4_lz4_pread(int fd, void *buf, size_t size, off_t offset)
+{
+	ssize_t len;
+	unsigned char *ptr = buf;
+
+	while (size) {
+		len = pread(fd, ptr, size, offset);
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			return -EIO;
+		}
+		if (len == 0)
+			return -EIO;
+
+		ptr += len;
+		size -= len;
+		offset += len;
+	}
+
+	return EOK;
+}
+
+/*
+ * read the frame descriptor at the beginning of the file
+ * the frame must carry the content size, so the image is checked against it
+ *
+ * int fd: the image file
+ * struct synaptics_rmi4_lz4_frame *frame: the frame descriptor
+ *
+ * return >0: the file is a LZ4 frame
+ * return 0: the file is not a LZ4 frame
+ * otherwise, the frame is not supported
+ */
+int synaptics_rmi4_lz4_read_frame(int fd, struct synaptics_rmi4_lz4_frame *frame)
+{
+	unsigned char magic[4];
+	unsigned char desc[2 + 8 + 4 + 1];
+	unsigned int desc_size = 2;
+	unsigned char flg;
+	unsigned char bd;
+	uint32_t hash;
+
+	_CHECK_POINTER(frame);
+
+	memset(frame, 0x00, sizeof(struct synaptics_rmi4_lz4_frame));
+
+	if (pread(fd, magic, sizeof(magic), 0) != (ssize_t)sizeof(magic))
+		return 0;
+
+	if (synaptics_rmi4_lz4_le32(magic) != LZ4_FRAME_MAGIC)
+		return 0;
+
+	if (pread(fd, desc, 2, sizeof(magic)) != 2)
+		return -EIO;
+
+	flg = desc[0];
+	bd = desc[1];
+
+	if ((flg >> 6) != LZ4_FLG_VERSION) {
+		mtouch_error(MTOUCH_DEV, "%s: unsupported frame version %d", __FUNCTION__, flg >> 6);
+		return -ENOTSUP;
+	}
+
+	if (flg & 0x01) {
+		mtouch_error(MTOUCH_DEV, "%s: the frame requires a dictionary", __FUNCTION__);
+		return -ENOTSUP;
+	}
+
+	if (!(flg & 0x08)) {
+		mtouch_error(MTOUCH_DEV, "%s: the frame has no content size", __FUNCTION__);
+		return -ENOTSUP;
+	}
+
+	// content size, followed by the header checksum
+	desc_size += 8;
+	if (pread(fd, &desc[2], 8 + 1, sizeof(magic) + 2) != 8 + 1)
+		return -EIO;
+
+	hash = synaptics_rmi4_lz4_xxh32(desc, desc_size, 0);
+	if (((hash >> 8) & 0xFF) != desc[desc_size]) {
+		mtouch_error(MTOUCH_DEV, "%s: frame descriptor checksum mismatch", __FUNCTION__);
+		return -EINVAL;
+	}
+
+	switch ((bd >> 4) & 0x07) {
+	case 4:
+		frame->block_max = 64 * 1024;
+		break;
+	case 5:
+		frame->block_max = 256 * 1024;
+		break;
+	case 6:
+		frame->block_max = 1024 * 1024;
+		break;
+	case 7:
+		frame->block_max = LZ4_MAX_BLOCK_SIZE;
+		break;
+	default:
+		mtouch_error(MTOUCH_DEV, "%s: invalid block maximum size", __FUNCTION__);
+		return -EINVAL;
+	}
+
+	frame->block_checksum = (flg & 0x10) ? true : false;
+	frame->content_checksum = (flg & 0x04) ? true : false;
+	frame->content_size = (uint64_t)synaptics_rmi4_lz4_le32(&desc[2]) |
+							((uint64_t)synaptics_rmi4_lz4_le32(&desc[6]) << 32);
+	frame->data_offset = sizeof(magic) + desc_size + 1;
+
+	return 1;
+}
+
+/*
+ * to restart the decoding at the first block of the frame
+ *
+ * struct synaptics_rmi4_lz4_stream *stream: the stream
+ *
+ * return void
+ */
+static void synaptics_rmi4_lz4_stream_rewind(struct synaptics_rmi4_lz4_stream *stream)
+{
+	stream->block_size = 0;
+	stream->ip = 0;
+	stream->literal = 0;
+	stream->match = 0;
+	stream->offset = 0;
+	stream->in_match = false;
+	stream->end = false;
+	stream->pos = 0;
+	stream->next_block = stream->frame.data_offset;
+
+	synaptics_rmi4_lz4_xxh32_reset(&stream->hash, 0);
+}
+
+/*
+ * to read the next block of the frame into the block buffer
+ * the block checksum is checked here, the content checksum at the end mark
+ *
+ * struct synaptics_rmi4_lz4_stream *stream: the stream
+ *
+ * return EOK: complete
+ * otherwise, the frame is corrupted
+ */
+static int synaptics_rmi4_lz4_stream_next_block(struct synaptics_rmi4_lz4_stream *stream)
+{
+	int retval;
+	unsigned char word[4];
+	uint32_t block_size;
+	size_t size;
+
+	retval = synaptics_rmi4_lz4_pread(stream->fd, word, sizeof(word), stream->next_block);
+	if (retval < 0)
+		return retval;
+	stream->next_block += sizeof(word);
+
+	// end mark
+	block_size = synaptics_rmi4_lz4_le32(word);
+	if (0 == block_size) {
+		if (stream->pos != stream->frame.content_size) {
+			mtouch_error(MTOUCH_DEV, "%s: content size mismatch (%llu, %llu)", __FUNCTION__,
+						(unsigned long long)stream->pos,
+						(unsigned long long)stream->frame.content_size);
+			return -EINVAL;
+		}
+
+		if (stream->frame.content_checksum) {
+			retval = synaptics_rmi4_lz4_pread(stream->fd, word, sizeof(word), stream->next_block);
+			if (retval < 0)
+				return retval;
+
+			if (synaptics_rmi4_lz4_le32(word) != synaptics_rmi4_lz4_xxh32_digest(&stream->hash)) {
+				mtouch_error(MTOUCH_DEV, "%s: content checksum mismatch", __FUNCTION__);
+				return -EINVAL;
+			}
+		}
+
+		stream->end = true;
+		return EOK;
+	}
+
+	size = block_size & ~LZ4_BLOCK_UNCOMPRESSED;
+	if (size > stream->block_buf_size) {
+		mtouch_error(MTOUCH_DEV, "%s: block too large", __FUNCTION__);
+		return -EINVAL;
+	}
+
+	retval = synaptics_rmi4_lz4_pread(stream->fd, stream->block, size, stream->next_block);
+	if (retval < 0)
+		return retval;
+	stream->next_block += size;
+
+	if (stream->frame.block_checksum) {
+		retval = synaptics_rmi4_lz4_pread(stream->fd, word, sizeof(word), stream->next_block);
+		if (retval < 0)
+			return retval;
+		stream->next_block += sizeof(word);
+
+		if (synaptics_rmi4_lz4_le32(word) != synaptics_rmi4_lz4_xxh32(stream->block, size, 0)) {
+			mtouch_error(MTOUCH_DEV, "%s: block checksum mismatch", __FUNCTION__);
+			return -EINVAL;
+		}
+	}
+
+	stream->block_size = size;
+	stream->ip = 0;
+	stream->match = 0;
+	stream->in_match = false;
+
+	// a stored block is a single run of literals
+	stream->literal = (block_size & LZ4_BLOCK_UNCOMPRESSED) ? size : 0;
+
+	return EOK;
+}
+
+/*
+ * to output the decoded bytes
+ * the bytes go to the window of the matches, the content checksum and the output
+ *
+ * struct synaptics_rmi4_lz4_stream *stream: the stream
+ * const unsigned char *src: the decoded bytes
+ * size_t size: number of bytes
+ * unsigned char **dst: the output, advanced on return, NULL to skip the bytes
+ *
+ * return void
+ */
+static void synaptics_rmi4_lz4_stream_emit(struct synaptics_rmi4_lz4_stream *stream,
+			const unsigned char *src, size_t size, unsigned char **dst)
+{
+	size_t head;
+	size_t len;
+	size_t left = size;
+	const unsigned char *ptr = src;
+
+	while (left) {
+		head = (size_t)(stream->pos + (size - left)) & (LZ4_WINDOW_SIZE - 1);
+		len = LZ4_WINDOW_SIZE - head;
+		if (len > left)
+			len = left;
+
+		memcpy(&stream->window[head], ptr, len);
+		ptr += len;
+		left -= len;
+	}
+
+	synaptics_rmi4_lz4_xxh32_update(&stream->hash, src, size);
+
+	if (dst) {
+		memcpy(*dst, src, size);
+		*dst += size;
+	}
+
+	stream->pos += size;
+}
+
+/*
+ * helper function to read the extended length of a sequence
+ *
+ * return EOK: complete
+ * otherwise, the block is corrupted
+ */
+static int synaptics_rmi4_lz4_stream_length(struct synaptics_rmi4_lz4_stream *stream, size_t *len)
+{
+	unsigned char byte;
+
+	if (*len != 15)
+		return EOK;
+
+	do {
+		if (stream->ip >= stream->block_size)
+			return -EINVAL;
+		byte = stream->block[stream->ip++];
+		*len += byte;
+	} while (byte == 255);
+
+	return EOK;
+}
+
+/*
+ * decode the next bytes of the content
+ * the decoding stops in the middle of a sequence once the bytes are produced,
+ * and goes on from there at the next call
+ *
+ * struct synaptics_rmi4_lz4_stream *stream: the stream
+ * unsigned char *dst: the output, NULL to skip the bytes
+ * size_t size: number of bytes
+ *
+ * return EOK: complete
+ * otherwise, the frame is corrupted
+ */
+static int synaptics_rmi4_lz4_stream_decode(struct synaptics_rmi4_lz4_stream *stream,
+			unsigned char *dst, size_t size)
+{
+	int retval;
+	size_t len;
+	size_t ii;
+	unsigned char token;
+	unsigned char chunk[LZ4_MATCH_CHUNK];
+	unsigned char **out = (dst) ? &dst : NULL;
+
+	if (stream->frame.content_size - stream->pos < size)
+		return -EINVAL;
+
+	while (size) {
+		// literals of the current sequence
+		if (stream->literal) {
+			len = (stream->literal < size) ? stream->literal : size;
+
+			synaptics_rmi4_lz4_stream_emit(stream, &stream->block[stream->ip], len, out);
+			stream->ip += len;
+			stream->literal -= len;
+			size -= len;
+			continue;
+		}
+
+		// match of the current sequence, it may overlap the bytes being copied
+		if (stream->match) {
+			len = (stream->match < size) ? stream->match : size;
+			if (len > sizeof(chunk))
+				len = sizeof(chunk);
+
+			for (ii = 0; ii < len; ii++) {
+				if (ii >= stream->offset)
+					chunk[ii] = chunk[ii - stream->offset];
+				else
+					chunk[ii] = stream->window[(size_t)(stream->pos + ii - stream->offset) &
+											(LZ4_WINDOW_SIZE - 1)];
+			}
+
+			synaptics_rmi4_lz4_stream_emit(stream, chunk, len, out);
+			stream->match -= len;
+			size -= len;
+			continue;
+		}
+
+		// offset and length of the match, the last sequence of the block has no match
+		if (stream->in_match) {
+			stream->in_match = false;
+
+			if (stream->ip < stream->block_size) {
+				if (stream->block_size - stream->ip < 2)
+					return -EINVAL;
+
+				stream->offset = stream->block[stream->ip] | (stream->block[stream->ip + 1] << 8);
+				stream->ip += 2;
+				if ((stream->offset == 0) || (stream->offset > stream->pos))
+					return -EINVAL;
+
+				len = stream->token & 0x0F;
+				retval = synaptics_rmi4_lz4_stream_length(stream, &len);
+				if (retval < 0)
+					return retval;
+
+				stream->match = len + LZ4_MIN_MATCH;
+				if (stream->frame.content_size - stream->pos < stream->match)
+					return -EINVAL;
+				continue;
+			}
+		}
+
+		// next sequence
+		if (stream->ip < stream->block_size) {
+			token = stream->block[stream->ip++];
+
+			len = token >> 4;
+			retval = synaptics_rmi4_lz4_stream_length(stream, &len);
+			if (retval < 0)
+				return retval;
+
+			if ((stream->block_size - stream->ip < len) ||
+				(stream->frame.content_size - stream->pos < len))
+				return -EINVAL;
+
+			stream->token = token;
+			stream->literal = len;
+			stream->in_match = true;
+			continue;
+		}
+
+		// next block
+		if (stream->end)
+			return -EINVAL;
+
+		retval = synaptics_rmi4_lz4_stream_next_block(stream);
+		if (retval < 0)
+			return retval;
+	}
+
+	return EOK;
+}
+
+/*
+ * create the streaming decoder of the LZ4 frame
+ * only the window of the matches and one compressed block are allocated,
+ * the block buffer is not larger than the file
+ *
+ * int fd: the image file, it is kept open by the caller
+ * const struct synaptics_rmi4_lz4_frame *frame: the frame descriptor
+ *
+ * return the stream, NULL if fail
+ */
+struct synaptics_rmi4_lz4_stream *synaptics_rmi4_lz4_stream_create(int fd,
+			const struct synaptics_rmi4_lz4_frame *frame)
+{
+	struct stat st;
+	struct synaptics_rmi4_lz4_stream *stream;
+
+	if ((!frame) || (fstat(fd, &st) == -1) || (st.st_size <= frame->data_offset))
+		return NULL;
+
+	stream = calloc(1, sizeof(struct synaptics_rmi4_lz4_stream));
+	if (!stream) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to allocate the stream", __FUNCTION__);
+		return NULL;
+	}
+
+	stream->fd = fd;
+	stream->frame = *frame;
+
+	stream->block_buf_size = frame->block_max;
+	if ((off_t)stream->block_buf_size > st.st_size - frame->data_offset)
+		stream->block_buf_size = st.st_size - frame->data_offset;
+
+	stream->block = malloc(stream->block_buf_size);
+	stream->window = malloc(LZ4_WINDOW_SIZE);
+	if ((!stream->block) || (!stream->window)) {
+		mtouch_error(MTOUCH_DEV, "%s: failed to allocate the buffers", __FUNCTION__);
+		synaptics_rmi4_lz4_stream_destroy(stream);
+		return NULL;
+	}
+
+	synaptics_rmi4_lz4_stream_rewind(stream);
+
+	return stream;
+}
+
+/*
+ * release the streaming decoder
+ * the image file is not closed
+ *
+ * struct synaptics_rmi4_lz4_stream *stream: the stream
+ *
+ * return void
+ */
+void synaptics_rmi4_lz4_stream_destroy(struct synaptics_rmi4_lz4_stream *stream)
+{
+	if (!stream)
+		return;
+
+	free(stream->block);
+	free(stream->window);
+	free(stream);
+}
+
+/*
+ * read a part of the decoded content
+ * the content is decoded up to the part, a part behind the current position
+ * is read by decoding again from the first block
+ *
+ * struct synaptics_rmi4_lz4_stream *stream: the stream
+ * uint64_t offset: offset in the decoded content
+ * unsigned char *dst: the output
+ * size_t size: number of bytes
+ *
+ * return EOK: complete
+ * otherwise, fail
+ */
+int synaptics_rmi4_lz4_stream_read(struct synaptics_rmi4_lz4_stream *stream, uint64_t offset,
+			unsigned char *dst, size_t size)
+{
+	int retval;
+
+	_CHECK_POINTER(stream);
+	_CHECK_POINTER(dst);
+
+	if ((offset > stream->frame.content_size) ||
+		(size > stream->frame.content_size - offset))
+		return -EINVAL;
+
+	if (offset < stream->pos)
+		synaptics_rmi4_lz4_stream_rewind(stream);
+
+	retval = synaptics_rmi4_lz4_stream_decode(stream, NULL, (size_t)(offset - stream->pos));
+	if (retval < 0)
+		goto exit;
+
+	retval = synaptics_rmi4_lz4_stream_decode(stream, dst, size);
+
+exit:
+	if (retval < 0) {
+		mtouch_error(MTOUCH_DEV, "%s: corrupted frame at %llu", __FUNCTION__,
+					(unsigned long long)stream->pos);
+		synaptics_rmi4_lz4_stream_rewind(stream);
+	}
+
+	return retval;
+}
+
+/*
+ * decode the rest of the frame to check the content size and the checksums
+ * nothing is kept, the next read decodes again from the first block
+ *
+ * struct synaptics_rmi4_lz4_stream *stream: the stream
+ *
+ * return EOK: the frame is intact
+ * otherwise, fail
+ */
+int synaptics_rmi4_lz4_stream_check(struct synaptics_rmi4_lz4_stream *stream)
+{
+	int retval;
+
+	_CHECK_POINTER(stream);
+
+	retval = synaptics_rmi4_lz4_stream_decode(stream, NULL,
+				(size_t)(stream->frame.content_size - stream->pos));
+	if (retval < 0)
+		goto exit;
+
+	// no content is expected up to the end mark
+	while (!stream->end) {
+		if (stream->literal || (stream->ip < stream->block_size)) {
+			retval = -EINVAL;
+			goto exit;
+		}
+
+		retval = synaptics_rmi4_lz4_stream_next_block(stream);
+		if (retval < 0)
+			goto exit;
+	}
+
+exit:
+	if (retval < 0)
+		mtouch_error(MTOUCH_DEV, "%s: corrupted frame at %llu", __FUNCTION__,
+					(unsigned long long)stream->pos);
+
+	synaptics_rmi4_lz4_stream_rewind(stream);
+
+	return retval;
+}
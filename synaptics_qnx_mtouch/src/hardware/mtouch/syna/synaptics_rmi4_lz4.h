@@ -0,0 +1,150 @@
+/*
+ * $QNXLicenseC:
+ * Copyright 2010, QNX Software Systems.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You
+ * may not reproduce, modify or distribute this software except in
+ * compliance with the License. You may obtain a copy of the License
+ * at: http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OF ANY KIND, either express or implied.
+ *
+ * This file may contain contributions from others, either as
+ * contributors under the License or as licensors under other terms.
+ * Please review this entire file for other proprietary rights or license
+ * notices, as well as the QNX Development Suite License Guide at
+ * http://licensing.qnx.com/license-guide/ for other information.
+ * $
+ */
+
+/*
+ * Synaptics Touchscreen driver
+ *
+ * Copyright (C) 2012-2018 Synaptics Incorporated. All rights reserved.
+ *
+ * The hardware access library is included from QNX software, and the
+ * mtouch framework is also included from install/usr/input/. Both of
+ * libraries are under Apache-2.0.
+ *
+ * Synaptics Touchscreen driver is interacted with QNX software system
+ * as a touchscreen controller, for its licensing rule and related notices,
+ * please scroll down the text to browse all of it.
+ *
+ * INFORMATION CONTAINED IN THIS DOCUMENT IS PROVIDED "AS-IS," AND SYNAPTICS
+ * EXPRESSLY DISCLAIMS ALL EXPRESS AND IMPLIED WARRANTIES, INCLUDING ANY
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE,
+ * AND ANY WARRANTIES OF NON-INFRINGEMENT OF ANY INTELLECTUAL PROPERTY RIGHTS.
+ * IN NO EVENT SHALL SYNAPTICS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, PUNITIVE, OR CONSEQUENTIAL DAMAGES ARISING OUT OF OR IN CONNECTION
+ * WITH THE USE OF THE INFORMATION CONTAINED IN THIS DOCUMENT, HOWEVER CAUSED
+ * AND BASED ON ANY THEORY OF LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, AND EVEN IF SYNAPTICS WAS ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE. IF A TRIBUNAL OF COMPETENT JURISDICTION DOES
+ * NOT PERMIT THE DISCLAIMER OF DIRECT DAMAGES OR ANY OTHER DAMAGES, SYNAPTICS'
+ * TOTAL CUMULATIVE LIABILITY TO ANY PARTY SHALL NOT EXCEED ONE HUNDRED U.S.
+ * DOLLARS.
+ *
+ */
+
+
+#ifndef _SYNAPTICS_RMI4_LZ4_H_
+#define _SYNAPTICS_RMI4_LZ4_H_
+
+
+/*
+ * magic number at the beginning of a LZ4 frame
+ */
+#define LZ4_FRAME_MAGIC				(0x184D2204)
+
+/*
+ * the largest block of the frame, block maximum size 4 MB
+ */
+#define LZ4_MAX_BLOCK_SIZE			(4 * 1024 * 1024)
+
+/*
+ * the decoded bytes kept for the matches, the largest offset of a match is 65535
+ */
+#define LZ4_WINDOW_SIZE				(64 * 1024)
+
+/*
+ * the frame descriptor of a LZ4 frame
+ *
+ * block_checksum: each block is followed by the xxHash-32 of the block
+ * content_checksum: the frame ends with the xxHash-32 of the decoded content
+ * block_max: the maximum size of a block, in bytes
+ * content_size: the size of the decoded content, in bytes
+ * data_offset: offset of the first block in the file
+ */
+struct synaptics_rmi4_lz4_frame {
+	bool block_checksum;
+	bool content_checksum;
+	size_t block_max;
+	uint64_t content_size;
+	off_t data_offset;
+};
+
+/*
+ * the state of the xxHash-32 computed over the decoded content
+ *
+ */
+struct synaptics_rmi4_lz4_xxh32 {
+	uint64_t total;
+	uint32_t v[4];
+	unsigned char mem[16];
+	size_t mem_size;
+};
+
+/*
+ * the streaming decoder of a LZ4 frame
+ *
+ * the content is decoded in order, only one compressed block and the window
+ * of the matches are held in memory. a part behind the current position is
+ * read by decoding again from the first block
+ *
+ * fd: the image file
+ * frame: the frame descriptor
+ * block: the compressed block being decoded
+ * block_buf_size: size of the block buffer
+ * block_size: size of the current block
+ * ip: position in the current block
+ * token: the token of the current sequence
+ * in_match: the match of the current sequence is not read yet
+ * literal: literals left in the current sequence
+ * match: bytes left in the current match
+ * offset: offset of the current match
+ * window: the last LZ4_WINDOW_SIZE bytes decoded
+ * pos: the bytes decoded so far
+ * next_block: offset of the next block in the file
+ * end: the end mark is read
+ * hash: the xxHash-32 of the bytes decoded so far
+ */
+struct synaptics_rmi4_lz4_stream {
+	int fd;
+	struct synaptics_rmi4_lz4_frame frame;
+	unsigned char *block;
+	size_t block_buf_size;
+	size_t block_size;
+	size_t ip;
+	unsigned char token;
+	bool in_match;
+	size_t literal;
+	size_t match;
+	size_t offset;
+	unsigned char *window;
+	uint64_t pos;
+	off_t next_block;
+	bool end;
+	struct synaptics_rmi4_lz4_xxh32 hash;
+};
+
+extern int synaptics_rmi4_lz4_read_frame(int fd, struct synaptics_rmi4_lz4_frame *frame);
+extern struct synaptics_rmi4_lz4_stream *synaptics_rmi4_lz4_stream_create(int fd,
+			const struct synaptics_rmi4_lz4_frame *frame);
+extern void synaptics_rmi4_lz4_stream_destroy(struct synaptics_rmi4_lz4_stream *stream);
+extern int synaptics_rmi4_lz4_stream_read(struct synaptics_rmi4_lz4_stream *stream, uint64_t offset,
+			unsigned char *dst, size_t size);
+extern int synaptics_rmi4_lz4_stream_check(struct synaptics_rmi4_lz4_stream *stream);
+
+#endif /* _SYNAPTICS_RMI4_LZ4_H_ */